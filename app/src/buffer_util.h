@@ -8,6 +8,12 @@ static inline void buffer_write16be(Uint8 *buf, Uint16 value) {
     buf[1] = value;
 }
 
+// HID reports are little-endian
+static inline void buffer_write16le(Uint8 *buf, Uint16 value) {
+    buf[0] = value;
+    buf[1] = value >> 8;
+}
+
 static inline void buffer_write32be(Uint8 *buf, Uint32 value) {
     buf[0] = value >> 24;
     buf[1] = value >> 16;
@@ -15,11 +21,11 @@ static inline void buffer_write32be(Uint8 *buf, Uint32 value) {
     buf[3] = value;
 }
 
-static inline Uint32 buffer_read32be(Uint8 *buf) {
+static inline Uint32 buffer_read32be(const Uint8 *buf) {
     return (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
 }
 
-static inline Uint64 buffer_read64be(Uint8 *buf) {
+static inline Uint64 buffer_read64be(const Uint8 *buf) {
     Uint32 msb = buffer_read32be(buf);
     Uint32 lsb = buffer_read32be(&buf[4]);
     return ((Uint64) msb << 32) | lsb;
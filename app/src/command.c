@@ -35,6 +35,11 @@ static void show_adb_err_msg(enum process_result err) {
 }
 
 process_t adb_execute(const char *serial, const char *const adb_cmd[], int len) {
+    return adb_execute_redirect(serial, adb_cmd, len, NULL);
+}
+
+process_t adb_execute_redirect(const char *serial, const char *const adb_cmd[],
+                               int len, pipe_t *pipe_stdout) {
     const char *cmd[len + 4];
     int i;
     process_t process;
@@ -49,7 +54,8 @@ process_t adb_execute(const char *serial, const char *const adb_cmd[], int len)
 
     memcpy(&cmd[i], adb_cmd, len * sizeof(const char *));
     cmd[len + i] = NULL;
-    enum process_result r = cmd_execute(cmd[0], cmd, &process);
+    enum process_result r = cmd_execute_redirect(cmd[0], cmd, &process,
+                                                 pipe_stdout);
     if (r != PROCESS_SUCCESS) {
         show_adb_err_msg(r);
         return PROCESS_NONE;
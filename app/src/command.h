@@ -24,11 +24,13 @@
 # define PROCESS_NONE NULL
   typedef HANDLE process_t;
   typedef DWORD exit_code_t;
+  typedef HANDLE pipe_t;
 #else
 # include <sys/types.h>
 # define PROCESS_NONE -1
   typedef pid_t process_t;
   typedef int exit_code_t;
+  typedef int pipe_t;
 #endif
 # define NO_EXIT_CODE -1
 
@@ -39,10 +41,19 @@ enum process_result {
 };
 
 enum process_result cmd_execute(const char *path, const char *const argv[], process_t *process);
+// if pipe_stdout is not NULL, the stdout of the process is redirected to a
+// new pipe, to be read by read_pipe_all() then closed by close_pipe()
+enum process_result cmd_execute_redirect(const char *path, const char *const argv[],
+                                         process_t *process, pipe_t *pipe_stdout);
+// read until EOF (or len bytes), return the number of bytes read, -1 on error
+ssize_t read_pipe_all(pipe_t pipe, char *data, size_t len);
+void close_pipe(pipe_t pipe);
 SDL_bool cmd_terminate(process_t pid);
 SDL_bool cmd_simple_wait(process_t pid, exit_code_t *exit_code);
 
 process_t adb_execute(const char *serial, const char *const adb_cmd[], int len);
+process_t adb_execute_redirect(const char *serial, const char *const adb_cmd[],
+                               int len, pipe_t *pipe_stdout);
 process_t adb_forward(const char *serial, uint16_t local_port, const char *device_socket_name);
 process_t adb_forward_remove(const char *serial, uint16_t local_port);
 process_t adb_reverse(const char *serial, const char *device_socket_name, uint16_t local_port);
@@ -1,11 +1,12 @@
 #include "control_event.h"
 
+#include <SDL2/SDL_assert.h>
 #include <SDL2/SDL_stdinc.h>
 #include <string.h>
 
 #include "buffer_util.h"
-#include "lock_util.h"
 #include "log.h"
+#include "str_util.h"
 
 static void write_position(Uint8 *buf, const struct position *position) {
     buffer_write16be(&buf[0], position->point.x);
@@ -46,6 +47,38 @@ int control_event_serialize(const struct control_event *event, unsigned char *bu
         case CONTROL_EVENT_TYPE_COMMAND:
             buf[1] = event->command_event.action;
             return 2;
+        case CONTROL_EVENT_TYPE_SET_CLIPBOARD: {
+            buf[1] = !!event->set_clipboard_event.paste;
+            size_t len = utf8_truncation_index(event->set_clipboard_event.text,
+                                               CLIPBOARD_TEXT_MAX_LENGTH);
+            buffer_write32be(&buf[2], (Uint32) len);
+            memcpy(&buf[CLIPBOARD_HEADER_SIZE], event->set_clipboard_event.text,
+                   len);
+            return CLIPBOARD_HEADER_SIZE + len;
+        }
+        case CONTROL_EVENT_TYPE_TOUCH:
+            buf[1] = event->touch_event.action;
+            buf[2] = event->touch_event.pointer_id;
+            write_position(&buf[3], &event->touch_event.position);
+            buffer_write16be(&buf[11], event->touch_event.pressure);
+            return 13;
+        case CONTROL_EVENT_TYPE_SWIPE: {
+            Uint8 count = event->swipe_event.count;
+            if (count > SWIPE_MAX_POINTS) {
+                count = SWIPE_MAX_POINTS;
+            }
+            buffer_write16be(&buf[1], event->swipe_event.delay);
+            buffer_write16be(&buf[3], event->swipe_event.screen_size.width);
+            buffer_write16be(&buf[5], event->swipe_event.screen_size.height);
+            buf[7] = count;
+            for (int i = 0; i < count; ++i) {
+                buffer_write16be(&buf[8 + 4 * i],
+                                 event->swipe_event.points[i].x);
+                buffer_write16be(&buf[10 + 4 * i],
+                                 event->swipe_event.points[i].y);
+            }
+            return 8 + 4 * count;
+        }
         default:
             LOGW("Unknown event type: %u", (unsigned) event->type);
             return 0;
@@ -56,48 +89,162 @@ void control_event_destroy(struct control_event *event) {
     if (event->type == CONTROL_EVENT_TYPE_TEXT) {
         SDL_free(event->text_event.text);
     }
+    if (event->type == CONTROL_EVENT_TYPE_SET_CLIPBOARD) {
+        SDL_free(event->set_clipboard_event.text);
+    }
     if (event->type == CONTROL_EVENT_TYPE_SWIPE) {
-        SDL_free(event->swipe_event.events);
+        SDL_free(event->swipe_event.points);
     }
 }
 
-SDL_bool control_event_queue_is_empty(const struct control_event_queue *queue) {
-    return queue->head == queue->tail;
+// values of coalesce_slot which are not a slot index
+#define COALESCE_NONE -1
+#define COALESCE_BUSY -2 // the producer is merging into the last slot
+
+static inline unsigned queue_depth(struct control_event_queue *queue) {
+    return (unsigned) SDL_AtomicGet(&queue->head)
+         - (unsigned) SDL_AtomicGet(&queue->tail);
+}
+
+SDL_bool control_event_queue_is_empty(struct control_event_queue *queue) {
+    return !queue_depth(queue);
 }
 
-SDL_bool control_event_queue_is_full(const struct control_event_queue *queue) {
-    return (queue->head + 1) % CONTROL_EVENT_QUEUE_SIZE == queue->tail;
+SDL_bool control_event_queue_is_full(struct control_event_queue *queue) {
+    return queue_depth(queue) == queue->capacity;
 }
 
-SDL_bool control_event_queue_init(struct control_event_queue *queue) {
-    queue->head = 0;
-    queue->tail = 0;
-    // the current implementation may not fail
+SDL_bool control_event_queue_init(struct control_event_queue *queue, unsigned capacity) {
+    SDL_assert(capacity && capacity <= CONTROL_EVENT_QUEUE_MAX_CAPACITY);
+    unsigned pow2 = 1;
+    while (pow2 < capacity) {
+        pow2 <<= 1;
+    }
+    queue->data = SDL_malloc(pow2 * sizeof(*queue->data));
+    if (!queue->data) {
+        return SDL_FALSE;
+    }
+    queue->capacity = pow2;
+    SDL_AtomicSet(&queue->head, 0);
+    SDL_AtomicSet(&queue->tail, 0);
+    SDL_AtomicSet(&queue->coalesce_slot, COALESCE_NONE);
+    queue->dropped = 0;
+    queue->max_depth = 0;
     return SDL_TRUE;
 }
 
 void control_event_queue_destroy(struct control_event_queue *queue) {
-    int i = queue->tail;
-    while (i != queue->head) {
-        control_event_destroy(&queue->data[i]);
-        i = (i + 1) % CONTROL_EVENT_QUEUE_SIZE;
+    // the threads are stopped, so there is no concurrent access anymore
+    unsigned head = SDL_AtomicGet(&queue->head);
+    unsigned i = SDL_AtomicGet(&queue->tail);
+    while (i != head) {
+        control_event_destroy(&queue->data[i & (queue->capacity - 1)]);
+        ++i;
     }
+    SDL_free(queue->data);
+}
+
+static SDL_bool is_mouse_move(const struct control_event *event) {
+    return event->type == CONTROL_EVENT_TYPE_MOUSE
+        && event->mouse_event.action == AMOTION_EVENT_ACTION_MOVE;
 }
 
-SDL_bool control_event_queue_push(struct control_event_queue *queue, const struct control_event *event) {
-    if (control_event_queue_is_full(queue)) {
+SDL_bool control_event_queue_push(struct control_event_queue *queue, const struct control_event *event,
+                                  SDL_bool *first) {
+    unsigned head = SDL_AtomicGet(&queue->head);
+    unsigned depth = head - (unsigned) SDL_AtomicGet(&queue->tail);
+    if (depth == queue->capacity) {
+        ++queue->dropped;
         return SDL_FALSE;
     }
-    queue->data[queue->head] = *event;
-    queue->head = (queue->head + 1) % CONTROL_EVENT_QUEUE_SIZE;
+    unsigned slot = head & (queue->capacity - 1);
+    queue->data[slot] = *event;
+    // must be set before the event is published, so that the consumer
+    // disables the coalescing once it takes the event
+    SDL_AtomicSet(&queue->coalesce_slot,
+                  is_mouse_move(event) ? (int) slot : COALESCE_NONE);
+    // publish the event (SDL_AtomicAdd() is a full memory barrier)
+    SDL_AtomicAdd(&queue->head, 1);
+    if (first) {
+        // read the tail after publishing (not the depth sampled before):
+        // either the consumer sees the new head before it waits, or this
+        // sees the tail of the drained queue
+        unsigned tail = SDL_AtomicGet(&queue->tail);
+        *first = head + 1 - tail == 1;
+    }
+
+    if (depth + 1 > queue->max_depth) {
+        queue->max_depth = depth + 1;
+    }
     return SDL_TRUE;
 }
 
-SDL_bool control_event_queue_take(struct control_event_queue *queue, struct control_event *event) {
-    if (control_event_queue_is_empty(queue)) {
+SDL_bool control_event_queue_coalesce(struct control_event_queue *queue, const struct control_event *event) {
+    if (!is_mouse_move(event)) {
         return SDL_FALSE;
     }
-    *event = queue->data[queue->tail];
-    queue->tail = (queue->tail + 1) % CONTROL_EVENT_QUEUE_SIZE;
-    return SDL_TRUE;
+    int slot = SDL_AtomicGet(&queue->coalesce_slot);
+    if (slot < 0) {
+        return SDL_FALSE;
+    }
+    // "lock" the slot, this fails if the consumer has just taken it
+    if (!SDL_AtomicCAS(&queue->coalesce_slot, slot, COALESCE_BUSY)) {
+        return SDL_FALSE;
+    }
+    struct control_event *last_event = &queue->data[slot];
+    SDL_bool merge =
+        last_event->mouse_event.buttons == event->mouse_event.buttons;
+    if (merge) {
+        last_event->mouse_event.position = event->mouse_event.position;
+    }
+    // unlock (full memory barrier, the position is written before)
+    SDL_bool ok = SDL_AtomicCAS(&queue->coalesce_slot, COALESCE_BUSY, slot);
+    SDL_assert(ok);
+    (void) ok;
+    return merge;
+}
+
+// prevent the producer to merge into the slots [tail, tail + count)
+static void disable_coalescing(struct control_event_queue *queue,
+                               unsigned tail, unsigned count) {
+    for (;;) {
+        int slot = SDL_AtomicGet(&queue->coalesce_slot);
+        if (slot == COALESCE_NONE) {
+            return;
+        }
+        if (slot == COALESCE_BUSY) {
+            // the producer is writing a position, this is very short
+            continue;
+        }
+        unsigned offset = ((unsigned) slot - tail) & (queue->capacity - 1);
+        if (offset >= count) {
+            // the slot is not taken (it may not even be published yet)
+            return;
+        }
+        if (SDL_AtomicCAS(&queue->coalesce_slot, slot, COALESCE_NONE)) {
+            return;
+        }
+    }
+}
+
+unsigned control_event_queue_take_all(struct control_event_queue *queue, struct control_event *events, unsigned max) {
+    unsigned tail = SDL_AtomicGet(&queue->tail);
+    unsigned count = (unsigned) SDL_AtomicGet(&queue->head) - tail;
+    if (count > max) {
+        count = max;
+    }
+    if (!count) {
+        return 0;
+    }
+    disable_coalescing(queue, tail, count);
+    for (unsigned i = 0; i < count; ++i) {
+        events[i] = queue->data[(tail + i) & (queue->capacity - 1)];
+    }
+    // release the slots (SDL_AtomicAdd() is a full memory barrier)
+    SDL_AtomicAdd(&queue->tail, count);
+    return count;
+}
+
+SDL_bool control_event_queue_take(struct control_event_queue *queue, struct control_event *event) {
+    return control_event_queue_take_all(queue, event, 1) == 1;
 }
@@ -1,16 +1,22 @@
 #ifndef CONTROLEVENT_H
 #define CONTROLEVENT_H
 
-#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_atomic.h>
 #include <SDL2/SDL_stdinc.h>
 
 #include "android/input.h"
 #include "android/keycodes.h"
 #include "common.h"
 
-#define CONTROL_EVENT_QUEUE_SIZE 64
+#define CONTROL_EVENT_QUEUE_MAX_CAPACITY 0x10000
 #define TEXT_MAX_LENGTH 300
-#define SERIALIZED_EVENT_MAX_SIZE 3 + TEXT_MAX_LENGTH
+#define SERIALIZED_EVENT_MAX_SIZE (3 + TEXT_MAX_LENGTH)
+#define SWIPE_MAX_POINTS 64
+#define TOUCH_PRESSURE_MAX 0xffff // 1.0 on the device
+// type (1 byte) + paste flag (1 byte) + length (4 bytes) + text
+#define CLIPBOARD_HEADER_SIZE 6
+// must match the server buffer size (ControlEventReader.RAW_BUFFER_SIZE)
+#define CLIPBOARD_TEXT_MAX_LENGTH ((1 << 18) - CLIPBOARD_HEADER_SIZE)
 
 enum control_event_type {
     CONTROL_EVENT_TYPE_KEYCODE,
@@ -19,6 +25,8 @@ enum control_event_type {
     CONTROL_EVENT_TYPE_SCROLL,
     CONTROL_EVENT_TYPE_COMMAND,
     CONTROL_EVENT_TYPE_SWIPE,
+    CONTROL_EVENT_TYPE_TOUCH,
+    CONTROL_EVENT_TYPE_SET_CLIPBOARD,
 };
 
 #define CONTROL_EVENT_COMMAND_BACK_OR_SCREEN_ON 0
@@ -50,31 +58,74 @@ struct control_event {
             int action;
         } command_event;
         struct {
-            struct control_event* events;
-            int time;
-            int num;
+            char *text; // owned, to be freed by SDL_free()
+            SDL_bool paste; // inject PASTE once the device clipboard is set
+        } set_clipboard_event;
+        struct {
+            // DOWN, MOVE or UP for this pointer only: the device computes the
+            // POINTER_DOWN/POINTER_UP actions (with the pointer index) from
+            // the other pointers currently down
+            enum android_motionevent_action action;
+            Uint8 pointer_id;
+            struct position position;
+            Uint16 pressure; // fixed-point, TOUCH_PRESSURE_MAX is 1.0
+        } touch_event;
+        struct {
+            // the device replays the whole gesture: DOWN on the first point,
+            // MOVE on the next ones, then UP on the last one, every delay ms
+            struct size screen_size;
+            struct point *points; // owned, to be freed by SDL_free()
+            Uint8 count; // at most SWIPE_MAX_POINTS
+            Uint16 delay; // in milliseconds
         } swipe_event;
     };
 };
 
+// Single-producer/single-consumer lock-free ring: the SDL thread pushes, the
+// controller thread takes. The head and tail indices increase monotonically
+// (the slot index is the value modulo the capacity, a power of 2).
 struct control_event_queue {
-    struct control_event data[CONTROL_EVENT_QUEUE_SIZE];
-    int head;
-    int tail;
+    struct control_event *data;
+    unsigned capacity;
+    SDL_atomic_t head; // written only by the producer
+    SDL_atomic_t tail; // written only by the consumer
+    // slot index of the last pushed event while it may still be merged by
+    // control_event_queue_coalesce(), or a negative value (see .c)
+    SDL_atomic_t coalesce_slot;
+    // statistics, only accessed by the producer
+    unsigned dropped;
+    unsigned max_depth;
 };
 
-// buf size must be at least SERIALIZED_EVENT_MAX_SIZE
+// buf size must be at least SERIALIZED_EVENT_MAX_SIZE, except for a
+// SET_CLIPBOARD event, which requires CLIPBOARD_HEADER_SIZE + strlen(text)
+// (at most CLIPBOARD_HEADER_SIZE + CLIPBOARD_TEXT_MAX_LENGTH)
 int control_event_serialize(const struct control_event *event, unsigned char *buf);
 
-SDL_bool control_event_queue_init(struct control_event_queue *queue);
+// capacity is rounded up to a power of 2 (at most CONTROL_EVENT_QUEUE_MAX_CAPACITY)
+SDL_bool control_event_queue_init(struct control_event_queue *queue, unsigned capacity);
 void control_event_queue_destroy(struct control_event_queue *queue);
 
-SDL_bool control_event_queue_is_empty(const struct control_event_queue *queue);
-SDL_bool control_event_queue_is_full(const struct control_event_queue *queue);
+SDL_bool control_event_queue_is_empty(struct control_event_queue *queue);
+SDL_bool control_event_queue_is_full(struct control_event_queue *queue);
 
+// producer side
 // event is copied, the queue does not use the event after the function returns
-SDL_bool control_event_queue_push(struct control_event_queue *queue, const struct control_event *event);
+// if the queue is full, the event is dropped (and counted)
+// if first is not NULL, it is set to SDL_TRUE if the event was the only one in
+// the queue once published (the consumer may then be waiting for it)
+SDL_bool control_event_queue_push(struct control_event_queue *queue, const struct control_event *event,
+                                  SDL_bool *first);
+
+// if event is a mouse MOVE and the last queued event (not consumed yet) is a
+// MOVE with the same buttons, replace its position by the new one
+// return SDL_TRUE if the event has been merged (so it must not be pushed)
+SDL_bool control_event_queue_coalesce(struct control_event_queue *queue, const struct control_event *event);
+
+// consumer side
 SDL_bool control_event_queue_take(struct control_event_queue *queue, struct control_event *event);
+// take at most max events at once, return the number of events taken
+unsigned control_event_queue_take_all(struct control_event_queue *queue, struct control_event *events, unsigned max);
 
 void control_event_destroy(struct control_event *event);
 
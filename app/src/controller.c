@@ -1,90 +1,140 @@
 #include "controller.h"
 
 #include <SDL2/SDL_assert.h>
+#include <string.h>
+
 #include "config.h"
-#include "lock_util.h"
 #include "log.h"
 
-SDL_bool controller_init(struct controller *controller, socket_t video_socket) {
-    if (!control_event_queue_init(&controller->queue)) {
-        return SDL_FALSE;
-    }
-
-    if (!(controller->mutex = SDL_CreateMutex())) {
+SDL_bool controller_init(struct controller *controller, socket_t control_socket,
+                         unsigned queue_size) {
+    if (!control_event_queue_init(&controller->queue, queue_size)) {
         return SDL_FALSE;
     }
 
-    if (!(controller->event_cond = SDL_CreateCond())) {
-        SDL_DestroyMutex(controller->mutex);
+    if (!(controller->event_sem = SDL_CreateSemaphore(0))) {
+        control_event_queue_destroy(&controller->queue);
         return SDL_FALSE;
     }
 
-    controller->video_socket = video_socket;
-    controller->stopped = SDL_FALSE;
+    controller->control_socket = control_socket;
+    SDL_AtomicSet(&controller->stopped, 0);
 
     return SDL_TRUE;
 }
 
 void controller_destroy(struct controller *controller) {
-    SDL_DestroyCond(controller->event_cond);
-    SDL_DestroyMutex(controller->mutex);
+    LOGD("Control queue: capacity=%u max_depth=%u dropped=%u",
+         controller->queue.capacity, controller->queue.max_depth,
+         controller->queue.dropped);
+    if (controller->queue.dropped) {
+        LOGW("%u control events dropped (queue full), "
+             "consider increasing --control-queue-size",
+             controller->queue.dropped);
+    }
+    SDL_DestroySemaphore(controller->event_sem);
     control_event_queue_destroy(&controller->queue);
 }
 
 SDL_bool controller_push_event(struct controller *controller, const struct control_event *event) {
-    SDL_bool res;
-    mutex_lock(controller->mutex);
-    SDL_bool was_empty = control_event_queue_is_empty(&controller->queue);
-    res = control_event_queue_push(&controller->queue, event);
-    if (was_empty) {
-        cond_signal(controller->event_cond);
+    // consecutive MOVE events not sent yet are merged, so that a fast mouse
+    // never fills the queue
+    if (control_event_queue_coalesce(&controller->queue, event)) {
+        return SDL_TRUE;
+    }
+    SDL_bool first;
+    if (!control_event_queue_push(&controller->queue, event, &first)) {
+        return SDL_FALSE;
+    }
+    // the controller thread only waits once it has found the queue empty, so
+    // it needs to be woken up only on the empty -> non-empty transition
+    // (detected after publishing the event, not before, otherwise a wakeup
+    // may be lost if the queue is drained meanwhile)
+    if (first) {
+        SDL_SemPost(controller->event_sem);
     }
-    mutex_unlock(controller->mutex);
-    return res;
+    return SDL_TRUE;
 }
 
-static SDL_bool process_event(struct controller *controller, const struct control_event *event) {
-    unsigned char serialized_event[SERIALIZED_EVENT_MAX_SIZE];
-    int length = control_event_serialize(event, serialized_event);
+static SDL_bool send_buffer(struct controller *controller, size_t length) {
     if (!length) {
-        return SDL_FALSE;
+        return SDL_TRUE;
+    }
+    ssize_t w = net_send_all(controller->control_socket, controller->buffer,
+                             length);
+    return w != -1;
+}
+
+// a clipboard text may be too large for the batch buffer, so it is sent on
+// its own
+static SDL_bool send_clipboard(struct controller *controller,
+                               const struct control_event *event) {
+    size_t size = CLIPBOARD_HEADER_SIZE
+                + strlen(event->set_clipboard_event.text);
+    if (size > CLIPBOARD_HEADER_SIZE + CLIPBOARD_TEXT_MAX_LENGTH) {
+        // the text will be truncated
+        size = CLIPBOARD_HEADER_SIZE + CLIPBOARD_TEXT_MAX_LENGTH;
+    }
+    unsigned char *buf = SDL_malloc(size);
+    if (!buf) {
+        LOGW("Cannot allocate clipboard event");
+        // do not close the connection
+        return SDL_TRUE;
+    }
+    int length = control_event_serialize(event, buf);
+    ssize_t w = net_send_all(controller->control_socket, buf, length);
+    SDL_free(buf);
+    return w != -1;
+}
+
+// serialize the events into a contiguous buffer, so that they are sent (in
+// order) by a single call instead of one syscall per event
+static SDL_bool process_events(struct controller *controller,
+                               const struct control_event *events, unsigned count) {
+    size_t length = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        if (events[i].type == CONTROL_EVENT_TYPE_SET_CLIPBOARD) {
+            // flush the previous events first, to preserve the order
+            if (!send_buffer(controller, length)
+                    || !send_clipboard(controller, &events[i])) {
+                return SDL_FALSE;
+            }
+            length = 0;
+            continue;
+        }
+        SDL_assert(length + SERIALIZED_EVENT_MAX_SIZE <= CONTROLLER_BUFFER_SIZE);
+        int r = control_event_serialize(&events[i], &controller->buffer[length]);
+        if (!r) {
+            return SDL_FALSE;
+        }
+        length += r;
     }
-    int w = net_send_all(controller->video_socket, serialized_event, length);
-    return w == length;
+    return send_buffer(controller, length);
 }
 
 static int run_controller(void *data) {
     struct controller *controller = data;
 
     for (;;) {
-        mutex_lock(controller->mutex);
-        while (!controller->stopped && control_event_queue_is_empty(&controller->queue)) {
-            cond_wait(controller->event_cond, controller->mutex);
-        }
-        if (controller->stopped) {
+        if (SDL_AtomicGet(&controller->stopped)) {
             // stop immediately, do not process further events
-            mutex_unlock(controller->mutex);
             break;
         }
-        struct control_event event;
-        SDL_bool non_empty = control_event_queue_take(&controller->queue, &event);
-        SDL_assert(non_empty);
-        mutex_unlock(controller->mutex);
-
-        SDL_bool ok = 1;
-        if (event.type == CONTROL_EVENT_TYPE_SWIPE)
-        {
-            for (int i = 0; i < event.swipe_event.num; ++i) {
-                if (i) usleep(event.swipe_event.time);
-                ok = process_event(controller, &event.swipe_event.events[i]);
-                if (!ok) {
-                    break;
-                }
-            }
+        struct control_event events[CONTROLLER_BATCH_SIZE];
+        unsigned count = control_event_queue_take_all(&controller->queue,
+                                                      events,
+                                                      CONTROLLER_BATCH_SIZE);
+        if (!count) {
+            // the queue is empty, wait for the next push (or stop)
+            // a spurious wakeup just leads to another empty take
+            SDL_SemWait(controller->event_sem);
+            continue;
+        }
+
+        SDL_bool ok = process_events(controller, events, count);
+        for (unsigned i = 0; i < count; ++i) {
+            control_event_destroy(&events[i]);
         }
-        else
-            ok = process_event(controller, &event);
-        control_event_destroy(&event);
         if (!ok) {
             LOGD("Cannot write event to socket");
             break;
@@ -106,10 +156,8 @@ SDL_bool controller_start(struct controller *controller) {
 }
 
 void controller_stop(struct controller *controller) {
-    mutex_lock(controller->mutex);
-    controller->stopped = SDL_TRUE;
-    cond_signal(controller->event_cond);
-    mutex_unlock(controller->mutex);
+    SDL_AtomicSet(&controller->stopped, 1);
+    SDL_SemPost(controller->event_sem);
 }
 
 void controller_join(struct controller *controller) {
@@ -3,22 +3,31 @@
 
 #include "control_event.h"
 
+#include <SDL2/SDL_atomic.h>
 #include <SDL2/SDL_mutex.h>
 #include <SDL2/SDL_stdinc.h>
 #include <SDL2/SDL_thread.h>
 
 #include "net.h"
 
+// maximum number of events taken from the queue and sent at once
+#define CONTROLLER_BATCH_SIZE 64
+
+// all the events of a batch are serialized into a single buffer
+#define CONTROLLER_BUFFER_SIZE \
+    (CONTROLLER_BATCH_SIZE * SERIALIZED_EVENT_MAX_SIZE)
+
 struct controller {
-    socket_t video_socket;
+    socket_t control_socket;
     SDL_Thread *thread;
-    SDL_mutex *mutex;
-    SDL_cond *event_cond;
-    SDL_bool stopped;
+    SDL_sem *event_sem; // posted when the queue becomes non-empty
+    SDL_atomic_t stopped;
     struct control_event_queue queue;
+    unsigned char buffer[CONTROLLER_BUFFER_SIZE];
 };
 
-SDL_bool controller_init(struct controller *controller, socket_t video_socket);
+SDL_bool controller_init(struct controller *controller, socket_t control_socket,
+                         unsigned queue_size);
 void controller_destroy(struct controller *controller);
 
 SDL_bool controller_start(struct controller *controller);
@@ -26,6 +35,7 @@ void controller_stop(struct controller *controller);
 void controller_join(struct controller *controller);
 
 // expose simple API to hide control_event_queue
+// must always be called from the same thread (the queue has a single producer)
 SDL_bool controller_push_event(struct controller *controller, const struct control_event *event);
 
 #endif
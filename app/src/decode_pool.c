@@ -0,0 +1,181 @@
+#include "decode_pool.h"
+
+#include <SDL2/SDL_assert.h>
+
+#include "lock_util.h"
+#include "log.h"
+
+// call with pool->mutex locked
+static void schedule(struct decode_pool *pool, struct decode_pool_queue *queue) {
+    queue->next = NULL;
+    if (pool->tail) {
+        pool->tail->next = queue;
+    } else {
+        pool->head = queue;
+    }
+    pool->tail = queue;
+    cond_signal(pool->cond);
+}
+
+static int run_worker(void *data) {
+    struct decode_pool *pool = data;
+
+    mutex_lock(pool->mutex);
+    for (;;) {
+        while (!pool->stopped && !pool->head) {
+            cond_wait(pool->cond, pool->mutex);
+        }
+        if (pool->stopped) {
+            break;
+        }
+
+        struct decode_pool_queue *queue = pool->head;
+        pool->head = queue->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        SDL_assert(queue->scheduled && queue->count);
+        void *packet = queue->packets[queue->head];
+        queue->head = (queue->head + 1) % DECODE_POOL_QUEUE_SIZE;
+        --queue->count;
+        mutex_unlock(pool->mutex);
+
+        // the queue is still scheduled, so no other worker decodes it
+        SDL_bool ok = queue->decode(queue->opaque, packet);
+
+        mutex_lock(pool->mutex);
+        if (!ok) {
+            queue->failed = SDL_TRUE;
+        }
+        if (queue->count) {
+            // let the other queues be decoded before the next packet
+            schedule(pool, queue);
+        } else {
+            queue->scheduled = SDL_FALSE;
+        }
+        // the queue is not full anymore, and may be drained
+        cond_signal(queue->cond);
+    }
+    mutex_unlock(pool->mutex);
+
+    return 0;
+}
+
+SDL_bool decode_pool_init(struct decode_pool *pool, unsigned thread_count) {
+    SDL_assert(thread_count);
+    pool->threads = SDL_calloc(thread_count, sizeof(*pool->threads));
+    if (!pool->threads) {
+        return SDL_FALSE;
+    }
+
+    if (!(pool->mutex = SDL_CreateMutex())) {
+        SDL_free(pool->threads);
+        return SDL_FALSE;
+    }
+
+    if (!(pool->cond = SDL_CreateCond())) {
+        SDL_DestroyMutex(pool->mutex);
+        SDL_free(pool->threads);
+        return SDL_FALSE;
+    }
+
+    pool->thread_count = thread_count;
+    pool->head = NULL;
+    pool->tail = NULL;
+    pool->stopped = SDL_FALSE;
+    return SDL_TRUE;
+}
+
+void decode_pool_destroy(struct decode_pool *pool) {
+    SDL_DestroyCond(pool->cond);
+    SDL_DestroyMutex(pool->mutex);
+    SDL_free(pool->threads);
+}
+
+SDL_bool decode_pool_start(struct decode_pool *pool) {
+    LOGD("Starting decode pool (%u threads)", pool->thread_count);
+
+    for (unsigned i = 0; i < pool->thread_count; ++i) {
+        pool->threads[i] = SDL_CreateThread(run_worker, "decode_worker", pool);
+        if (!pool->threads[i]) {
+            LOGC("Could not start decoding thread");
+            // stop the workers already started
+            pool->thread_count = i;
+            decode_pool_stop(pool);
+            decode_pool_join(pool);
+            return SDL_FALSE;
+        }
+    }
+    return SDL_TRUE;
+}
+
+void decode_pool_stop(struct decode_pool *pool) {
+    mutex_lock(pool->mutex);
+    SDL_assert(!pool->head);
+    pool->stopped = SDL_TRUE;
+    cond_broadcast(pool->cond);
+    mutex_unlock(pool->mutex);
+}
+
+void decode_pool_join(struct decode_pool *pool) {
+    for (unsigned i = 0; i < pool->thread_count; ++i) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+}
+
+SDL_bool decode_pool_queue_init(struct decode_pool_queue *queue,
+                                struct decode_pool *pool,
+                                decode_pool_fn decode, void *opaque) {
+    if (!(queue->cond = SDL_CreateCond())) {
+        return SDL_FALSE;
+    }
+    queue->pool = pool;
+    queue->decode = decode;
+    queue->opaque = opaque;
+    queue->head = 0;
+    queue->count = 0;
+    queue->scheduled = SDL_FALSE;
+    queue->failed = SDL_FALSE;
+    queue->next = NULL;
+    return SDL_TRUE;
+}
+
+void decode_pool_queue_destroy(struct decode_pool_queue *queue) {
+    SDL_assert(!queue->scheduled);
+    SDL_DestroyCond(queue->cond);
+}
+
+SDL_bool decode_pool_queue_push(struct decode_pool_queue *queue, void *packet) {
+    struct decode_pool *pool = queue->pool;
+
+    mutex_lock(pool->mutex);
+    while (queue->count == DECODE_POOL_QUEUE_SIZE && !queue->failed) {
+        cond_wait(queue->cond, pool->mutex);
+    }
+    if (queue->failed) {
+        mutex_unlock(pool->mutex);
+        return SDL_FALSE;
+    }
+
+    unsigned index = (queue->head + queue->count) % DECODE_POOL_QUEUE_SIZE;
+    queue->packets[index] = packet;
+    ++queue->count;
+    if (!queue->scheduled) {
+        queue->scheduled = SDL_TRUE;
+        schedule(pool, queue);
+    }
+    mutex_unlock(pool->mutex);
+    return SDL_TRUE;
+}
+
+SDL_bool decode_pool_queue_drain(struct decode_pool_queue *queue) {
+    struct decode_pool *pool = queue->pool;
+
+    mutex_lock(pool->mutex);
+    while (queue->scheduled) {
+        cond_wait(queue->cond, pool->mutex);
+    }
+    SDL_bool ok = !queue->failed;
+    mutex_unlock(pool->mutex);
+    return ok;
+}
@@ -0,0 +1,73 @@
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_stdinc.h>
+#include <SDL2/SDL_thread.h>
+
+// Decode the packets of several devices on a fixed number of worker threads.
+//
+// Each device (decoder) has its own queue of packets, filled by its demuxer
+// thread. A queue is decoded by at most one worker at a time, so the packets
+// of a device are decoded in order; a worker takes one packet, then puts the
+// queue back at the end of the run queue, so that a device streaming many
+// packets does not starve the others.
+
+// packets waiting to be decoded, per device
+#define DECODE_POOL_QUEUE_SIZE 16
+
+// takes ownership of the packet; after a failure, the remaining packets of
+// the queue are still passed (to be released)
+typedef SDL_bool (*decode_pool_fn)(void *opaque, void *packet);
+
+struct decode_pool;
+
+struct decode_pool_queue {
+    struct decode_pool *pool;
+    decode_pool_fn decode;
+    void *opaque;
+    SDL_cond *cond; // signaled when a packet has been decoded
+    // circular: packets [head, head + count) are waiting
+    void *packets[DECODE_POOL_QUEUE_SIZE];
+    unsigned head;
+    unsigned count;
+    // in the run queue, or being decoded by a worker
+    SDL_bool scheduled;
+    SDL_bool failed;
+    struct decode_pool_queue *next; // in the run queue
+};
+
+struct decode_pool {
+    SDL_mutex *mutex;
+    SDL_cond *cond; // signaled when a queue is scheduled, or on stop
+    SDL_Thread **threads;
+    unsigned thread_count;
+    // the queues having packets, not being decoded
+    struct decode_pool_queue *head;
+    struct decode_pool_queue *tail;
+    SDL_bool stopped;
+};
+
+SDL_bool decode_pool_init(struct decode_pool *pool, unsigned thread_count);
+void decode_pool_destroy(struct decode_pool *pool);
+
+SDL_bool decode_pool_start(struct decode_pool *pool);
+// all the queues must be drained before
+void decode_pool_stop(struct decode_pool *pool);
+void decode_pool_join(struct decode_pool *pool);
+
+SDL_bool decode_pool_queue_init(struct decode_pool_queue *queue,
+                                struct decode_pool *pool,
+                                decode_pool_fn decode, void *opaque);
+void decode_pool_queue_destroy(struct decode_pool_queue *queue);
+
+// block while the queue is full
+// return SDL_FALSE if a packet of the queue could not be decoded (the caller
+// keeps the ownership of the packet)
+SDL_bool decode_pool_queue_push(struct decode_pool_queue *queue, void *packet);
+
+// wait until all the pushed packets are decoded
+// return SDL_FALSE if any of them could not be decoded
+SDL_bool decode_pool_queue_drain(struct decode_pool_queue *queue);
+
+#endif
@@ -24,6 +24,11 @@ extern volatile int quited;
 #define HEADER_SIZE 12
 #define NO_PTS UINT64_C(-1)
 
+// a frame repeated by the encoder (KEY_REPEAT_PREVIOUS_FRAME_AFTER) is a
+// non-key frame only made of skipped blocks, so its packet is tiny; only the
+// frames decoded from such packets are compared to the previous one
+#define REPEATED_FRAME_MAX_PACKET_SIZE 512
+
 static struct frame_meta *frame_meta_new(uint64_t pts) {
     struct frame_meta *meta = malloc(sizeof(*meta));
     if (!meta) {
@@ -64,6 +69,66 @@ static uint64_t receiver_state_take_meta(struct receiver_state *state) {
     return pts;
 }
 
+// the receive path depends on the stream format and on the build options
+static SDL_bool receiver_state_init(struct decoder *decoder) {
+    struct receiver_state *state = &decoder->receiver_state;
+    state->frame_meta_queue = NULL;
+    state->remaining = 0;
+#ifdef IO_URING
+    if (decoder->uring_reader) {
+        // the chunks already serve the small reads from memory
+        return uring_stream_init(&state->uring_stream, decoder->uring_reader,
+                                 decoder->video_socket);
+    }
+#endif
+    // without meta headers, avio already reads large chunks directly
+    return !decoder->frame_meta
+        || recv_buffer_init(&state->recv_buffer, decoder->video_socket,
+                            BUFSIZE);
+}
+
+static void receiver_state_destroy(struct decoder *decoder) {
+    struct receiver_state *state = &decoder->receiver_state;
+#ifdef IO_URING
+    if (decoder->uring_reader) {
+        uring_stream_destroy(&state->uring_stream);
+        return;
+    }
+#endif
+    if (decoder->frame_meta) {
+        recv_buffer_destroy(&state->recv_buffer);
+    }
+}
+
+static ssize_t receive(struct decoder *decoder, void *buf, size_t len) {
+    struct receiver_state *state = &decoder->receiver_state;
+#ifdef IO_URING
+    if (decoder->uring_reader) {
+        return uring_stream_read(&state->uring_stream, buf, len);
+    }
+#endif
+    if (decoder->frame_meta) {
+        return recv_buffer_read(&state->recv_buffer, buf, len);
+    }
+    return net_recv(decoder->video_socket, buf, len);
+}
+
+// read len bytes (less only on EOF)
+static ssize_t receive_all(struct decoder *decoder, void *buf, size_t len) {
+    size_t copied = 0;
+    while (copied < len) {
+        ssize_t r = receive(decoder, (uint8_t *) buf + copied, len - copied);
+        if (r == -1) {
+            return -1;
+        }
+        if (!r) {
+            break;
+        }
+        copied += r;
+    }
+    return copied;
+}
+
 static int read_packet_with_meta(void *opaque, uint8_t *buf, int buf_size) {
     struct decoder *decoder = opaque;
     struct receiver_state *state = &decoder->receiver_state;
@@ -83,20 +148,25 @@ static int read_packet_with_meta(void *opaque, uint8_t *buf, int buf_size) {
     if (!state->remaining) {
 #define HEADER_SIZE 12
         uint8_t header[HEADER_SIZE];
-        ssize_t r = net_recv_all(decoder->video_socket, header, HEADER_SIZE);
+        ssize_t r = receive_all(decoder, header, HEADER_SIZE);
         if (r == -1) {
             return AVERROR(errno);
         }
         if (r == 0) {
             return AVERROR_EOF;
         }
-        // no partial read (net_recv_all())
-        SDL_assert_release(r == HEADER_SIZE);
+        if (r < HEADER_SIZE) {
+            // partial header
+            return AVERROR_EOF;
+        }
 
         uint64_t pts = buffer_read64be(header);
-        state->remaining = buffer_read32be(&header[8]);
+        uint32_t size = buffer_read32be(&header[8]);
+        state->remaining = size;
 
-        if (pts != NO_PTS && !receiver_state_push_meta(state, pts)) {
+        // the PTS are only needed for recording
+        if (decoder->recorder && pts != NO_PTS
+                && !receiver_state_push_meta(state, pts)) {
             LOGE("Could not store PTS for recording");
             // we cannot save the PTS, the recording would be broken
             return AVERROR(ENOMEM);
@@ -108,7 +178,7 @@ static int read_packet_with_meta(void *opaque, uint8_t *buf, int buf_size) {
     if (buf_size > state->remaining)
         buf_size = state->remaining;
 
-    ssize_t r = net_recv(decoder->video_socket, buf, buf_size);
+    ssize_t r = receive(decoder, buf, buf_size);
     if (r == -1) {
         return AVERROR(errno);
     }
@@ -124,7 +194,7 @@ static int read_packet_with_meta(void *opaque, uint8_t *buf, int buf_size) {
 
 static int read_raw_packet(void *opaque, uint8_t *buf, int buf_size) {
     struct decoder *decoder = opaque;
-    ssize_t r = net_recv(decoder->video_socket, buf, buf_size);
+    ssize_t r = receive(decoder, buf, buf_size);
     if (r == -1) {
         return AVERROR(errno);
     }
@@ -141,18 +211,104 @@ static void push_frame(struct decoder *decoder) {
         // the previous EVENT_NEW_FRAME will consume this frame
         return;
     }
-    static SDL_Event new_frame_event = {
-        .type = EVENT_NEW_FRAME,
-    };
+    SDL_Event new_frame_event;
+    new_frame_event.type = EVENT_NEW_FRAME;
+    new_frame_event.user.data1 = decoder;
     SDL_PushEvent(&new_frame_event);
 }
 
-static void notify_stopped(void) {
+// the decoding frame has just been decoded from the packet
+static void process_frame(struct decoder *decoder, const AVPacket *packet) {
+    if (decoder->recorder) {
+        recorder_write_thumbnail(decoder->recorder,
+                                 decoder->frames->decoding_frame, packet->pts);
+    }
+    SDL_bool may_repeat = !(packet->flags & AV_PKT_FLAG_KEY)
+                       && packet->size <= REPEATED_FRAME_MAX_PACKET_SIZE;
+    if (may_repeat && frames_drop_repeated_frame(decoder->frames)) {
+        // the device screen did not change
+        return;
+    }
+#ifdef FRAME_SINK
+    if (decoder->frame_sink) {
+        // before the frame is offered, the renderer does not access it
+        frame_sink_publish(decoder->frame_sink,
+                           decoder->frames->decoding_frame);
+    }
+#endif
+    push_frame(decoder);
+}
+
+static void notify_stopped(struct decoder *decoder) {
     SDL_Event stop_event;
     stop_event.type = EVENT_DECODER_STOPPED;
+    stop_event.user.data1 = decoder;
     SDL_PushEvent(&stop_event);
 }
 
+static SDL_bool decode_packet(struct decoder *decoder, AVPacket *packet) {
+    AVCodecContext *codec_ctx = decoder->codec_ctx;
+// the new decoding/encoding API has been introduced by:
+// <http://git.videolan.org/?p=ffmpeg.git;a=commitdiff;h=7fc329e2dd6226dfecaa4a1d7adf353bf2773726>
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 0)
+    int ret;
+    if ((ret = avcodec_send_packet(codec_ctx, packet)) < 0) {
+        LOGE("Could not send video packet: %d", ret);
+        return SDL_FALSE;
+    }
+    ret = avcodec_receive_frame(codec_ctx, decoder->frames->decoding_frame);
+    if (!ret) {
+        // a frame was received
+        process_frame(decoder, packet);
+    } else if (ret != AVERROR(EAGAIN)) {
+        LOGE("Could not receive video frame: %d", ret);
+        return SDL_FALSE;
+    }
+#else
+    // consume a copy, the packet may still be recorded
+    AVPacket remaining = *packet;
+    while (remaining.size > 0) {
+        int got_picture;
+        int len = avcodec_decode_video2(codec_ctx, decoder->frames->decoding_frame, &got_picture, &remaining);
+        if (len < 0) {
+            LOGE("Could not decode video packet: %d", len);
+            return SDL_FALSE;
+        }
+        if (got_picture) {
+            process_frame(decoder, packet);
+        }
+        remaining.size -= len;
+        remaining.data += len;
+    }
+#endif
+    return SDL_TRUE;
+}
+
+// called by a worker of the decode pool
+static SDL_bool decode_pooled_packet(void *opaque, void *data) {
+    struct decoder *decoder = opaque;
+    AVPacket *packet = data;
+    SDL_bool ok = decode_packet(decoder, packet);
+    av_packet_free(&packet);
+    return ok;
+}
+
+// hand the packet over to the decode pool (the content of packet is moved)
+static SDL_bool push_packet(struct decoder *decoder, AVPacket *packet) {
+    AVPacket *pooled = av_packet_alloc();
+    if (!pooled) {
+        LOGC("Could not allocate packet");
+        return SDL_FALSE;
+    }
+    av_packet_move_ref(pooled, packet);
+    if (!decode_pool_queue_push(&decoder->decode_queue, pooled)) {
+        // a previous packet could not be decoded
+        av_packet_free(&pooled);
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
 static int run_decoder(void *data) {
     struct decoder *decoder = data;
 
@@ -172,11 +328,20 @@ static int run_decoder(void *data) {
         LOGE("Could not open H.264 codec");
         goto run_finally_free_codec_ctx;
     }
+    decoder->codec_ctx = codec_ctx;
+
+    if (decoder->decode_pool
+            && !decode_pool_queue_init(&decoder->decode_queue,
+                                       decoder->decode_pool,
+                                       decode_pooled_packet, decoder)) {
+        LOGC("Could not initialize the decode queue");
+        goto run_finally_close_codec;
+    }
 
     AVFormatContext *format_ctx = avformat_alloc_context();
     if (!format_ctx) {
         LOGC("Could not allocate format context");
-        goto run_finally_close_codec;
+        goto run_finally_destroy_decode_queue;
     }
 
     unsigned char *buffer = av_malloc(BUFSIZE);
@@ -185,13 +350,15 @@ static int run_decoder(void *data) {
         goto run_finally_free_format_ctx;
     }
 
-    // initialize the receiver state
-    decoder->receiver_state.frame_meta_queue = NULL;
-    decoder->receiver_state.remaining = 0;
+    if (!receiver_state_init(decoder)) {
+        LOGC("Could not initialize the video receiver");
+        av_free(buffer);
+        goto run_finally_free_format_ctx;
+    }
 
     // if recording is enabled, a "header" is sent between raw packets
     int (*read_packet)(void *, uint8_t *, int) =
-            decoder->recorder ? read_packet_with_meta : read_raw_packet;
+            decoder->frame_meta ? read_packet_with_meta : read_raw_packet;
     AVIOContext *avio_ctx = avio_alloc_context(buffer, BUFSIZE, 0, decoder,
                                                read_packet, NULL, NULL);
     if (!avio_ctx) {
@@ -199,6 +366,7 @@ static int run_decoder(void *data) {
         // avformat_open_input takes ownership of 'buffer'
         // so only free the buffer before avformat_open_input()
         av_free(buffer);
+        receiver_state_destroy(decoder);
         goto run_finally_free_format_ctx;
     }
 
@@ -221,47 +389,23 @@ static int run_decoder(void *data) {
     packet.size = 0;
 
     while (!av_read_frame(format_ctx, &packet)) {
-// the new decoding/encoding API has been introduced by:
-// <http://git.videolan.org/?p=ffmpeg.git;a=commitdiff;h=7fc329e2dd6226dfecaa4a1d7adf353bf2773726>
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 0)
-        int ret;
-        if ((ret = avcodec_send_packet(codec_ctx, &packet)) < 0) {
-            LOGE("Could not send video packet: %d", ret);
-            goto run_quit;
-        }
-        ret = avcodec_receive_frame(codec_ctx, decoder->frames->decoding_frame);
-        if (!ret) {
-            // a frame was received
-            push_frame(decoder);
-        } else if (ret != AVERROR(EAGAIN)) {
-            LOGE("Could not receive video frame: %d", ret);
-            av_packet_unref(&packet);
-            goto run_quit;
-        }
-#else
-        while (packet.size > 0) {
-            int got_picture;
-            int len = avcodec_decode_video2(codec_ctx, decoder->frames->decoding_frame, &got_picture, &packet);
-            if (len < 0) {
-                LOGE("Could not decode video packet: %d", len);
-                av_packet_unref(&packet);
-                goto run_quit;
-            }
-            if (got_picture) {
-                push_frame(decoder);
-            }
-            packet.size -= len;
-            packet.data += len;
-        }
-#endif
-
         if (decoder->recorder) {
             // we retrieve the PTS in order they were received, so they will
             // be assigned to the correct frame
             uint64_t pts = receiver_state_take_meta(&decoder->receiver_state);
             packet.pts = pts;
             packet.dts = pts;
+        }
+
+        SDL_bool ok = decoder->decode_pool
+                    ? push_packet(decoder, &packet)
+                    : decode_packet(decoder, &packet);
+        if (!ok) {
+            av_packet_unref(&packet);
+            goto run_quit;
+        }
 
+        if (decoder->recorder) {
             // no need to rescale with av_packet_rescale_ts(), the timestamps
             // are in microseconds both in input and output
             if (!recorder_write(decoder->recorder, &packet)) {
@@ -293,23 +437,47 @@ run_finally_close_input:
     avformat_close_input(&format_ctx);
 run_finally_free_avio_ctx:
     av_freep(&avio_ctx);
+    receiver_state_destroy(decoder);
 run_finally_free_format_ctx:
     avformat_free_context(format_ctx);
+run_finally_destroy_decode_queue:
+    if (decoder->decode_pool) {
+        // the codec is used until the last pushed packet is decoded
+        decode_pool_queue_drain(&decoder->decode_queue);
+        decode_pool_queue_destroy(&decoder->decode_queue);
+    }
 run_finally_close_codec:
     avcodec_close(codec_ctx);
 run_finally_free_codec_ctx:
     avcodec_free_context(&codec_ctx);
-    notify_stopped();
+    notify_stopped(decoder);
 run_end:
     return 0;
 }
 
 void decoder_init(struct decoder *decoder, struct frames *frames, struct screen *screen,
-                  socket_t video_socket, struct recorder *recorder) {
+                  socket_t video_socket, struct recorder *recorder,
+                  SDL_bool frame_meta, struct uring_reader *uring_reader,
+                  struct decode_pool *decode_pool,
+                  struct frame_sink *frame_sink) {
+    SDL_assert(frame_meta || !recorder);
+    SDL_assert(!decode_pool || !recorder);
     decoder->frames = frames;
     decoder->screen = screen;
     decoder->video_socket = video_socket;
     decoder->recorder = recorder;
+#ifdef FRAME_SINK
+    decoder->frame_sink = frame_sink;
+#else
+    (void) frame_sink;
+#endif
+    decoder->frame_meta = frame_meta;
+#ifdef IO_URING
+    decoder->uring_reader = uring_reader;
+#else
+    (void) uring_reader;
+#endif
+    decoder->decode_pool = decode_pool;
 }
 
 SDL_bool decoder_start(struct decoder *decoder) {
@@ -5,9 +5,23 @@
 #include <SDL2/SDL_thread.h>
 
 #include "common.h"
+#include "config.h"
+#include "decode_pool.h"
 #include "net.h"
+#include "recv_buffer.h"
+#ifdef IO_URING
+# include "uring_reader.h"
+#endif
+#ifdef FRAME_SINK
+# include "frame_sink.h"
+#endif
+
+// forward declarations
+typedef struct AVCodecContext AVCodecContext;
 
 struct frames;
+struct frame_sink;
+struct uring_reader;
 
 struct frame_meta {
     uint64_t pts;
@@ -21,15 +35,39 @@ struct decoder {
     SDL_Thread *thread;
     SDL_mutex *mutex;
     struct recorder *recorder;
+#ifdef FRAME_SINK
+    struct frame_sink *frame_sink; // NULL not to publish the frames
+#endif
+    SDL_bool frame_meta; // a meta header precedes each packet
+#ifdef IO_URING
+    struct uring_reader *uring_reader; // NULL to read with recv()
+#endif
+    AVCodecContext *codec_ctx;
+    // NULL to decode on the decoder thread, otherwise the decoder thread only
+    // demuxes, and the packets are decoded by the pool
+    struct decode_pool *decode_pool;
+    struct decode_pool_queue decode_queue; // if decode_pool is set
     struct receiver_state {
         // meta (in order) for frames not consumed yet
         struct frame_meta *frame_meta_queue;
         size_t remaining; // remaining bytes to receive for the current frame
+        // the headers and the small packets are served from memory
+        struct recv_buffer recv_buffer;
+#ifdef IO_URING
+        struct uring_stream uring_stream; // if uring_reader is set
+#endif
     } receiver_state;
 };
 
+// frame_meta must be enabled for recording
+// uring_reader may be NULL (it is ignored if IO_URING is not enabled)
+// decode_pool may be NULL, it is not supported for recording
+// frame_sink may be NULL (it is ignored if FRAME_SINK is not enabled)
 void decoder_init(struct decoder *decoder, struct frames *frames, struct screen *screen,
-                  socket_t video_socket, struct recorder *recoder);
+                  socket_t video_socket, struct recorder *recoder,
+                  SDL_bool frame_meta, struct uring_reader *uring_reader,
+                  struct decode_pool *decode_pool,
+                  struct frame_sink *frame_sink);
 SDL_bool decoder_start(struct decoder *decoder);
 void decoder_stop(struct decoder *decoder);
 void decoder_join(struct decoder *decoder);
@@ -0,0 +1,47 @@
+#include "device_message.h"
+
+#include <string.h>
+
+#include "buffer_util.h"
+#include "log.h"
+
+ssize_t device_message_deserialize(const unsigned char *buf, size_t len,
+                                   struct device_message *msg) {
+    if (len < DEVICE_MESSAGE_HEADER_SIZE) {
+        // at least the header is needed
+        return 0;
+    }
+
+    msg->type = buf[0];
+    switch (msg->type) {
+        case DEVICE_MESSAGE_TYPE_CLIPBOARD: {
+            Uint32 text_len = buffer_read32be(&buf[1]);
+            if (text_len > DEVICE_MESSAGE_TEXT_MAX_LENGTH) {
+                LOGE("Invalid device clipboard length: %lu",
+                     (unsigned long) text_len);
+                return -1;
+            }
+            if (len < DEVICE_MESSAGE_HEADER_SIZE + text_len) {
+                return 0;
+            }
+            char *text = SDL_malloc(text_len + 1);
+            if (!text) {
+                LOGC("Could not allocate device clipboard text");
+                return -1;
+            }
+            memcpy(text, &buf[DEVICE_MESSAGE_HEADER_SIZE], text_len);
+            text[text_len] = '\0';
+            msg->clipboard_message.text = text;
+            return DEVICE_MESSAGE_HEADER_SIZE + text_len;
+        }
+        default:
+            LOGE("Unknown device message type: %d", (int) msg->type);
+            return -1;
+    }
+}
+
+void device_message_destroy(struct device_message *msg) {
+    if (msg->type == DEVICE_MESSAGE_TYPE_CLIPBOARD) {
+        SDL_free(msg->clipboard_message.text);
+    }
+}
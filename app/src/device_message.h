@@ -0,0 +1,37 @@
+#ifndef DEVICEMESSAGE_H
+#define DEVICEMESSAGE_H
+
+#include <SDL2/SDL_stdinc.h>
+#include <sys/types.h>
+
+#include "control_event.h"
+
+// type (1 byte) + length (4 bytes) + text
+#define DEVICE_MESSAGE_HEADER_SIZE 5
+// same limit as from the computer to the device
+#define DEVICE_MESSAGE_TEXT_MAX_LENGTH CLIPBOARD_TEXT_MAX_LENGTH
+#define DEVICE_MESSAGE_MAX_SIZE \
+    (DEVICE_MESSAGE_HEADER_SIZE + DEVICE_MESSAGE_TEXT_MAX_LENGTH)
+
+// the messages sent by the device on the control socket
+enum device_message_type {
+    DEVICE_MESSAGE_TYPE_CLIPBOARD,
+};
+
+struct device_message {
+    enum device_message_type type;
+    union {
+        struct {
+            char *text; // owned, to be freed by SDL_free()
+        } clipboard_message;
+    };
+};
+
+// return the number of bytes consumed, 0 if the message is not complete yet,
+// or -1 if the data is invalid
+ssize_t device_message_deserialize(const unsigned char *buf, size_t len,
+                                   struct device_message *msg);
+
+void device_message_destroy(struct device_message *msg);
+
+#endif
@@ -0,0 +1,24 @@
+#include "direct_connection.h"
+
+#include <string.h>
+#include <SDL2/SDL_assert.h>
+
+socket_t direct_connect(Uint32 addr, Uint16 port, const char *token,
+                        const struct net_socket_options *options) {
+    SDL_assert(strlen(token) == DIRECT_TOKEN_LENGTH);
+
+    socket_t socket = net_connect(addr, port, options);
+    if (socket == INVALID_SOCKET) {
+        return INVALID_SOCKET;
+    }
+
+    char ack;
+    if (net_send_all(socket, token, DIRECT_TOKEN_LENGTH) == -1
+            || net_recv_all(socket, &ack, 1) != 1) {
+        // the server closes the connection if the token is wrong
+        net_close(socket);
+        return INVALID_SOCKET;
+    }
+
+    return socket;
+}
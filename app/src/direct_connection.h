@@ -0,0 +1,23 @@
+#ifndef DIRECT_CONNECTION_H
+#define DIRECT_CONNECTION_H
+
+#include <SDL2/SDL_stdinc.h>
+
+#include "net.h"
+
+// The server may listen on a TCP port of the device (typically reachable over
+// Wi-Fi), so that the streams do not go through the adb tunnel. Since anyone
+// on the network could connect, the client must first send a one-time token,
+// passed to the server on the command line (through adb).
+//
+// Once the token is accepted, the server sends one byte (0).
+
+#define DIRECT_TOKEN_LENGTH 32 // hexadecimal characters
+
+// connect to the server, and authenticate
+// return INVALID_SOCKET if the server is not reachable or rejected the token
+// options may be NULL
+socket_t direct_connect(Uint32 addr, Uint16 port, const char *token,
+                        const struct net_socket_options *options);
+
+#endif
@@ -1,3 +1,7 @@
 #define EVENT_NEW_SESSION SDL_USEREVENT
-#define EVENT_NEW_FRAME (SDL_USEREVENT + 1)
-#define EVENT_DECODER_STOPPED (SDL_USEREVENT + 2)
+#define EVENT_NEW_FRAME (SDL_USEREVENT + 1) // data1: decoder
+#define EVENT_DECODER_STOPPED (SDL_USEREVENT + 2) // data1: decoder
+// data1: text, to be freed, data2: receiver
+#define EVENT_DEVICE_CLIPBOARD (SDL_USEREVENT + 3)
+#define EVENT_HID_SETUP_DONE (SDL_USEREVENT + 4) // data1: session
+#define EVENT_PRESENT (SDL_USEREVENT + 5) // data1: present scheduler
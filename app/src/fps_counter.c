@@ -14,6 +14,7 @@ void fps_counter_start(struct fps_counter *counter) {
     counter->started = SDL_TRUE;
     counter->slice_start = SDL_GetTicks();
     counter->nr_rendered = 0;
+    counter->nr_repeated = 0;
 #ifdef SKIP_FRAMES
     counter->nr_skipped = 0;
 #endif
@@ -24,15 +25,21 @@ void fps_counter_stop(struct fps_counter *counter) {
 }
 
 static void display_fps(struct fps_counter *counter) {
+    int nr_skipped = 0;
 #ifdef SKIP_FRAMES
-    if (counter->nr_skipped) {
-        LOGI("%d fps (+%d frames skipped)", counter->nr_rendered, counter->nr_skipped);
-    } else {
+    nr_skipped = counter->nr_skipped;
 #endif
-    LOGI("%d fps", counter->nr_rendered);
-#ifdef SKIP_FRAMES
+    if (nr_skipped && counter->nr_repeated) {
+        LOGI("%d fps (+%d frames skipped, +%d frames repeated)",
+             counter->nr_rendered, nr_skipped, counter->nr_repeated);
+    } else if (nr_skipped) {
+        LOGI("%d fps (+%d frames skipped)", counter->nr_rendered, nr_skipped);
+    } else if (counter->nr_repeated) {
+        LOGI("%d fps (+%d frames repeated)", counter->nr_rendered,
+             counter->nr_repeated);
+    } else {
+        LOGI("%d fps", counter->nr_rendered);
     }
-#endif
 }
 
 static void check_expired(struct fps_counter *counter) {
@@ -43,6 +50,7 @@ static void check_expired(struct fps_counter *counter) {
         Uint32 elapsed_slices = (now - counter->slice_start) / 1000;
         counter->slice_start += 1000 * elapsed_slices;
         counter->nr_rendered = 0;
+        counter->nr_repeated = 0;
 #ifdef SKIP_FRAMES
         counter->nr_skipped = 0;
 #endif
@@ -54,6 +62,11 @@ void fps_counter_add_rendered_frame(struct fps_counter *counter) {
     ++counter->nr_rendered;
 }
 
+void fps_counter_add_repeated_frame(struct fps_counter *counter) {
+    check_expired(counter);
+    ++counter->nr_repeated;
+}
+
 #ifdef SKIP_FRAMES
 void fps_counter_add_skipped_frame(struct fps_counter *counter) {
     check_expired(counter);
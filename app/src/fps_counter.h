@@ -9,6 +9,7 @@ struct fps_counter {
     SDL_bool started;
     Uint32 slice_start; // initialized by SDL_GetTicks()
     int nr_rendered;
+    int nr_repeated; // identical to the previous one, not rendered
 #ifdef SKIP_FRAMES
     int nr_skipped;
 #endif
@@ -19,6 +20,7 @@ void fps_counter_start(struct fps_counter *counter);
 void fps_counter_stop(struct fps_counter *counter);
 
 void fps_counter_add_rendered_frame(struct fps_counter *counter);
+void fps_counter_add_repeated_frame(struct fps_counter *counter);
 #ifdef SKIP_FRAMES
 void fps_counter_add_skipped_frame(struct fps_counter *counter);
 #endif
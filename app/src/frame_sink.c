@@ -0,0 +1,175 @@
+#define _DEFAULT_SOURCE
+#include "frame_sink.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <libavutil/frame.h>
+
+#include "log.h"
+
+// the pixels of each slot are aligned to a cache line
+#define ALIGNMENT 64
+#define ALIGN(x) (((x) + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1))
+
+static size_t get_pixels_size(Uint32 width, Uint32 height) {
+    size_t chroma_size = (size_t) ((width + 1) / 2) * ((height + 1) / 2);
+    return (size_t) width * height + 2 * chroma_size;
+}
+
+SDL_bool frame_sink_init(struct frame_sink *sink, const char *name,
+                         struct size frame_size) {
+    // the shared memory object names start with a single '/'
+    if (name[0] == '/') {
+        ++name;
+    }
+    if (!*name || strchr(name, '/')) {
+        LOGE("Invalid frame sink name: %s", name);
+        return SDL_FALSE;
+    }
+    int r = snprintf(sink->name, sizeof(sink->name), "/%s", name);
+    if (r < 0 || (size_t) r >= sizeof(sink->name)) {
+        LOGE("Frame sink name too long: %s", name);
+        return SDL_FALSE;
+    }
+
+    // a rotation swaps the width and the height, the size is the same
+    size_t capacity = ALIGN(get_pixels_size(frame_size.width,
+                                            frame_size.height));
+    size_t pixels_offset = ALIGN(sizeof(struct frame_sink_header));
+    sink->size = pixels_offset + FRAME_SINK_SLOTS * capacity;
+
+    int fd = shm_open(sink->name, O_CREAT | O_RDWR, 0600);
+    if (fd == -1) {
+        LOGE("Could not open shared memory %s: %s", sink->name,
+             strerror(errno));
+        return SDL_FALSE;
+    }
+    if (ftruncate(fd, sink->size)) {
+        LOGE("Could not resize shared memory %s: %s", sink->name,
+             strerror(errno));
+        goto error_close_and_unlink;
+    }
+    void *mem = mmap(NULL, sink->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                     0);
+    if (mem == MAP_FAILED) {
+        LOGE("Could not map shared memory %s: %s", sink->name,
+             strerror(errno));
+        goto error_close_and_unlink;
+    }
+    // the mapping remains valid
+    close(fd);
+
+    sink->header = mem;
+    struct frame_sink_header *header = sink->header;
+    header->magic = FRAME_SINK_MAGIC;
+    header->version = FRAME_SINK_VERSION;
+    header->slot_count = FRAME_SINK_SLOTS;
+    header->slot_capacity = capacity;
+    header->reserved = 0;
+    for (int i = 0; i < FRAME_SINK_SLOTS; ++i) {
+        struct frame_sink_slot *slot = &header->slots[i];
+        SDL_AtomicSet(&slot->sequence, 0);
+        slot->width = 0;
+        slot->height = 0;
+        slot->format = 0;
+        slot->timestamp = 0;
+        slot->offset = pixels_offset + i * capacity;
+        slot->size = 0;
+    }
+    // the object may exist from a previous run, reset it last
+    SDL_AtomicSet(&header->sequence, 0);
+
+    sink->sequence = 0;
+    sink->warned = SDL_FALSE;
+    LOGI("Publishing the frames to shared memory %s", sink->name);
+    return SDL_TRUE;
+
+error_close_and_unlink:
+    close(fd);
+    shm_unlink(sink->name);
+    return SDL_FALSE;
+}
+
+void frame_sink_destroy(struct frame_sink *sink) {
+    munmap(sink->header, sink->size);
+    shm_unlink(sink->name);
+}
+
+static Uint64 get_timestamp(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Uint64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static Uint8 *copy_plane(Uint8 *dst, const Uint8 *src, int linesize,
+                         Uint32 width, Uint32 height) {
+    // remove the padding of the lines
+    for (Uint32 y = 0; y < height; ++y) {
+        memcpy(dst, src + (size_t) y * linesize, width);
+        dst += width;
+    }
+    return dst;
+}
+
+void frame_sink_publish(struct frame_sink *sink, const AVFrame *frame) {
+    if (frame->format != AV_PIX_FMT_YUV420P
+            && frame->format != AV_PIX_FMT_YUVJ420P) {
+        if (!sink->warned) {
+            LOGW("Unsupported frame format for the frame sink: %d",
+                 frame->format);
+            sink->warned = SDL_TRUE;
+        }
+        return;
+    }
+    struct frame_sink_header *header = sink->header;
+    Uint32 width = frame->width;
+    Uint32 height = frame->height;
+    size_t size = get_pixels_size(width, height);
+    if (size > header->slot_capacity) {
+        if (!sink->warned) {
+            LOGW("Frame too large for the frame sink: %" PRIu32 "x%" PRIu32,
+                 width, height);
+            sink->warned = SDL_TRUE;
+        }
+        return;
+    }
+
+    // 0 means "no frame"
+    if (!++sink->sequence) {
+        sink->sequence = 1;
+    }
+    struct frame_sink_slot *slot =
+            &header->slots[sink->sequence % FRAME_SINK_SLOTS];
+
+    // the readers of the previous frame of this slot must see that it is being
+    // overwritten: SDL_AtomicSet() is (at least) an acquire barrier, the
+    // writes below are not reordered before it
+    SDL_AtomicSet(&slot->sequence, 0);
+    slot->width = width;
+    slot->height = height;
+    slot->format = FRAME_SINK_FORMAT_YUV420P;
+    slot->timestamp = get_timestamp();
+    slot->size = size;
+
+    Uint32 chroma_width = (width + 1) / 2;
+    Uint32 chroma_height = (height + 1) / 2;
+    Uint8 *dst = (Uint8 *) header + slot->offset;
+    dst = copy_plane(dst, frame->data[0], frame->linesize[0], width, height);
+    dst = copy_plane(dst, frame->data[1], frame->linesize[1], chroma_width,
+                     chroma_height);
+    copy_plane(dst, frame->data[2], frame->linesize[2], chroma_width,
+               chroma_height);
+
+    // SDL_AtomicSet() is not a release barrier: the frame must be visible
+    // before its sequence
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&slot->sequence, sink->sequence);
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&header->sequence, sink->sequence);
+}
@@ -0,0 +1,81 @@
+#ifndef FRAME_SINK_H
+#define FRAME_SINK_H
+
+#include <stddef.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_stdinc.h>
+
+#include "common.h"
+
+// Publish the decoded frames to a POSIX shared memory object (not available
+// on Windows), so that other local processes (typically test automation) may
+// grab the current screen without "adb screencap".
+//
+// The decoder copies every new frame (except the repeated ones) to the next
+// slot of a small ring, so that a reader copying a frame is not disturbed by
+// the next one. The memory is laid out as a struct frame_sink_header,
+// followed by the pixels of the slots.
+//
+// To read the latest frame, a reader:
+//  1. reads header->sequence (0 if no frame has been published yet);
+//  2. reads the slot (sequence % slot_count), and checks that its sequence is
+//     the same (otherwise, restart from 1);
+//  3. copies the pixels (slot->size bytes at slot->offset);
+//  4. issues an acquire fence (e.g. atomic_thread_fence(memory_order_acquire)
+//     or SDL_MemoryBarrierAcquire()), so that the copy is not reordered after
+//     the next read, then checks that the slot sequence is still the same
+//     (otherwise, the slot has been overwritten meanwhile: restart from 1).
+// The sequences are 32-bit integers, to be read with acquire semantics.
+
+// "SCFS", in native endianness
+#define FRAME_SINK_MAGIC 0x53465343
+#define FRAME_SINK_VERSION 1
+#define FRAME_SINK_SLOTS 3
+
+// the 3 planes (Y, U, V) are contiguous, without padding; the chroma planes
+// are subsampled by 2 in both dimensions (rounded up)
+#define FRAME_SINK_FORMAT_YUV420P 1
+
+struct frame_sink_slot {
+    SDL_atomic_t sequence; // 0 while being written
+    Uint32 width;
+    Uint32 height;
+    Uint32 format;
+    Uint64 timestamp; // CLOCK_MONOTONIC, in microseconds, when published
+    Uint32 offset; // of the pixels, from the start of the memory
+    Uint32 size; // of the pixels
+};
+
+struct frame_sink_header {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 slot_count;
+    Uint32 slot_capacity; // the maximum size of the pixels of a slot
+    SDL_atomic_t sequence; // of the last frame published, 0 if none
+    Uint32 reserved;
+    struct frame_sink_slot slots[FRAME_SINK_SLOTS];
+};
+
+// forward declarations
+typedef struct AVFrame AVFrame;
+
+struct frame_sink {
+    char name[256];
+    struct frame_sink_header *header; // the mapped memory
+    size_t size;
+    Uint32 sequence;
+    SDL_bool warned; // a frame could not be published
+};
+
+// create (or replace) the shared memory object (the leading '/' of the name
+// is optional), large enough for frames of frame_size (in any orientation)
+SDL_bool frame_sink_init(struct frame_sink *sink, const char *name,
+                         struct size frame_size);
+
+// unlink the shared memory object (the readers may still read their mapping)
+void frame_sink_destroy(struct frame_sink *sink);
+
+// copy the frame to the next slot, and make it the latest
+void frame_sink_publish(struct frame_sink *sink, const AVFrame *frame);
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <SDL2/SDL_assert.h>
 #include <SDL2/SDL_mutex.h>
+#include <string.h>
 #include <libavutil/avutil.h>
 #include <libavformat/avformat.h>
 
@@ -83,6 +84,48 @@ SDL_bool frames_offer_decoded_frame(struct frames *frames) {
     return previous_frame_consumed;
 }
 
+static SDL_bool planes_equal(const uint8_t *a, int a_linesize,
+                             const uint8_t *b, int b_linesize,
+                             int width, int height) {
+    // the lines may be padded differently
+    for (int y = 0; y < height; ++y) {
+        if (memcmp(a + y * a_linesize, b + y * b_linesize, width)) {
+            return SDL_FALSE;
+        }
+    }
+    return SDL_TRUE;
+}
+
+static SDL_bool frames_equal(const AVFrame *a, const AVFrame *b) {
+    if (a->format != AV_PIX_FMT_YUV420P || b->format != a->format
+            || a->width != b->width || a->height != b->height) {
+        return SDL_FALSE;
+    }
+    int chroma_width = (a->width + 1) / 2;
+    int chroma_height = (a->height + 1) / 2;
+    // most changes are in the luma plane, compare it first
+    return planes_equal(a->data[0], a->linesize[0], b->data[0], b->linesize[0],
+                        a->width, a->height)
+        && planes_equal(a->data[1], a->linesize[1], b->data[1], b->linesize[1],
+                        chroma_width, chroma_height)
+        && planes_equal(a->data[2], a->linesize[2], b->data[2], b->linesize[2],
+                        chroma_width, chroma_height);
+}
+
+SDL_bool frames_drop_repeated_frame(struct frames *frames) {
+    // the rendering frame is the last frame offered (consumed or not); the
+    // renderer only reads it, so it may be read concurrently without locking
+    if (!frames_equal(frames->decoding_frame, frames->rendering_frame)) {
+        return SDL_FALSE;
+    }
+    mutex_lock(frames->mutex);
+    if (frames->fps_counter.started) {
+        fps_counter_add_repeated_frame(&frames->fps_counter);
+    }
+    mutex_unlock(frames->mutex);
+    return SDL_TRUE;
+}
+
 const AVFrame *frames_consume_rendered_frame(struct frames *frames) {
     SDL_assert(!frames->rendering_frame_consumed);
     frames->rendering_frame_consumed = SDL_TRUE;
@@ -30,6 +30,12 @@ void frames_destroy(struct frames *frames);
 // returns true if the previous frame had been consumed
 SDL_bool frames_offer_decoded_frame(struct frames *frames);
 
+// return true if the decoding frame is identical to the last frame offered
+// (the device encoder repeats its previous frame while the screen is idle), in
+// which case it must not be offered: there is nothing to upload nor present
+// MUST be called from the decoder thread (the only one swapping the frames)
+SDL_bool frames_drop_repeated_frame(struct frames *frames);
+
 // mark the rendering frame as consumed and return it
 // MUST be called with frames->mutex locked!!!
 // the caller is expected to render the returned frame to some texture before
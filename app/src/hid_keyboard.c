@@ -0,0 +1,129 @@
+#include "hid_keyboard.h"
+
+#include <string.h>
+
+void hid_keyboard_init(struct hid_keyboard *kb) {
+    memset(kb, 0, sizeof(*kb));
+}
+
+// the modifiers of the last pressed key apply to the whole report
+static Uint8 current_modifiers(const struct hid_keyboard *kb) {
+    return kb->count ? kb->pressed[kb->count - 1].modifiers : 0;
+}
+
+static int find_key(const struct hid_keyboard *kb, Uint8 usage) {
+    for (unsigned i = 0; i < kb->count; ++i) {
+        if (kb->pressed[i].usage == usage) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static SDL_bool is_touched(const struct hid_keyboard *kb, Uint8 usage) {
+    return !!(kb->touched[usage >> 3] & (1 << (usage & 7)));
+}
+
+static void touch(struct hid_keyboard *kb, Uint8 usage) {
+    kb->touched[usage >> 3] |= 1 << (usage & 7);
+    kb->dirty = SDL_TRUE;
+}
+
+static void write_report(const struct hid_keyboard *kb,
+                         unsigned char *report) {
+    memset(report, 0, HID_KEYBOARD_REPORT_SIZE);
+    report[0] = HID_KEYBOARD_REPORT_ID;
+    report[1] = current_modifiers(kb);
+    // report[2] is reserved
+    if (kb->count > HID_KEYBOARD_KEYS) {
+        // the state cannot be reported
+        memset(&report[3], HID_ERROR_ROLL_OVER, HID_KEYBOARD_KEYS);
+    } else {
+        for (unsigned i = 0; i < kb->count; ++i) {
+            report[3 + i] = kb->pressed[i].usage;
+        }
+    }
+}
+
+SDL_bool hid_keyboard_take_report(struct hid_keyboard *kb,
+                                  unsigned char *report) {
+    if (!kb->dirty) {
+        return SDL_FALSE;
+    }
+    write_report(kb, report);
+    memset(kb->touched, 0, sizeof(kb->touched));
+    kb->reported_modifiers = current_modifiers(kb);
+    kb->dirty = SDL_FALSE;
+    return SDL_TRUE;
+}
+
+// a change may not be merged if it affects a key or the modifiers already
+// changed since the last report: the intermediate state would be lost
+static SDL_bool conflicts(const struct hid_keyboard *kb,
+                          const struct hid_keyboard *next, Uint8 usage) {
+    if (is_touched(kb, usage)) {
+        return SDL_TRUE;
+    }
+    Uint8 modifiers = current_modifiers(kb);
+    return modifiers != kb->reported_modifiers
+        && current_modifiers(next) != modifiers;
+}
+
+static SDL_bool apply_press(struct hid_keyboard *kb, Uint8 usage,
+                            Uint8 modifiers) {
+    int index = find_key(kb, usage);
+    if (index != -1) {
+        // already pressed (auto-repeat is handled by the device)
+        return SDL_FALSE;
+    }
+    if (kb->count == HID_KEYBOARD_MAX_PRESSED) {
+        return SDL_FALSE;
+    }
+    struct hid_key *key = &kb->pressed[kb->count++];
+    key->usage = usage;
+    key->modifiers = modifiers;
+    touch(kb, usage);
+    return SDL_TRUE;
+}
+
+static SDL_bool apply_release(struct hid_keyboard *kb, Uint8 usage) {
+    int index = find_key(kb, usage);
+    if (index == -1) {
+        return SDL_FALSE;
+    }
+    --kb->count;
+    memmove(&kb->pressed[index], &kb->pressed[index + 1],
+            (kb->count - index) * sizeof(kb->pressed[0]));
+    touch(kb, usage);
+    return SDL_TRUE;
+}
+
+SDL_bool hid_keyboard_press(struct hid_keyboard *kb, Uint8 usage,
+                            Uint8 modifiers, unsigned char *flushed) {
+    struct hid_keyboard next = *kb;
+    if (!apply_press(&next, usage, modifiers)) {
+        return SDL_FALSE;
+    }
+    if (!conflicts(kb, &next, usage)) {
+        *kb = next;
+        return SDL_FALSE;
+    }
+    hid_keyboard_take_report(kb, flushed);
+    apply_press(kb, usage, modifiers);
+    return SDL_TRUE;
+}
+
+SDL_bool hid_keyboard_release(struct hid_keyboard *kb, Uint8 usage,
+                              unsigned char *flushed) {
+    struct hid_keyboard next = *kb;
+    if (!apply_release(&next, usage)) {
+        return SDL_FALSE;
+    }
+    if (!conflicts(kb, &next, usage)) {
+        *kb = next;
+        return SDL_FALSE;
+    }
+    hid_keyboard_take_report(kb, flushed);
+    apply_release(kb, usage);
+    return SDL_TRUE;
+}
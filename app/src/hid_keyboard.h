@@ -0,0 +1,55 @@
+#ifndef HID_KEYBOARD_H
+#define HID_KEYBOARD_H
+
+#include <SDL2/SDL_stdinc.h>
+
+// the keyboard report, as declared in the HID report descriptor:
+//  - report id (1)
+//  - modifiers (bitmask)
+//  - reserved
+//  - up to 6 pressed keys (usage ids)
+#define HID_KEYBOARD_REPORT_ID 1
+#define HID_KEYBOARD_KEYS 6
+#define HID_KEYBOARD_REPORT_SIZE (3 + HID_KEYBOARD_KEYS)
+
+// reported in all the key slots when more than HID_KEYBOARD_KEYS are pressed
+#define HID_ERROR_ROLL_OVER 0x01
+
+// the keys pressed beyond this limit are ignored
+#define HID_KEYBOARD_MAX_PRESSED 16
+
+struct hid_key {
+    Uint8 usage;
+    Uint8 modifiers; // the modifiers this key must be reported with
+};
+
+// Track the state of the HID keyboard, to send one report per state change
+// instead of a press report immediately followed by a release report.
+//
+// Several changes may be merged into a single report, unless a change would
+// hide a previous one not reported yet (e.g. a key pressed then released).
+struct hid_keyboard {
+    struct hid_key pressed[HID_KEYBOARD_MAX_PRESSED]; // in press order
+    unsigned count;
+    Uint8 reported_modifiers;
+    Uint8 touched[32]; // bitmap of the usages changed since the last report
+    SDL_bool dirty; // the state changed since the last report
+};
+
+void hid_keyboard_init(struct hid_keyboard *kb);
+
+// Press or release a key.
+//
+// If the change cannot be merged with the pending ones, the report of the
+// pending state is written to flushed (HID_KEYBOARD_REPORT_SIZE bytes), and
+// SDL_TRUE is returned: it must be sent before the next one.
+SDL_bool hid_keyboard_press(struct hid_keyboard *kb, Uint8 usage,
+                            Uint8 modifiers, unsigned char *flushed);
+SDL_bool hid_keyboard_release(struct hid_keyboard *kb, Uint8 usage,
+                              unsigned char *flushed);
+
+// write the report of the current state, if it changed since the last report
+SDL_bool hid_keyboard_take_report(struct hid_keyboard *kb,
+                                  unsigned char *report);
+
+#endif
@@ -0,0 +1,53 @@
+#include "hid_pointer.h"
+
+#include "buffer_util.h"
+
+const unsigned char HID_POINTER_REPORT_DESC[] = {
+    0x05, 0x0D, // Usage Page (Digitizers)
+    0x09, 0x04, // Usage (Touch Screen)
+    0xA1, 0x01, // Collection (Application)
+    0x09, 0x22, //   Usage (Finger)
+    0xA1, 0x02, //   Collection (Logical)
+    0x09, 0x42, //     Usage (Tip Switch)
+    0x09, 0x32, //     Usage (In Range)
+    0x15, 0x00, //     Logical Minimum (0)
+    0x25, 0x01, //     Logical Maximum (1)
+    0x75, 0x01, //     Report Size (1)
+    0x95, 0x02, //     Report Count (2)
+    0x81, 0x02, //     Input (Data, Variable, Absolute)
+    0x95, 0x06, //     Report Count (6)
+    0x81, 0x03, //     Input (Constant), padding
+    0x05, 0x01, //     Usage Page (Generic Desktop)
+    0x09, 0x30, //     Usage (X)
+    0x09, 0x31, //     Usage (Y)
+    0x15, 0x00, //     Logical Minimum (0)
+    0x26, 0xFF, 0x7F, // Logical Maximum (32767)
+    0x75, 0x10, //     Report Size (16)
+    0x95, 0x02, //     Report Count (2)
+    0x81, 0x02, //     Input (Data, Variable, Absolute)
+    0xC0,       //   End Collection
+    0xC0,       // End Collection
+};
+
+const size_t HID_POINTER_REPORT_DESC_SIZE = sizeof(HID_POINTER_REPORT_DESC);
+
+// scale a coordinate in [0; size-1] to [0; HID_POINTER_COORD_MAX]
+static Uint16 scale_coord(Uint16 value, Uint16 size) {
+    if (size <= 1) {
+        return 0;
+    }
+    if (value >= size) {
+        value = size - 1;
+    }
+    return (Uint16) ((Uint32) value * HID_POINTER_COORD_MAX / (size - 1));
+}
+
+void hid_pointer_write_report(unsigned char *report, SDL_bool down,
+                              struct position position) {
+    // the finger is always in range, it is either touching or not
+    report[0] = down ? 0x03 : 0x02;
+    Uint16 x = scale_coord(position.point.x, position.screen_size.width);
+    Uint16 y = scale_coord(position.point.y, position.screen_size.height);
+    buffer_write16le(&report[1], x);
+    buffer_write16le(&report[3], y);
+}
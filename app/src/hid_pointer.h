@@ -0,0 +1,31 @@
+#ifndef HID_POINTER_H
+#define HID_POINTER_H
+
+#include <stddef.h>
+#include <SDL2/SDL_stdinc.h>
+
+#include "common.h"
+
+// the AOA accessory id of each HID device
+#define HID_KEYBOARD_ACCESSORY_ID 0
+#define HID_POINTER_ACCESSORY_ID 1
+
+// the pointer report, as declared in the HID report descriptor:
+//  - tip switch (bit 0) and in range (bit 1)
+//  - x (16 bits, little-endian)
+//  - y (16 bits, little-endian)
+#define HID_POINTER_REPORT_SIZE 5
+
+// the absolute coordinates range
+#define HID_POINTER_COORD_MAX 0x7fff
+
+// single-touch digitizer (touch screen), so that the clicks are injected over
+// USB instead of through the server
+extern const unsigned char HID_POINTER_REPORT_DESC[];
+extern const size_t HID_POINTER_REPORT_DESC_SIZE;
+
+// write the report for a finger at the given position (in the video frame)
+void hid_pointer_write_report(unsigned char *report, SDL_bool down,
+                              struct position position);
+
+#endif
@@ -0,0 +1,272 @@
+#include "hid_sender.h"
+
+#include <SDL2/SDL_assert.h>
+#include <string.h>
+
+#include "lock_util.h"
+#include "log.h"
+#include "usb_hid_keys.h"
+
+// the event thread checks regularly whether it must stop
+#define EVENT_TIMEOUT_US 100000
+
+static void fill_transfer(struct hid_sender *sender,
+                          struct libusb_transfer *transfer,
+                          uint16_t accessory_id, const unsigned char *report,
+                          uint16_t size);
+
+static void LIBUSB_CALL transfer_callback(struct libusb_transfer *transfer) {
+    struct hid_sender *sender = transfer->user_data;
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED
+            && transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+        // the report is lost, but the following ones may be sent
+        LOGW("HID transfer failed (status %d)", (int) transfer->status);
+    }
+
+    mutex_lock(sender->mutex);
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        ++sender->failed;
+    }
+    // reuse the transfer for the next queued report, if any
+    while (sender->queue_count) {
+        struct hid_report *report = &sender->queue[sender->queue_head];
+        sender->queue_head = (sender->queue_head + 1) % HID_SENDER_QUEUE_SIZE;
+        --sender->queue_count;
+        fill_transfer(sender, transfer, report->accessory_id, report->data,
+                      report->size);
+        int r = libusb_submit_transfer(transfer);
+        if (!r) {
+            mutex_unlock(sender->mutex);
+            return;
+        }
+        LOGW("Could not submit HID transfer: %s", libusb_strerror(r));
+        ++sender->failed;
+    }
+
+    // release the transfer
+    unsigned index = (unsigned) (transfer->buffer - sender->buffers[0])
+                   / sizeof(sender->buffers[0]);
+    SDL_assert(index < HID_SENDER_POOL_SIZE);
+    SDL_assert(sender->free_count < HID_SENDER_POOL_SIZE);
+    sender->free_transfers[sender->free_count++] = index;
+    if (sender->free_count == HID_SENDER_POOL_SIZE) {
+        cond_signal(sender->idle_cond);
+    }
+    mutex_unlock(sender->mutex);
+}
+
+static void fill_transfer(struct hid_sender *sender,
+                          struct libusb_transfer *transfer,
+                          uint16_t accessory_id, const unsigned char *report,
+                          uint16_t size) {
+    SDL_assert(size <= HID_REPORT_MAX_SIZE);
+    unsigned char *buffer = transfer->buffer;
+    // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
+    // value (arg0): accessory assigned ID for the HID device
+    // index (arg1): 0 (unused)
+    libusb_fill_control_setup(buffer,
+                              LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR,
+                              AOA_SEND_HID_EVENT, accessory_id, 0, size);
+    memcpy(buffer + LIBUSB_CONTROL_SETUP_SIZE, report, size);
+    libusb_fill_control_transfer(transfer, sender->handle, buffer,
+                                 transfer_callback, sender, DEFAULT_TIMEOUT);
+}
+
+SDL_bool hid_sender_init(struct hid_sender *sender,
+                         libusb_device_handle *handle) {
+    if (!(sender->mutex = SDL_CreateMutex())) {
+        return SDL_FALSE;
+    }
+
+    if (!(sender->idle_cond = SDL_CreateCond())) {
+        SDL_DestroyMutex(sender->mutex);
+        return SDL_FALSE;
+    }
+
+    for (unsigned i = 0; i < HID_SENDER_POOL_SIZE; ++i) {
+        struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+        if (!transfer) {
+            LOGC("Could not allocate HID transfer");
+            while (i--) {
+                libusb_free_transfer(sender->transfers[i]);
+            }
+            SDL_DestroyCond(sender->idle_cond);
+            SDL_DestroyMutex(sender->mutex);
+            return SDL_FALSE;
+        }
+        // the buffer is owned by the sender, it is never reallocated
+        transfer->buffer = sender->buffers[i];
+        sender->transfers[i] = transfer;
+        sender->free_transfers[i] = i;
+    }
+
+    sender->handle = handle;
+    sender->free_count = HID_SENDER_POOL_SIZE;
+    sender->queue_head = 0;
+    sender->queue_count = 0;
+    sender->dropped = 0;
+    sender->failed = 0;
+    sender->stopping = SDL_FALSE;
+    sender->event_thread_exited = SDL_FALSE;
+    SDL_AtomicSet(&sender->stopped, 0);
+
+    return SDL_TRUE;
+}
+
+void hid_sender_destroy(struct hid_sender *sender) {
+    if (sender->dropped || sender->failed) {
+        LOGW("HID reports: %u dropped (queue full), %u failed",
+             sender->dropped, sender->failed);
+    }
+    // a transfer still in flight (if it could not be cancelled) is leaked, it
+    // must not be freed
+    for (unsigned i = 0; i < sender->free_count; ++i) {
+        libusb_free_transfer(sender->transfers[sender->free_transfers[i]]);
+    }
+    SDL_DestroyCond(sender->idle_cond);
+    SDL_DestroyMutex(sender->mutex);
+}
+
+SDL_bool hid_sender_push(struct hid_sender *sender, uint16_t accessory_id,
+                         const unsigned char *report, uint16_t size) {
+    if (size > HID_REPORT_MAX_SIZE) {
+        LOGE("HID report too large: %u", (unsigned) size);
+        return SDL_FALSE;
+    }
+
+    SDL_bool ok = SDL_TRUE;
+    mutex_lock(sender->mutex);
+    if (sender->stopping || sender->event_thread_exited) {
+        // a transfer submitted now would never complete
+        ok = SDL_FALSE;
+    } else if (sender->free_count && !sender->queue_count) {
+        unsigned index = sender->free_transfers[--sender->free_count];
+        struct libusb_transfer *transfer = sender->transfers[index];
+        fill_transfer(sender, transfer, accessory_id, report, size);
+        int r = libusb_submit_transfer(transfer);
+        if (r) {
+            LOGW("Could not submit HID transfer: %s", libusb_strerror(r));
+            sender->free_transfers[sender->free_count++] = index;
+            ok = SDL_FALSE;
+        }
+    } else if (sender->queue_count < HID_SENDER_QUEUE_SIZE) {
+        // all the transfers are in flight (or reports are already waiting,
+        // which must be sent first), the callback will submit it
+        unsigned tail = (sender->queue_head + sender->queue_count)
+                      % HID_SENDER_QUEUE_SIZE;
+        struct hid_report *queued = &sender->queue[tail];
+        queued->accessory_id = accessory_id;
+        memcpy(queued->data, report, size);
+        queued->size = size;
+        ++sender->queue_count;
+    } else {
+        ++sender->dropped;
+        ok = SDL_FALSE;
+    }
+    mutex_unlock(sender->mutex);
+    return ok;
+}
+
+static int run_hid_sender(void *data) {
+    struct hid_sender *sender = data;
+
+    while (!SDL_AtomicGet(&sender->stopped)) {
+        struct timeval tv = {
+            .tv_sec = 0,
+            .tv_usec = EVENT_TIMEOUT_US,
+        };
+        // the callbacks are called from here
+        int r = libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+        if (r < 0 && r != LIBUSB_ERROR_INTERRUPTED) {
+            LOGE("Could not handle USB events: %s", libusb_strerror(r));
+            mutex_lock(sender->mutex);
+            sender->event_thread_exited = SDL_TRUE;
+            // hid_sender_stop() must not wait for the transfers in flight
+            cond_signal(sender->idle_cond);
+            mutex_unlock(sender->mutex);
+            break;
+        }
+    }
+    return 0;
+}
+
+SDL_bool hid_sender_start(struct hid_sender *sender) {
+    LOGD("Starting HID sender thread");
+
+    sender->thread = SDL_CreateThread(run_hid_sender, "hid_sender", sender);
+    if (!sender->thread) {
+        LOGC("Could not start HID sender thread");
+        return SDL_FALSE;
+    }
+
+    return SDL_TRUE;
+}
+
+// the event thread has exited, so the transfers in flight never complete by
+// themselves: cancel them, and handle their completion from this thread
+static void cancel_transfers(struct hid_sender *sender) {
+    SDL_bool in_flight[HID_SENDER_POOL_SIZE];
+    mutex_lock(sender->mutex);
+    for (unsigned i = 0; i < HID_SENDER_POOL_SIZE; ++i) {
+        in_flight[i] = SDL_TRUE;
+    }
+    for (unsigned i = 0; i < sender->free_count; ++i) {
+        in_flight[sender->free_transfers[i]] = SDL_FALSE;
+    }
+    mutex_unlock(sender->mutex);
+
+    for (unsigned i = 0; i < HID_SENDER_POOL_SIZE; ++i) {
+        if (in_flight[i]) {
+            // may fail if the transfer has already completed, its callback
+            // is then called by the events handling below
+            libusb_cancel_transfer(sender->transfers[i]);
+        }
+    }
+
+    mutex_lock(sender->mutex);
+    while (sender->free_count != HID_SENDER_POOL_SIZE) {
+        // the callbacks lock the mutex
+        mutex_unlock(sender->mutex);
+        struct timeval tv = {
+            .tv_sec = 0,
+            .tv_usec = EVENT_TIMEOUT_US,
+        };
+        int r = libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+        mutex_lock(sender->mutex);
+        if (r < 0 && r != LIBUSB_ERROR_INTERRUPTED) {
+            LOGE("Could not handle USB events: %s", libusb_strerror(r));
+            LOGW("%u HID transfers leaked",
+                 HID_SENDER_POOL_SIZE - sender->free_count);
+            break;
+        }
+    }
+    mutex_unlock(sender->mutex);
+}
+
+void hid_sender_stop(struct hid_sender *sender) {
+    mutex_lock(sender->mutex);
+    sender->stopping = SDL_TRUE;
+    // the queued reports are not sent, but the transfers in flight must
+    // complete (they time out after DEFAULT_TIMEOUT) before being freed
+    sender->queue_count = 0;
+    while (sender->free_count != HID_SENDER_POOL_SIZE
+            && !sender->event_thread_exited) {
+        cond_wait(sender->idle_cond, sender->mutex);
+    }
+    SDL_bool event_thread_exited = sender->event_thread_exited;
+    mutex_unlock(sender->mutex);
+
+    if (event_thread_exited) {
+        cancel_transfers(sender);
+    }
+
+    SDL_AtomicSet(&sender->stopped, 1);
+#if LIBUSB_API_VERSION >= 0x01000105
+    // wake up the event thread immediately (libusb >= 1.0.21)
+    libusb_interrupt_event_handler(NULL);
+#endif
+}
+
+void hid_sender_join(struct hid_sender *sender) {
+    SDL_WaitThread(sender->thread, NULL);
+}
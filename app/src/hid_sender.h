@@ -0,0 +1,68 @@
+#ifndef HID_SENDER_H
+#define HID_SENDER_H
+
+#include <libusb-1.0/libusb.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_stdinc.h>
+#include <SDL2/SDL_thread.h>
+
+// number of AOA HID transfers in flight at the same time
+#define HID_SENDER_POOL_SIZE 8
+
+// reports waiting for a free transfer
+#define HID_SENDER_QUEUE_SIZE 64
+
+#define HID_REPORT_MAX_SIZE 64
+
+struct hid_report {
+    uint16_t accessory_id; // the HID device
+    unsigned char data[HID_REPORT_MAX_SIZE];
+    uint16_t size;
+};
+
+// Send the HID reports asynchronously (libusb_submit_transfer()), so that the
+// caller (the SDL event loop) never blocks on USB.
+//
+// The completion callbacks are called from a dedicated thread handling the
+// libusb events.
+struct hid_sender {
+    libusb_device_handle *handle;
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *idle_cond; // signaled when no transfer is in flight
+    SDL_atomic_t stopped;
+    SDL_bool stopping; // no more reports are accepted
+    // the event thread stopped on an error, the transfers in flight do not
+    // complete anymore
+    SDL_bool event_thread_exited;
+    struct libusb_transfer *transfers[HID_SENDER_POOL_SIZE];
+    // indices of the transfers not in flight
+    unsigned free_transfers[HID_SENDER_POOL_SIZE];
+    unsigned free_count;
+    // the transfers are submitted in order, so the reports are received in
+    // order (the control endpoint processes them sequentially)
+    struct hid_report queue[HID_SENDER_QUEUE_SIZE];
+    unsigned queue_head;
+    unsigned queue_count;
+    unsigned dropped;
+    unsigned failed;
+    unsigned char buffers[HID_SENDER_POOL_SIZE]
+                         [LIBUSB_CONTROL_SETUP_SIZE + HID_REPORT_MAX_SIZE];
+};
+
+SDL_bool hid_sender_init(struct hid_sender *sender,
+                         libusb_device_handle *handle);
+void hid_sender_destroy(struct hid_sender *sender);
+
+SDL_bool hid_sender_start(struct hid_sender *sender);
+// wait for the transfers in flight (or cancel them if the event thread has
+// exited), then stop the event thread
+void hid_sender_stop(struct hid_sender *sender);
+void hid_sender_join(struct hid_sender *sender);
+
+// never blocks: if all the transfers are in flight, the report is queued
+SDL_bool hid_sender_push(struct hid_sender *sender, uint16_t accessory_id,
+                         const unsigned char *report, uint16_t size);
+
+#endif
@@ -1,9 +1,11 @@
 #include "input_manager.h"
 
+#include <string.h>
 #include <SDL2/SDL_assert.h>
 #include "convert.h"
 #include "lock_util.h"
 #include "log.h"
+#include "mosaic.h"
 
 static Uint32 timestamp = 0;
 
@@ -23,6 +25,10 @@ static void convert_to_renderer_coordinates(SDL_Renderer *renderer, int *x, int
 
 static void get_mouse_point(struct screen *screen, int *x, int *y) {
     SDL_GetMouseState(x, y);
+    if (screen->mosaic) {
+        mosaic_to_tile_point(screen->mosaic, screen->tile_index, x, y);
+        return;
+    }
     convert_to_renderer_coordinates(screen->renderer, x, y);
 }
 
@@ -52,10 +58,6 @@ static void send_keycode(struct controller *controller, enum android_keycode key
     }
 }
 
-static inline void action_paste(struct controller *controller, int actions) {
-    send_keycode(controller, AKEYCODE_PASTE, actions, "PASTE");
-}
-
 static inline void action_call(struct controller *controller, int actions) {
     send_keycode(controller, AKEYCODE_HEADSETHOOK, actions, "HEADSETHOOK");
 }
@@ -135,7 +137,23 @@ static void switch_fps_counter_state(struct frames *frames) {
     mutex_unlock(frames->mutex);
 }
 
-static void clipboard_paste(struct controller *controller) {
+// text is owned by the event (it is freed on failure)
+static void push_clipboard(struct controller *controller, char *text,
+                           SDL_bool paste) {
+    struct control_event control_event;
+    control_event.type = CONTROL_EVENT_TYPE_SET_CLIPBOARD;
+    control_event.set_clipboard_event.text = text;
+    control_event.set_clipboard_event.paste = paste;
+    if (!controller_push_event(controller, &control_event)) {
+        SDL_free(text);
+        LOGW("Cannot send clipboard event");
+    }
+}
+
+// set the device clipboard to the computer clipboard, then paste it if
+// requested (a single PASTE is much faster than injecting the text)
+static void set_device_clipboard(struct controller *controller,
+                                 SDL_bool paste) {
     char *text = SDL_GetClipboardText();
     if (!text) {
         LOGW("Cannot get clipboard text: %s", SDL_GetError());
@@ -146,13 +164,73 @@ static void clipboard_paste(struct controller *controller) {
         SDL_free(text);
         return;
     }
+    push_clipboard(controller, text, paste);
+}
 
-    struct control_event control_event;
-    control_event.type = CONTROL_EVENT_TYPE_TEXT;
-    control_event.text_event.text = text;
-    if (!controller_push_event(controller, &control_event)) {
-        SDL_free(text);
-        LOGW("Cannot send clipboard paste event");
+// the keyboard and consumer control reports are sent to the same HID device
+static SDL_bool push_keyboard_report(struct input_manager *input_manager,
+                                     const unsigned char *report,
+                                     uint16_t size) {
+    if (!input_manager->hid_sender) {
+        // the HID devices are not ready yet
+        return SDL_FALSE;
+    }
+    return hid_sender_push(input_manager->hid_sender,
+                           HID_KEYBOARD_ACCESSORY_ID, report, size);
+}
+
+// change the state of a HID key, it will be reported on flush (or before, if
+// the change cannot be merged with the pending ones)
+static SDL_bool process_hid_key(struct input_manager *input_manager,
+                                const unsigned char *data, SDL_bool down) {
+    struct hid_keyboard *kb = &input_manager->keyboard;
+    Uint8 usage = data[HID_KEY_USAGE_INDEX];
+    unsigned char flushed[HID_KEYBOARD_REPORT_SIZE];
+    SDL_bool must_send = down
+        ? hid_keyboard_press(kb, usage, data[HID_KEY_MODIFIERS_INDEX], flushed)
+        : hid_keyboard_release(kb, usage, flushed);
+    if (must_send) {
+        return push_keyboard_report(input_manager, flushed,
+                                    HID_KEYBOARD_REPORT_SIZE);
+    }
+    return SDL_TRUE;
+}
+
+// release the HID key pressed by this SDL key, if any
+static SDL_bool release_hid_key(struct input_manager *input_manager,
+                                SDL_Scancode scancode) {
+    if ((unsigned) scancode >= SDL_NUM_SCANCODES) {
+        return SDL_TRUE;
+    }
+    Uint8 usage = input_manager->key_usages[scancode];
+    if (!usage) {
+        return SDL_TRUE;
+    }
+    input_manager->key_usages[scancode] = 0;
+    unsigned char data[HID_KEY_USAGE_INDEX + 1] = {0};
+    data[HID_KEY_USAGE_INDEX] = usage;
+    return process_hid_key(input_manager, data, SDL_FALSE);
+}
+
+static SDL_bool flush_pointer_motion(struct input_manager *input_manager) {
+    if (!input_manager->pointer_motion_pending) {
+        return SDL_TRUE;
+    }
+    input_manager->pointer_motion_pending = SDL_FALSE;
+    return hid_sender_push(input_manager->hid_sender, HID_POINTER_ACCESSORY_ID,
+                           input_manager->pointer_motion_report,
+                           HID_POINTER_REPORT_SIZE);
+}
+
+void input_manager_flush_hid(struct input_manager *input_manager) {
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    if (hid_keyboard_take_report(&input_manager->keyboard, report)
+            && !push_keyboard_report(input_manager, report,
+                                     HID_KEYBOARD_REPORT_SIZE)) {
+        LOGW("Cannot send usb key event");
+    }
+    if (!flush_pointer_motion(input_manager)) {
+        LOGW("Cannot send usb pointer event");
     }
 }
 
@@ -170,9 +248,10 @@ void input_manager_process_text_input(struct input_manager *input_manager,
     data = key_press(c);
     if (data == hid_keys_null)
         return;
-    if (send_hid_event(input_manager->handle, data, HID_EVENT_SIZE))
+    // a character has no release event: press and release immediately
+    if (!process_hid_key(input_manager, data, SDL_TRUE))
         goto log_err;
-    if (send_hid_event(input_manager->handle, data + 5, HID_EVENT_SIZE))
+    if (!process_hid_key(input_manager, data, SDL_FALSE))
         goto log_err;
     return;
 log_err:
@@ -182,68 +261,51 @@ log_err:
 static void swipe(int dir, struct input_manager *input_manager) {
     struct size screen_size = input_manager->screen->frame_size;
     static const int steps = 10;
-    struct control_event * tos = SDL_malloc((steps + 2) * sizeof(struct control_event));
-
-    Uint16 xs[steps + 1], ys[steps + 1];
-    if (dir == 0) {
-        for (int i = 0; i <= steps; ++i) {
-            xs[i] = screen_size.width * 7 / 8 - screen_size.width * i / steps / 8;
-            ys[i] = screen_size.height / 2;
-        }
-    } else if (dir == 1) {
-        for (int i = 0; i <= steps; ++i) {
-            xs[i] = screen_size.width / 8 + screen_size.width * i / steps * 7 / 8;
-            ys[i] = screen_size.height / 2;
-        }
-    } else if (dir == 2) {
-        for (int i = 0; i <= steps; ++i) {
-            xs[i] = screen_size.width / 2;
-            ys[i] = screen_size.height * 3 / 4 - screen_size.height * i / steps / 2;
-        }
-    } else if (dir == 3) {
-        for (int i = 0; i <= steps; ++i) {
-            xs[i] = screen_size.width / 2;
-            ys[i] = screen_size.height / 4 + screen_size.height * i / steps / 2;
-        }
+    struct point *points = SDL_malloc((steps + 1) * sizeof(*points));
+    if (!points) {
+        LOGW("Cannot allocate swipe event");
+        return;
     }
 
-    struct control_event to;
-    to.type = CONTROL_EVENT_TYPE_SWIPE;
-    to.swipe_event.events = tos;
-    to.swipe_event.num = steps + 2;
-    to.swipe_event.time = 50000;
-
-    tos[0].type = CONTROL_EVENT_TYPE_MOUSE;
-    tos[0].mouse_event.action = AMOTION_EVENT_ACTION_DOWN;
-    tos[0].mouse_event.buttons = AMOTION_EVENT_BUTTON_PRIMARY;
-    tos[0].mouse_event.position.screen_size = screen_size;
-    tos[0].mouse_event.position.point.x = xs[0];
-    tos[0].mouse_event.position.point.y = ys[0];
-
-    for (int i = 1; i <= steps; ++i) {
-        tos[i].type = CONTROL_EVENT_TYPE_MOUSE;
-        tos[i].mouse_event.action = AMOTION_EVENT_ACTION_MOVE;
-        tos[i].mouse_event.buttons = AMOTION_EVENT_BUTTON_PRIMARY;
-        tos[i].mouse_event.position.screen_size = screen_size;
-        tos[i].mouse_event.position.point.x = xs[i];
-        tos[i].mouse_event.position.point.y = ys[i];
+    for (int i = 0; i <= steps; ++i) {
+        struct point *p = &points[i];
+        if (dir == 0) {
+            p->x = screen_size.width * 7 / 8 - screen_size.width * i / steps / 8;
+            p->y = screen_size.height / 2;
+        } else if (dir == 1) {
+            p->x = screen_size.width / 8 + screen_size.width * i / steps * 7 / 8;
+            p->y = screen_size.height / 2;
+        } else if (dir == 2) {
+            p->x = screen_size.width / 2;
+            p->y = screen_size.height * 3 / 4 - screen_size.height * i / steps / 2;
+        } else {
+            p->x = screen_size.width / 2;
+            p->y = screen_size.height / 4 + screen_size.height * i / steps / 2;
+        }
     }
 
-    tos[steps + 1].type = CONTROL_EVENT_TYPE_MOUSE;
-    tos[steps + 1].mouse_event.action = AMOTION_EVENT_ACTION_UP;
-    tos[steps + 1].mouse_event.buttons = AMOTION_EVENT_BUTTON_PRIMARY;
-    tos[steps + 1].mouse_event.position.screen_size = screen_size;
-    tos[steps + 1].mouse_event.position.point.x = xs[steps];
-    tos[steps + 1].mouse_event.position.point.y = ys[steps];
-
-    if (!controller_push_event(input_manager->controller, &to)) {
-        LOGW("Cannot send mouse motion event");
+    // the whole gesture is sent at once, the device replays it
+    struct control_event event;
+    event.type = CONTROL_EVENT_TYPE_SWIPE;
+    event.swipe_event.screen_size = screen_size;
+    event.swipe_event.points = points;
+    event.swipe_event.count = steps + 1;
+    event.swipe_event.delay = 50;
+
+    if (!controller_push_event(input_manager->controller, &event)) {
+        SDL_free(points);
+        LOGW("Cannot send swipe event");
     }
 }
 
 void input_manager_process_key(struct input_manager *input_manager,
                                SDL_KeyboardEvent *event) {
 
+    if (event->type == SDL_KEYUP
+            && !release_hid_key(input_manager, event->keysym.scancode)) {
+        LOGW("Cannot send usb key event");
+    }
+
     SDL_bool ctrl = event->keysym.mod & (KMOD_LCTRL | KMOD_RCTRL);
     SDL_bool alt = event->keysym.mod & (KMOD_LALT | KMOD_RALT);
     SDL_bool meta = event->keysym.mod & (KMOD_LGUI | KMOD_RGUI);
@@ -252,9 +314,7 @@ void input_manager_process_key(struct input_manager *input_manager,
     if (shift && event->keysym.sym == SDLK_INSERT)
     {
         if (!ctrl && !alt && !event->repeat && event->type == SDL_KEYDOWN) {
-            /* clipboard_paste(input_manager->controller); */
-            server_paste(input_manager->server);
-            action_paste(input_manager->controller, ACTION_DOWN);
+            set_device_clipboard(input_manager->controller, SDL_TRUE);
         }
         return;
     }
@@ -267,8 +327,7 @@ void input_manager_process_key(struct input_manager *input_manager,
     if (ctrl && event->keysym.sym == SDLK_v)
     {
         if (!alt && !event->repeat && event->type == SDL_KEYDOWN) {
-            server_paste(input_manager->server);
-            action_paste(input_manager->controller, ACTION_DOWN);
+            set_device_clipboard(input_manager->controller, SDL_TRUE);
         }
         return;
     }
@@ -317,54 +376,54 @@ void input_manager_process_key(struct input_manager *input_manager,
         case SDLK_VOLUMEDOWN:
             {
                 static unsigned char xx[4] = {0x02, 0x80, 0x02, 0x00};
-                if (send_hid_event(input_manager->handle, xx, 2))
+                if (!push_keyboard_report(input_manager, xx, 2))
                     goto log_err;
-                if (send_hid_event(input_manager->handle, xx + 2, 2))
+                if (!push_keyboard_report(input_manager, xx + 2, 2))
                     goto log_err;
             }
             return;
         case SDLK_VOLUMEUP:
             {
                 static unsigned char xx[4] = {0x02, 0x40, 0x02, 0x00};
-                if (send_hid_event(input_manager->handle, xx, 2))
+                if (!push_keyboard_report(input_manager, xx, 2))
                     goto log_err;
-                if (send_hid_event(input_manager->handle, xx + 2, 2))
+                if (!push_keyboard_report(input_manager, xx + 2, 2))
                     goto log_err;
             }
             return;
         case SDLK_MUTE:
             {
                 static unsigned char xx[4] = {0x02, 0x20, 0x02, 0x00};
-                if (send_hid_event(input_manager->handle, xx, 2))
+                if (!push_keyboard_report(input_manager, xx, 2))
                     goto log_err;
-                if (send_hid_event(input_manager->handle, xx + 2, 2))
+                if (!push_keyboard_report(input_manager, xx + 2, 2))
                     goto log_err;
             }
             return;
         case SDLK_AUDIOPLAY:
             {
                 static unsigned char xx[4] = {0x02, 0x10, 0x02, 0x00};
-                if (send_hid_event(input_manager->handle, xx, 2))
+                if (!push_keyboard_report(input_manager, xx, 2))
                     goto log_err;
-                if (send_hid_event(input_manager->handle, xx + 2, 2))
+                if (!push_keyboard_report(input_manager, xx + 2, 2))
                     goto log_err;
             }
             return;
         case SDLK_AUDIOPREV:
             {
                 static unsigned char xx[4] = {0x02, 0x02, 0x02, 0x00};
-                if (send_hid_event(input_manager->handle, xx, 2))
+                if (!push_keyboard_report(input_manager, xx, 2))
                     goto log_err;
-                if (send_hid_event(input_manager->handle, xx + 2, 2))
+                if (!push_keyboard_report(input_manager, xx + 2, 2))
                     goto log_err;
             }
             return;
         case SDLK_AUDIONEXT:
             {
                 static unsigned char xx[4] = {0x02, 0x01, 0x02, 0x00};
-                if (send_hid_event(input_manager->handle, xx, 2))
+                if (!push_keyboard_report(input_manager, xx, 2))
                     goto log_err;
-                if (send_hid_event(input_manager->handle, xx + 2, 2))
+                if (!push_keyboard_report(input_manager, xx + 2, 2))
                     goto log_err;
             }
             return;
@@ -523,14 +582,20 @@ out:
     if (data == hid_keys_null)
         return;
 out2:
+    // the key is released on SDL_KEYUP, whatever the modifiers at that time
     if (event->type == SDL_KEYDOWN)
     {
-        if (send_hid_event(input_manager->handle, data, HID_EVENT_SIZE))
-            goto log_err;
-    }
-    else
-    {
-        if (send_hid_event(input_manager->handle, data + 5, HID_EVENT_SIZE))
+        SDL_Scancode scancode = event->keysym.scancode;
+        if ((unsigned) scancode < SDL_NUM_SCANCODES) {
+            Uint8 usage = data[HID_KEY_USAGE_INDEX];
+            if (input_manager->key_usages[scancode]
+                    && input_manager->key_usages[scancode] != usage) {
+                // the same SDL key now maps to another HID key
+                release_hid_key(input_manager, scancode);
+            }
+            input_manager->key_usages[scancode] = usage;
+        }
+        if (!process_hid_key(input_manager, data, SDL_TRUE))
             goto log_err;
     }
     return;
@@ -538,12 +603,111 @@ log_err:
     LOGW("Cannot send usb key event");
 }
 
+static Uint16 clamp_coord(int value, Uint16 size) {
+    if (value < 0) {
+        return 0;
+    }
+    if (value >= size) {
+        return size ? size - 1 : 0;
+    }
+    return (Uint16) value;
+}
+
+static SDL_bool send_touch(struct controller *controller,
+                           enum android_motionevent_action action,
+                           Uint8 pointer_id, struct size screen_size,
+                           int x, int y) {
+    struct control_event control_event;
+    control_event.type = CONTROL_EVENT_TYPE_TOUCH;
+    control_event.touch_event.action = action;
+    control_event.touch_event.pointer_id = pointer_id;
+    control_event.touch_event.position.screen_size = screen_size;
+    control_event.touch_event.position.point.x =
+        clamp_coord(x, screen_size.width);
+    control_event.touch_event.position.point.y =
+        clamp_coord(y, screen_size.height);
+    control_event.touch_event.pressure = TOUCH_PRESSURE_MAX;
+    return controller_push_event(controller, &control_event);
+}
+
+static struct position get_clamped_position(struct input_manager *input_manager,
+                                            int x, int y) {
+    struct size screen_size = input_manager->screen->frame_size;
+    struct position position = {
+        .screen_size = screen_size,
+        .point = {
+            .x = clamp_coord(x, screen_size.width),
+            .y = clamp_coord(y, screen_size.height),
+        },
+    };
+    return position;
+}
+
+// the motions are merged until the next flush
+static void move_hid_pointer(struct input_manager *input_manager, int x, int y) {
+    struct position position = get_clamped_position(input_manager, x, y);
+    hid_pointer_write_report(input_manager->pointer_motion_report, SDL_TRUE,
+                             position);
+    input_manager->pointer_motion_pending = SDL_TRUE;
+}
+
+// a press or a release is never merged
+static void send_hid_pointer_button(struct input_manager *input_manager,
+                                    SDL_bool down, int x, int y) {
+    struct position position = get_clamped_position(input_manager, x, y);
+    unsigned char report[HID_POINTER_REPORT_SIZE];
+    hid_pointer_write_report(report, down, position);
+    // the pending motion happened before
+    SDL_bool ok = flush_pointer_motion(input_manager)
+               && hid_sender_push(input_manager->hid_sender,
+                                  HID_POINTER_ACCESSORY_ID, report,
+                                  HID_POINTER_REPORT_SIZE);
+    if (!ok) {
+        LOGW("Cannot send usb pointer event");
+    }
+    input_manager->pointer_down = down;
+}
+
+// send the event for both fingers of a pinch gesture
+static void send_pinch(struct input_manager *input_manager,
+                       enum android_motionevent_action action, int x, int y) {
+    struct size screen_size = input_manager->screen->frame_size;
+    // the second finger is the mirror of the mouse around the screen center
+    int mirror_x = screen_size.width - x;
+    int mirror_y = screen_size.height - y;
+
+    struct controller *controller = input_manager->controller;
+    SDL_bool ok;
+    if (action == AMOTION_EVENT_ACTION_UP) {
+        // release the second finger first
+        ok = send_touch(controller, action, 1, screen_size, mirror_x, mirror_y)
+          && send_touch(controller, action, 0, screen_size, x, y);
+    } else {
+        ok = send_touch(controller, action, 0, screen_size, x, y)
+          && send_touch(controller, action, 1, screen_size, mirror_x, mirror_y);
+    }
+    if (!ok) {
+        LOGW("Cannot send pinch event");
+    }
+}
+
 void input_manager_process_mouse_motion(struct input_manager *input_manager,
                                         const SDL_MouseMotionEvent *event) {
     if (!event->state) {
         // do not send motion events when no button is pressed
         return;
     }
+    if (input_manager->pinching) {
+        send_pinch(input_manager, AMOTION_EVENT_ACTION_MOVE,
+                   event->x, event->y);
+        return;
+    }
+    if (input_manager->hid_pointer) {
+        if (input_manager->pointer_down) {
+            move_hid_pointer(input_manager, event->x, event->y);
+        }
+        return;
+    }
     struct control_event control_event;
     if (mouse_motion_from_sdl_to_android(event, input_manager->screen->frame_size, &control_event)) {
         if (!controller_push_event(input_manager->controller, &control_event)) {
@@ -582,11 +746,41 @@ void input_manager_process_mouse_button(struct input_manager *input_manager,
         // otherwise, send the click event to the device
     }
 
+    if (event->button == SDL_BUTTON_LEFT && event->type == SDL_MOUSEBUTTONUP
+            && input_manager->pinching) {
+        // release the pinch even if the mouse is outside the device screen
+        send_pinch(input_manager, AMOTION_EVENT_ACTION_UP, event->x, event->y);
+        input_manager->pinching = SDL_FALSE;
+        return;
+    }
+
+    if (event->button == SDL_BUTTON_LEFT && event->type == SDL_MOUSEBUTTONUP
+            && input_manager->pointer_down) {
+        // release the finger even if the mouse is outside the device screen
+        send_hid_pointer_button(input_manager, SDL_FALSE, event->x, event->y);
+        return;
+    }
+
     if (outside_device_screen) {
         // ignore
         return;
     }
 
+    if (event->button == SDL_BUTTON_LEFT && event->type == SDL_MOUSEBUTTONDOWN
+            && (SDL_GetModState() & KMOD_CTRL)) {
+        send_pinch(input_manager, AMOTION_EVENT_ACTION_DOWN, event->x, event->y);
+        input_manager->pinching = SDL_TRUE;
+        return;
+    }
+
+    if (input_manager->hid_pointer && event->button == SDL_BUTTON_LEFT) {
+        if (event->type == SDL_MOUSEBUTTONDOWN) {
+            send_hid_pointer_button(input_manager, SDL_TRUE, event->x,
+                                    event->y);
+        }
+        return;
+    }
+
     struct control_event control_event;
     if (mouse_button_from_sdl_to_android(event, input_manager->screen->frame_size, &control_event)) {
         if (!controller_push_event(input_manager->controller, &control_event)) {
@@ -621,3 +815,31 @@ void input_manager_process_mouse_wheel(struct input_manager *input_manager,
         }
     }
 }
+
+void input_manager_process_clipboard_update(struct input_manager *input_manager) {
+    if (!input_manager->clipboard_sync) {
+        return;
+    }
+    char *text = SDL_GetClipboardText();
+    if (!text) {
+        LOGW("Cannot get clipboard text: %s", SDL_GetError());
+        return;
+    }
+    if (!*text || (input_manager->device_clipboard
+            && !strcmp(text, input_manager->device_clipboard))) {
+        // empty, or set from the device clipboard: do not send it back
+        SDL_free(text);
+        return;
+    }
+    push_clipboard(input_manager->controller, text, SDL_FALSE);
+}
+
+void input_manager_process_device_clipboard(struct input_manager *input_manager,
+                                            char *text) {
+    SDL_free(input_manager->device_clipboard);
+    input_manager->device_clipboard = text;
+    // this triggers SDL_CLIPBOARDUPDATE, ignored since the text is the same
+    if (SDL_SetClipboardText(text)) {
+        LOGW("Cannot set clipboard text: %s", SDL_GetError());
+    }
+}
@@ -5,6 +5,9 @@
 #include "controller.h"
 #include "fps_counter.h"
 #include "frames.h"
+#include "hid_keyboard.h"
+#include "hid_pointer.h"
+#include "hid_sender.h"
 #include "screen.h"
 #include "server.h"
 #include "usb_hid_keys.h"
@@ -14,7 +17,24 @@ struct input_manager {
     struct frames *frames;
     struct screen *screen;
     struct server *server;
-    struct libusb_device_handle* handle;
+    struct hid_sender *hid_sender;
+    struct hid_keyboard keyboard;
+    // the HID key pressed by each SDL key, to release it whatever the
+    // modifiers on release
+    Uint8 key_usages[SDL_NUM_SCANCODES];
+    // inject the left clicks through the AOA HID digitizer
+    SDL_bool hid_pointer;
+    SDL_bool pointer_down;
+    // the last motion not sent yet
+    SDL_bool pointer_motion_pending;
+    unsigned char pointer_motion_report[HID_POINTER_REPORT_SIZE];
+    // Ctrl+left-drag moves two fingers, the second one mirrored around the
+    // center of the screen, to pinch (zoom) or rotate
+    SDL_bool pinching;
+    // synchronize the computer and device clipboards
+    SDL_bool clipboard_sync;
+    // last text received from the device, not to send it back
+    char *device_clipboard;
 };
 
 void input_manager_enable_modifiers(Uint32 time);
@@ -29,4 +49,14 @@ void input_manager_process_mouse_button(struct input_manager *input_manager,
 void input_manager_process_mouse_wheel(struct input_manager *input_manager,
                                        const SDL_MouseWheelEvent *event);
 
+// send the HID changes not reported yet, to be called once the pending SDL
+// events have been processed
+void input_manager_flush_hid(struct input_manager *input_manager);
+
+// the computer clipboard has changed (SDL_CLIPBOARDUPDATE)
+void input_manager_process_clipboard_update(struct input_manager *input_manager);
+// the device clipboard has changed, text is owned by the input manager
+void input_manager_process_device_clipboard(struct input_manager *input_manager,
+                                            char *text);
+
 #endif
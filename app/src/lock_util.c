@@ -32,3 +32,10 @@ void cond_signal(SDL_cond *cond) {
     }
 }
 
+
+void cond_broadcast(SDL_cond *cond) {
+    if (SDL_CondBroadcast(cond)) {
+        LOGC("Could not broadcast a condition");
+        abort();
+    }
+}
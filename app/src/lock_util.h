@@ -9,5 +9,6 @@ void mutex_lock(SDL_mutex *mutex);
 void mutex_unlock(SDL_mutex *mutex);
 void cond_wait(SDL_cond *cond, SDL_mutex *mutex);
 void cond_signal(SDL_cond *cond);
+void cond_broadcast(SDL_cond *cond);
 
 #endif
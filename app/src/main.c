@@ -1,24 +1,38 @@
 #include "scrcpy.h"
 
 #include <getopt.h>
+#include <string.h>
 #include <unistd.h>
 #include <libavformat/avformat.h>
 #include <SDL2/SDL.h>
 
 #include "config.h"
+#include "control_event.h"
 #include "log.h"
 
 struct args {
-    const char *serial;
+    const char **serials; // allocated on the first -s
+    unsigned serial_count;
     const char *crop;
     const char *record_filename;
+    const char *frame_sink_name;
     SDL_bool fullscreen;
     SDL_bool help;
     SDL_bool version;
     SDL_bool show_touches;
+    SDL_bool clipboard_sync;
+    SDL_bool hid_pointer;
+    SDL_bool cache_server;
+    SDL_bool daemon;
+    SDL_bool mosaic;
+    enum present_mode present_mode;
+    Uint32 direct_addr;
+    Uint16 direct_port;
     Uint16 port;
     Uint16 max_size;
     Uint32 bit_rate;
+    Uint32 thumbnail_interval;
+    Uint32 control_queue_size;
     uint16_t vid;
     uint16_t pid;
 };
@@ -34,34 +48,90 @@ static void usage(const char *arg0) {
         "        Unit suffixes are supported: 'K' (x1000) and 'M' (x1000000).\n"
         "        Default is %d.\n"
         "\n"
+        "    --cache-server\n"
+        "        Keep the server on the device, and push it only if it\n"
+        "        changed. It starts faster, but must be removed manually\n"
+        "        (from /data/local/tmp/).\n"
+        "\n"
         "    -c, --crop width:height:x:y\n"
         "        Crop the device screen on the server.\n"
         "        The values are expressed in the device natural orientation\n"
         "        (typically, portrait for a phone, landscape for a tablet).\n"
         "        Any --max-size value is computed on the cropped size.\n"
         "\n"
+        "    --control-queue-size value\n"
+        "        Set the maximum number of input events waiting to be sent to\n"
+        "        the device (rounded up to a power of 2). Events are dropped\n"
+        "        when the queue is full.\n"
+        "        Default is %d.\n"
+        "\n"
+        "    --daemon\n"
+        "        Keep the server running on the device after exit, and\n"
+        "        connect to the running one if it was started with the same\n"
+        "        version and options (implies --cache-server).\n"
+        "\n"
+        "    --direct-tcp ip[:port]\n"
+        "        Connect directly to the device over TCP (typically over\n"
+        "        Wi-Fi) instead of through the adb tunnel. The connection is\n"
+        "        authenticated by a one-time token sent over adb.\n"
+        "        Default port is %d.\n"
+        "\n"
+        "    --frame-pacing mode\n"
+        "        Either \"latency\" to present every frame as soon as it is\n"
+        "        decoded (it may tear), or \"smooth\" to present at most one\n"
+        "        frame per vertical blank, at regular intervals.\n"
+        "        The presentation stats are logged on exit.\n"
+        "        Default is latency.\n"
+        "\n"
+        "    --frame-sink name\n"
+        "        Publish the decoded frames (YUV 4:2:0) to the POSIX shared\n"
+        "        memory object /name, for other local processes (see\n"
+        "        frame_sink.h for the layout). With several devices, the\n"
+        "        device i publishes to /name.i.\n"
+        "\n"
         "    -f, --fullscreen\n"
         "        Start in fullscreen.\n"
         "\n"
         "    -h, --help\n"
         "        Print this help.\n"
         "\n"
+        "    --hid-pointer\n"
+        "        Inject the clicks through a virtual HID touch screen (over\n"
+        "        USB, like the keyboard) instead of the server.\n"
+        "        Not compatible with --crop.\n"
+        "\n"
         "    -m, --max-size value\n"
         "        Limit both the width and height of the video to value. The\n"
         "        other dimension is computed so that the device aspect-ratio\n"
         "        is preserved.\n"
         "        Default is %d%s.\n"
         "\n"
+        "    --mosaic\n"
+        "        Show all the devices in a single window, as a grid. Unless\n"
+        "        --max-size is given, the videos are limited to %d.\n"
+        "\n"
+        "    --no-clipboard-sync\n"
+        "        Do not synchronize the computer and device clipboards.\n"
+        "\n"
         "    -p, --port port\n"
         "        Set the TCP port the client listens on.\n"
         "        Default is %d.\n"
         "\n"
         "    -r, --record file.mp4\n"
         "        Record screen to file.\n"
+        "        A sidecar index (file.mp4.idx) lists the offset of every\n"
+        "        keyframe and the thumbnails (file.mp4.NNNN.jpg).\n"
         "\n"
         "    -s, --serial\n"
         "        The device serial number. Mandatory only if several devices\n"
         "        are connected to adb.\n"
+        "        Repeat it to mirror several devices, each in its own window;\n"
+        "        the device i uses the local port (port + i).\n"
+        "\n"
+        "    --thumbnail-interval seconds\n"
+        "        Write a recording thumbnail every given number of seconds\n"
+        "        (0 to disable).\n"
+        "        Default is %d.\n"
         "\n"
         "    -t, --show-touches\n"
         "        Enable \"show touches\" on start, disable on quit.\n"
@@ -72,6 +142,8 @@ static void usage(const char *arg0) {
         "\n"
         "    -x, --id 18d1:4ee7\n"
         "        The device id used by virtual HID keyboard manager.\n"
+        "        Ignored if several devices are mirrored: they are found by\n"
+        "        their serial.\n"
         "\n"
         "Shortcuts:\n"
         "\n"
@@ -119,13 +191,21 @@ static void usage(const char *arg0) {
         "    Ctrl+i\n"
         "        enable/disable FPS counter (print frames/second in logs)\n"
         "\n"
+        "    Ctrl+left-drag\n"
+        "        pinch (zoom) or rotate with two fingers, around the center\n"
+        "        of the screen\n"
+        "\n"
         "    Drag & drop APK file\n"
         "        install APK from computer\n"
         "\n",
         arg0,
         DEFAULT_BIT_RATE,
+        DEFAULT_CONTROL_QUEUE_SIZE,
+        DEFAULT_DIRECT_PORT,
         DEFAULT_MAX_SIZE, DEFAULT_MAX_SIZE ? "" : " (unlimited)",
-        DEFAULT_LOCAL_PORT);
+        DEFAULT_MOSAIC_MAX_SIZE,
+        DEFAULT_LOCAL_PORT,
+        DEFAULT_THUMBNAIL_INTERVAL);
 }
 
 static void print_version(void) {
@@ -209,6 +289,81 @@ static SDL_bool parse_port(char *optarg, Uint16 *port) {
     return SDL_TRUE;
 }
 
+static SDL_bool parse_thumbnail_interval(char *optarg, Uint32 *interval) {
+    char *endptr;
+    if (*optarg == '\0') {
+        LOGE("Thumbnail interval parameter is empty");
+        return SDL_FALSE;
+    }
+    long value = strtol(optarg, &endptr, 0);
+    if (*endptr != '\0') {
+        LOGE("Invalid thumbnail interval: %s", optarg);
+        return SDL_FALSE;
+    }
+    if (value < 0 || value > 0xffff) {
+        LOGE("Thumbnail interval must be between 0 and 65535: %ld", value);
+        return SDL_FALSE;
+    }
+
+    *interval = (Uint32) value;
+    return SDL_TRUE;
+}
+
+static SDL_bool parse_control_queue_size(char *optarg, Uint32 *size) {
+    char *endptr;
+    if (*optarg == '\0') {
+        LOGE("Control queue size parameter is empty");
+        return SDL_FALSE;
+    }
+    long value = strtol(optarg, &endptr, 0);
+    if (*endptr != '\0') {
+        LOGE("Invalid control queue size: %s", optarg);
+        return SDL_FALSE;
+    }
+    if (value < 1 || value > CONTROL_EVENT_QUEUE_MAX_CAPACITY) {
+        LOGE("Control queue size must be between 1 and %d: %ld",
+             CONTROL_EVENT_QUEUE_MAX_CAPACITY, value);
+        return SDL_FALSE;
+    }
+
+    *size = (Uint32) value;
+    return SDL_TRUE;
+}
+
+static SDL_bool parse_direct_tcp(char *optarg, Uint32 *addr, Uint16 *port) {
+    unsigned a, b, c, d;
+    int n = 0;
+    if (sscanf(optarg, "%u.%u.%u.%u%n", &a, &b, &c, &d, &n) != 4
+            || (optarg[n] != '\0' && optarg[n] != ':')) {
+        LOGE("Invalid direct TCP address (expected ip[:port]): %s", optarg);
+        return SDL_FALSE;
+    }
+    if (a > 255 || b > 255 || c > 255 || d > 255) {
+        LOGE("Direct TCP address out of range: %s", optarg);
+        return SDL_FALSE;
+    }
+    if (optarg[n] == ':' && !parse_port(&optarg[n + 1], port)) {
+        return SDL_FALSE;
+    }
+
+    *addr = (a << 24) | (b << 16) | (c << 8) | d;
+    return SDL_TRUE;
+}
+
+static SDL_bool parse_frame_pacing(const char *optarg,
+                                   enum present_mode *mode) {
+    if (!strcmp(optarg, "latency")) {
+        *mode = PRESENT_LATENCY;
+        return SDL_TRUE;
+    }
+    if (!strcmp(optarg, "smooth")) {
+        *mode = PRESENT_SMOOTH;
+        return SDL_TRUE;
+    }
+    LOGE("Invalid frame pacing (expected latency or smooth): %s", optarg);
+    return SDL_FALSE;
+}
+
 static SDL_bool parse_id(char *optarg, uint16_t *vid, uint16_t *pid) {
     if (*optarg == '\0') {
         LOGE("Invalid port parameter is empty");
@@ -231,17 +386,40 @@ static SDL_bool parse_id(char *optarg, uint16_t *vid, uint16_t *pid) {
     return SDL_TRUE;
 }
 
+#define OPT_THUMBNAIL_INTERVAL 1000
+#define OPT_CONTROL_QUEUE_SIZE 1001
+#define OPT_NO_CLIPBOARD_SYNC 1002
+#define OPT_HID_POINTER 1003
+#define OPT_CACHE_SERVER 1004
+#define OPT_DAEMON 1005
+#define OPT_DIRECT_TCP 1006
+#define OPT_MOSAIC 1007
+#define OPT_FRAME_PACING 1008
+#define OPT_FRAME_SINK 1009
+
 static SDL_bool parse_args(struct args *args, int argc, char *argv[]) {
     static const struct option long_options[] = {
         {"bit-rate",     required_argument, NULL, 'b'},
+        {"cache-server", no_argument,       NULL, OPT_CACHE_SERVER},
+        {"control-queue-size", required_argument, NULL,
+                                                  OPT_CONTROL_QUEUE_SIZE},
         {"crop",         required_argument, NULL, 'c'},
+        {"daemon",       no_argument,       NULL, OPT_DAEMON},
+        {"direct-tcp",   required_argument, NULL, OPT_DIRECT_TCP},
+        {"frame-pacing", required_argument, NULL, OPT_FRAME_PACING},
+        {"frame-sink",   required_argument, NULL, OPT_FRAME_SINK},
         {"fullscreen",   no_argument,       NULL, 'f'},
         {"help",         no_argument,       NULL, 'h'},
+        {"hid-pointer",  no_argument,       NULL, OPT_HID_POINTER},
         {"max-size",     required_argument, NULL, 'm'},
+        {"mosaic",       no_argument,       NULL, OPT_MOSAIC},
+        {"no-clipboard-sync", no_argument,  NULL, OPT_NO_CLIPBOARD_SYNC},
         {"port",         required_argument, NULL, 'p'},
         {"record",       required_argument, NULL, 'r'},
         {"serial",       required_argument, NULL, 's'},
         {"show-touches", no_argument,       NULL, 't'},
+        {"thumbnail-interval", required_argument, NULL,
+                                                  OPT_THUMBNAIL_INTERVAL},
         {"version",      no_argument,       NULL, 'v'},
         {NULL,           0,                 NULL, 0  },
     };
@@ -276,7 +454,15 @@ static SDL_bool parse_args(struct args *args, int argc, char *argv[]) {
                 args->record_filename = optarg;
                 break;
             case 's':
-                args->serial = optarg;
+                if (!args->serials) {
+                    // each serial is an argument, so there are fewer than argc
+                    args->serials = SDL_malloc(argc * sizeof(*args->serials));
+                    if (!args->serials) {
+                        LOGC("Could not allocate serials");
+                        return SDL_FALSE;
+                    }
+                }
+                args->serials[args->serial_count++] = optarg;
                 break;
             case 't':
                 args->show_touches = SDL_TRUE;
@@ -288,6 +474,47 @@ static SDL_bool parse_args(struct args *args, int argc, char *argv[]) {
                 if (!parse_id(optarg, &args->vid, &args->pid))
                     return SDL_FALSE;
                 break;
+            case OPT_THUMBNAIL_INTERVAL:
+                if (!parse_thumbnail_interval(optarg,
+                                              &args->thumbnail_interval)) {
+                    return SDL_FALSE;
+                }
+                break;
+            case OPT_NO_CLIPBOARD_SYNC:
+                args->clipboard_sync = SDL_FALSE;
+                break;
+            case OPT_HID_POINTER:
+                args->hid_pointer = SDL_TRUE;
+                break;
+            case OPT_CACHE_SERVER:
+                args->cache_server = SDL_TRUE;
+                break;
+            case OPT_DAEMON:
+                args->daemon = SDL_TRUE;
+                break;
+            case OPT_MOSAIC:
+                args->mosaic = SDL_TRUE;
+                break;
+            case OPT_FRAME_SINK:
+                args->frame_sink_name = optarg;
+                break;
+            case OPT_FRAME_PACING:
+                if (!parse_frame_pacing(optarg, &args->present_mode)) {
+                    return SDL_FALSE;
+                }
+                break;
+            case OPT_DIRECT_TCP:
+                if (!parse_direct_tcp(optarg, &args->direct_addr,
+                                      &args->direct_port)) {
+                    return SDL_FALSE;
+                }
+                break;
+            case OPT_CONTROL_QUEUE_SIZE:
+                if (!parse_control_queue_size(optarg,
+                                              &args->control_queue_size)) {
+                    return SDL_FALSE;
+                }
+                break;
             default:
                 // getopt prints the error message on stderr
                 return SDL_FALSE;
@@ -299,6 +526,45 @@ static SDL_bool parse_args(struct args *args, int argc, char *argv[]) {
         LOGE("Unexpected additional argument: %s", argv[index]);
         return SDL_FALSE;
     }
+
+#ifndef FRAME_SINK
+    if (args->frame_sink_name) {
+        LOGE("--frame-sink is not supported on this platform");
+        return SDL_FALSE;
+    }
+#endif
+
+    if (args->hid_pointer && args->crop) {
+        // the HID coordinates are absolute on the whole device screen, whose
+        // size is unknown to the client (only the cropped video size is)
+        LOGE("--hid-pointer and --crop are not compatible");
+        return SDL_FALSE;
+    }
+
+    if (args->daemon && args->direct_addr) {
+        LOGE("--daemon and --direct-tcp are not compatible");
+        return SDL_FALSE;
+    }
+
+    if (args->serial_count > 1) {
+        if (args->record_filename) {
+            LOGE("Recording is only supported for a single device");
+            return SDL_FALSE;
+        }
+        if (args->direct_addr) {
+            LOGE("--direct-tcp is only supported for a single device");
+            return SDL_FALSE;
+        }
+        if (args->port + args->serial_count - 1 > 0xFFFF) {
+            LOGE("Not enough local ports from %d", (int) args->port);
+            return SDL_FALSE;
+        }
+    }
+
+    if (args->mosaic && !args->max_size) {
+        // many full-resolution videos would not fit in a single window
+        args->max_size = DEFAULT_MOSAIC_MAX_SIZE;
+    }
     return SDL_TRUE;
 }
 
@@ -310,15 +576,27 @@ int main(int argc, char *argv[]) {
     setbuf(stderr, NULL);
 #endif
     struct args args = {
-        .serial = NULL,
+        .serials = NULL,
+        .serial_count = 0,
         .crop = NULL,
         .record_filename = NULL,
+        .frame_sink_name = NULL,
         .help = SDL_FALSE,
         .version = SDL_FALSE,
         .show_touches = SDL_FALSE,
+        .clipboard_sync = SDL_TRUE,
+        .hid_pointer = SDL_FALSE,
+        .cache_server = SDL_FALSE,
+        .daemon = SDL_FALSE,
+        .mosaic = SDL_FALSE,
+        .present_mode = PRESENT_LATENCY,
+        .direct_addr = 0,
+        .direct_port = DEFAULT_DIRECT_PORT,
         .port = DEFAULT_LOCAL_PORT,
         .max_size = DEFAULT_MAX_SIZE,
         .bit_rate = DEFAULT_BIT_RATE,
+        .thumbnail_interval = DEFAULT_THUMBNAIL_INTERVAL,
+        .control_queue_size = DEFAULT_CONTROL_QUEUE_SIZE,
     };
     if (!parse_args(&args, argc, argv)) {
         return 1;
@@ -347,18 +625,31 @@ int main(int argc, char *argv[]) {
 #endif
 
     struct scrcpy_options options = {
-        .serial = args.serial,
+        .serials = args.serials,
+        .serial_count = args.serial_count,
         .crop = args.crop,
         .port = args.port,
         .record_filename = args.record_filename,
+        .frame_sink_name = args.frame_sink_name,
         .max_size = args.max_size,
         .bit_rate = args.bit_rate,
+        .thumbnail_interval = args.thumbnail_interval,
+        .control_queue_size = args.control_queue_size,
         .show_touches = args.show_touches,
         .fullscreen = args.fullscreen,
+        .clipboard_sync = args.clipboard_sync,
+        .hid_pointer = args.hid_pointer,
+        .cache_server = args.cache_server,
+        .daemon = args.daemon,
+        .mosaic = args.mosaic,
+        .present_mode = args.present_mode,
+        .direct_addr = args.direct_addr,
+        .direct_port = args.direct_port,
         .vid = args.vid,
         .pid = args.pid,
     };
     int res = scrcpy(&options) ? 0 : 1;
+    SDL_free(args.serials);
 
     avformat_network_deinit(); // ignore failure
 
@@ -0,0 +1,314 @@
+#include "mosaic.h"
+
+#include "icon.xpm"
+#include "log.h"
+#include "mosaic_layout.h"
+#include "tiny_xpm.h"
+
+static void present_scheduled(void *opaque);
+
+SDL_bool mosaic_init(struct mosaic *mosaic, unsigned tile_count,
+                     Uint16 max_size, enum present_mode present_mode) {
+    mosaic->tiles = SDL_calloc(tile_count, sizeof(*mosaic->tiles));
+    if (!mosaic->tiles) {
+        LOGC("Could not allocate mosaic tiles");
+        return SDL_FALSE;
+    }
+
+    // the devices are typically in portrait, so that a cell is half as wide
+    // as high
+    unsigned columns;
+    unsigned rows;
+    mosaic_layout_get_grid(tile_count, &columns, &rows);
+    Uint32 w = columns * max_size / 2;
+    Uint32 h = rows * max_size;
+    struct size bounds;
+    if (get_preferred_display_bounds(&bounds)) {
+        if (w > bounds.width) {
+            h = h * bounds.width / w;
+            w = bounds.width;
+        }
+        if (h > bounds.height) {
+            w = w * bounds.height / h;
+            h = bounds.height;
+        }
+    }
+
+    Uint32 window_flags = SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE;
+#ifdef HIDPI_SUPPORT
+    window_flags |= SDL_WINDOW_ALLOW_HIGHDPI;
+#endif
+    mosaic->window = SDL_CreateWindow("scrcpy", SDL_WINDOWPOS_UNDEFINED,
+                                      SDL_WINDOWPOS_UNDEFINED, w, h,
+                                      window_flags);
+    if (!mosaic->window) {
+        LOGC("Could not create window: %s", SDL_GetError());
+        goto error_free_tiles;
+    }
+
+    mosaic->renderer = SDL_CreateRenderer(mosaic->window, -1,
+                            present_scheduler_get_renderer_flags(present_mode));
+    if (!mosaic->renderer) {
+        LOGC("Could not create renderer: %s", SDL_GetError());
+        goto error_destroy_window;
+    }
+
+    SDL_Surface *icon = read_xpm(icon_xpm);
+    if (!icon) {
+        LOGE("Could not load icon: %s", SDL_GetError());
+        goto error_destroy_renderer;
+    }
+    SDL_SetWindowIcon(mosaic->window, icon);
+    SDL_FreeSurface(icon);
+
+    if (!present_scheduler_init(&mosaic->scheduler, present_mode,
+                                mosaic->window, present_scheduled, mosaic)) {
+        goto error_destroy_renderer;
+    }
+
+    // created on the first render, at the output size
+    mosaic->target = NULL;
+    mosaic->target_size = (struct size) {0, 0};
+    mosaic->tile_count = tile_count;
+    mosaic->dirty = SDL_FALSE;
+    mosaic->invalid = SDL_TRUE;
+    mosaic->grabbed = -1;
+    mosaic->focused = 0;
+    mosaic->keys_down = 0;
+    return SDL_TRUE;
+
+error_destroy_renderer:
+    SDL_DestroyRenderer(mosaic->renderer);
+error_destroy_window:
+    SDL_DestroyWindow(mosaic->window);
+error_free_tiles:
+    SDL_free(mosaic->tiles);
+    return SDL_FALSE;
+}
+
+void mosaic_destroy(struct mosaic *mosaic) {
+    present_scheduler_destroy(&mosaic->scheduler);
+    if (mosaic->target) {
+        SDL_DestroyTexture(mosaic->target);
+    }
+    SDL_DestroyRenderer(mosaic->renderer);
+    SDL_DestroyWindow(mosaic->window);
+    SDL_free(mosaic->tiles);
+}
+
+static struct size get_output_size(struct mosaic *mosaic) {
+    int width;
+    int height;
+    if (SDL_GetRendererOutputSize(mosaic->renderer, &width, &height)) {
+        SDL_GetWindowSize(mosaic->window, &width, &height);
+    }
+    return (struct size) {width, height};
+}
+
+// convert window coordinates to output coordinates (they differ on HiDPI)
+static void to_output_point(struct mosaic *mosaic, struct size output,
+                            int *x, int *y) {
+    int width;
+    int height;
+    SDL_GetWindowSize(mosaic->window, &width, &height);
+    if (width && height) {
+        *x = *x * output.width / width;
+        *y = *y * output.height / height;
+    }
+}
+
+static int find_tile(struct mosaic *mosaic, int x, int y) {
+    struct size output = get_output_size(mosaic);
+    to_output_point(mosaic, output, &x, &y);
+    int index = mosaic_layout_get_cell_index(mosaic->tile_count, output, x, y);
+    if (index != -1 && !mosaic->tiles[index]) {
+        // not initialized yet
+        return -1;
+    }
+    return index;
+}
+
+// the target (if any) must be the current render target
+static void draw_tile(struct mosaic *mosaic, unsigned index,
+                      struct size output) {
+    struct screen *screen = mosaic->tiles[index];
+    if (!screen || !screen->has_frame) {
+        return;
+    }
+    SDL_Rect rect = mosaic_layout_get_tile_rect(mosaic->tile_count, index,
+                                                output, screen->frame_size);
+    SDL_RenderCopy(mosaic->renderer, screen->texture, NULL, &rect);
+}
+
+static void draw_all(struct mosaic *mosaic, struct size output) {
+    SDL_SetRenderDrawColor(mosaic->renderer, 0, 0, 0, 255);
+    SDL_RenderClear(mosaic->renderer);
+    for (unsigned i = 0; i < mosaic->tile_count; ++i) {
+        draw_tile(mosaic, i, output);
+    }
+}
+
+// recreate the target if the output has been resized
+static void prepare_target(struct mosaic *mosaic, struct size output) {
+    if (mosaic->target && mosaic->target_size.width == output.width
+            && mosaic->target_size.height == output.height) {
+        return;
+    }
+    if (mosaic->target) {
+        SDL_DestroyTexture(mosaic->target);
+        mosaic->target = NULL;
+    }
+    if (!SDL_RenderTargetSupported(mosaic->renderer)) {
+        return;
+    }
+    mosaic->target = SDL_CreateTexture(mosaic->renderer,
+                                       SDL_PIXELFORMAT_ARGB8888,
+                                       SDL_TEXTUREACCESS_TARGET,
+                                       output.width, output.height);
+    if (!mosaic->target) {
+        LOGW("Could not create mosaic target: %s", SDL_GetError());
+        return;
+    }
+    mosaic->target_size = output;
+    mosaic->invalid = SDL_TRUE;
+}
+
+static void present(struct mosaic *mosaic) {
+    if (mosaic->target) {
+        SDL_SetRenderTarget(mosaic->renderer, NULL);
+        SDL_RenderCopy(mosaic->renderer, mosaic->target, NULL, NULL);
+    }
+    Uint64 start = present_scheduler_now();
+    SDL_RenderPresent(mosaic->renderer);
+    present_scheduler_presented(&mosaic->scheduler, start);
+    mosaic->dirty = SDL_FALSE;
+}
+
+void mosaic_update_tile(struct mosaic *mosaic, unsigned index) {
+    if (mosaic->target && !mosaic->invalid) {
+        struct size output = get_output_size(mosaic);
+        if (output.width == mosaic->target_size.width
+                && output.height == mosaic->target_size.height) {
+            // only redraw this tile, the others are unchanged
+            SDL_SetRenderTarget(mosaic->renderer, mosaic->target);
+            draw_tile(mosaic, index, output);
+        } else {
+            mosaic->invalid = SDL_TRUE;
+        }
+    }
+    mosaic->dirty = SDL_TRUE;
+}
+
+static void present_dirty(struct mosaic *mosaic) {
+    if (!mosaic->dirty) {
+        return;
+    }
+    if (!mosaic->target || mosaic->invalid) {
+        mosaic_render(mosaic);
+        return;
+    }
+    present(mosaic);
+}
+
+// called on EVENT_PRESENT
+static void present_scheduled(void *opaque) {
+    present_dirty(opaque);
+}
+
+void mosaic_present(struct mosaic *mosaic) {
+    if (mosaic->dirty && present_scheduler_request(&mosaic->scheduler)) {
+        present_dirty(mosaic);
+    }
+}
+
+void mosaic_render(struct mosaic *mosaic) {
+    struct size output = get_output_size(mosaic);
+    prepare_target(mosaic, output);
+    if (mosaic->target) {
+        SDL_SetRenderTarget(mosaic->renderer, mosaic->target);
+    }
+    draw_all(mosaic, output);
+    mosaic->invalid = SDL_FALSE;
+    present(mosaic);
+}
+
+void mosaic_to_tile_point(struct mosaic *mosaic, unsigned index, int *x,
+                          int *y) {
+    struct screen *screen = mosaic->tiles[index];
+    struct size output = get_output_size(mosaic);
+    to_output_point(mosaic, output, x, y);
+    SDL_Rect rect = mosaic_layout_get_tile_rect(mosaic->tile_count, index,
+                                                output, screen->frame_size);
+    if (!rect.w || !rect.h) {
+        *x = -1;
+        *y = -1;
+        return;
+    }
+    // negative if on the left or above the frame
+    *x = *x >= rect.x ? (*x - rect.x) * screen->frame_size.width / rect.w : -1;
+    *y = *y >= rect.y ? (*y - rect.y) * screen->frame_size.height / rect.h : -1;
+}
+
+// the tile receiving the mouse events, and update the grab
+static int route_mouse_button(struct mosaic *mosaic,
+                              SDL_MouseButtonEvent *event) {
+    int index = mosaic->grabbed != -1 ? mosaic->grabbed
+                                      : find_tile(mosaic, event->x, event->y);
+    if (index == -1) {
+        return -1;
+    }
+    if (event->type == SDL_MOUSEBUTTONDOWN) {
+        // the motion and the release go to the same tile, even outside
+        mosaic->grabbed = index;
+        mosaic->focused = index;
+    } else if (!SDL_GetMouseState(NULL, NULL)) {
+        // all the buttons are released
+        mosaic->grabbed = -1;
+    }
+    mosaic_to_tile_point(mosaic, index, &event->x, &event->y);
+    return index;
+}
+
+int mosaic_route_event(struct mosaic *mosaic, SDL_Event *event) {
+    int x;
+    int y;
+    int index;
+    switch (event->type) {
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            return route_mouse_button(mosaic, &event->button);
+        case SDL_MOUSEMOTION:
+            index = mosaic->grabbed != -1
+                  ? mosaic->grabbed
+                  : find_tile(mosaic, event->motion.x, event->motion.y);
+            if (index != -1) {
+                mosaic_to_tile_point(mosaic, index, &event->motion.x,
+                                     &event->motion.y);
+            }
+            return index;
+        case SDL_MOUSEWHEEL:
+        case SDL_DROPFILE:
+            // the input manager reads the position of the wheel itself
+            SDL_GetMouseState(&x, &y);
+            return find_tile(mosaic, x, y);
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+        case SDL_TEXTINPUT:
+            if (!mosaic->keys_down) {
+                // a key must be released on the tile it was pressed on
+                SDL_GetMouseState(&x, &y);
+                index = find_tile(mosaic, x, y);
+                if (index != -1) {
+                    mosaic->focused = index;
+                }
+            }
+            if (event->type == SDL_KEYDOWN && !event->key.repeat) {
+                ++mosaic->keys_down;
+            } else if (event->type == SDL_KEYUP && mosaic->keys_down) {
+                --mosaic->keys_down;
+            }
+            return mosaic->tiles[mosaic->focused] ? mosaic->focused : -1;
+        default:
+            return -1;
+    }
+}
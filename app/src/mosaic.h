@@ -0,0 +1,65 @@
+#ifndef MOSAIC_H
+#define MOSAIC_H
+
+#include <SDL2/SDL.h>
+
+#include "common.h"
+#include "present_scheduler.h"
+#include "screen.h"
+
+// Show several devices in a single window, as a grid of tiles.
+//
+// Each tile is a struct screen (initialized by screen_init_tile()) which owns
+// its texture, but shares the window and the renderer of the mosaic. The
+// tiles are composed into a target texture, so that a new frame only redraws
+// its own tile; the window is presented once all the pending events are
+// processed (mosaic_present()), whatever the number of new frames, or later
+// according to the present mode.
+//
+// The input events are routed to the tile under the mouse.
+struct mosaic {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    // the composed tiles, NULL if the renderer does not support render
+    // targets (all the tiles are then drawn on every present)
+    SDL_Texture *target;
+    struct size target_size;
+    struct screen **tiles; // NULL for the tiles not initialized yet
+    unsigned tile_count;
+    SDL_bool dirty; // a tile has changed since the last present
+    SDL_bool invalid; // the target must be redrawn entirely
+    // the tile receiving the mouse events while a button is pressed, -1 if
+    // none
+    int grabbed;
+    // the tile receiving the keyboard events (the one under the mouse, unless
+    // a key is pressed)
+    int focused;
+    unsigned keys_down;
+    struct present_scheduler scheduler;
+};
+
+// the window is sized for tiles of max_size
+SDL_bool mosaic_init(struct mosaic *mosaic, unsigned tile_count,
+                     Uint16 max_size, enum present_mode present_mode);
+void mosaic_destroy(struct mosaic *mosaic);
+
+// the texture of the tile has been updated (it is drawn on the next present)
+void mosaic_update_tile(struct mosaic *mosaic, unsigned index);
+
+// present the window if any tile has changed (now or on a later
+// EVENT_PRESENT)
+void mosaic_present(struct mosaic *mosaic);
+
+// redraw all the tiles and present the window (e.g. once resized)
+void mosaic_render(struct mosaic *mosaic);
+
+// return the tile of an input event (-1 if none), and convert its mouse
+// coordinates (if any) to the frame coordinates of the tile
+int mosaic_route_event(struct mosaic *mosaic, SDL_Event *event);
+
+// convert window coordinates to the frame coordinates of the tile (negative or
+// beyond the frame size if outside the frame)
+void mosaic_to_tile_point(struct mosaic *mosaic, unsigned index, int *x,
+                          int *y);
+
+#endif
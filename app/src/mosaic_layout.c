@@ -0,0 +1,64 @@
+#include "mosaic_layout.h"
+
+void mosaic_layout_get_grid(unsigned count, unsigned *columns, unsigned *rows) {
+    unsigned c = 1;
+    while (c * c < count) {
+        ++c;
+    }
+    *columns = c;
+    *rows = count ? (count + c - 1) / c : 1;
+}
+
+SDL_Rect mosaic_layout_get_tile_rect(unsigned count, unsigned index,
+                                     struct size output, struct size frame) {
+    unsigned columns;
+    unsigned rows;
+    mosaic_layout_get_grid(count, &columns, &rows);
+    int cell_width = output.width / columns;
+    int cell_height = output.height / rows;
+
+    SDL_Rect rect = {
+        .x = (index % columns) * cell_width,
+        .y = (index / columns) * cell_height,
+        .w = cell_width,
+        .h = cell_height,
+    };
+    if (!frame.width || !frame.height) {
+        // no frame yet, the whole cell
+        return rect;
+    }
+
+    // 32 bits because we need to multiply two 16 bits values
+    if ((Uint32) frame.width * cell_height
+            > (Uint32) frame.height * cell_width) {
+        // black borders on top and bottom
+        rect.h = (Uint32) frame.height * cell_width / frame.width;
+        rect.y += (cell_height - rect.h) / 2;
+    } else {
+        // black borders on left and right
+        rect.w = (Uint32) frame.width * cell_height / frame.height;
+        rect.x += (cell_width - rect.w) / 2;
+    }
+    return rect;
+}
+
+int mosaic_layout_get_cell_index(unsigned count, struct size output,
+                                 int x, int y) {
+    unsigned columns;
+    unsigned rows;
+    mosaic_layout_get_grid(count, &columns, &rows);
+    int cell_width = output.width / columns;
+    int cell_height = output.height / rows;
+    if (x < 0 || y < 0 || !cell_width || !cell_height) {
+        return -1;
+    }
+
+    unsigned column = x / cell_width;
+    unsigned row = y / cell_height;
+    if (column >= columns || row >= rows) {
+        // in the remainder of the division of the output
+        return -1;
+    }
+    unsigned index = row * columns + column;
+    return index < count ? (int) index : -1;
+}
@@ -0,0 +1,24 @@
+#ifndef MOSAIC_LAYOUT_H
+#define MOSAIC_LAYOUT_H
+
+#include <SDL2/SDL_rect.h>
+#include <SDL2/SDL_stdinc.h>
+
+#include "common.h"
+
+// The tiles of a mosaic are laid out in a grid as square as possible, filled
+// row by row. Each tile is scaled to fit its cell, keeping its aspect ratio.
+//
+// All the coordinates are relative to the output (the renderer, in pixels).
+
+void mosaic_layout_get_grid(unsigned count, unsigned *columns, unsigned *rows);
+
+// the area of the frame of the tile index
+SDL_Rect mosaic_layout_get_tile_rect(unsigned count, unsigned index,
+                                     struct size output, struct size frame);
+
+// the cell containing the point, -1 if none
+int mosaic_layout_get_cell_index(unsigned count, struct size output,
+                                 int x, int y);
+
+#endif
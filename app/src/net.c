@@ -10,6 +10,7 @@
 # include <sys/types.h>
 # include <sys/socket.h>
 # include <netinet/in.h>
+# include <netinet/tcp.h>
 # include <arpa/inet.h>
 # include <unistd.h>
 # define SOCKET_ERROR -1
@@ -18,13 +19,55 @@
   typedef struct in_addr IN_ADDR;
 #endif
 
-socket_t net_connect(Uint32 addr, Uint16 port) {
+static SDL_bool set_option(socket_t socket, int level, int name, int value,
+                           const char *desc) {
+    if (setsockopt(socket, level, name, (const void *) &value,
+                   sizeof(value)) == SOCKET_ERROR) {
+        LOGW("Could not set socket option %s to %d", desc, value);
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+SDL_bool net_set_options(socket_t socket,
+                         const struct net_socket_options *options) {
+    SDL_bool ok = SDL_TRUE;
+    if (options->rcvbuf) {
+        ok = set_option(socket, SOL_SOCKET, SO_RCVBUF, options->rcvbuf,
+                        "SO_RCVBUF") && ok;
+    }
+    if (options->sndbuf) {
+        ok = set_option(socket, SOL_SOCKET, SO_SNDBUF, options->sndbuf,
+                        "SO_SNDBUF") && ok;
+    }
+    if (options->nodelay) {
+        ok = set_option(socket, IPPROTO_TCP, TCP_NODELAY, 1,
+                        "TCP_NODELAY") && ok;
+    }
+    if (options->busy_poll) {
+#ifdef SO_BUSY_POLL
+        // may require CAP_NET_ADMIN above the net.core.busy_read sysctl
+        ok = set_option(socket, SOL_SOCKET, SO_BUSY_POLL, options->busy_poll,
+                        "SO_BUSY_POLL") && ok;
+#else
+        LOGD("SO_BUSY_POLL not available");
+#endif
+    }
+    return ok;
+}
+
+socket_t net_connect(Uint32 addr, Uint16 port,
+                     const struct net_socket_options *options) {
     socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock == INVALID_SOCKET) {
         perror("socket");
         return INVALID_SOCKET;
     }
 
+    if (options) {
+        net_set_options(sock, options); // ignore failure
+    }
+
     SOCKADDR_IN sin;
     sin.sin_family = AF_INET;
     sin.sin_addr.s_addr = htonl(addr);
@@ -32,13 +75,15 @@ socket_t net_connect(Uint32 addr, Uint16 port) {
 
     if (connect(sock, (SOCKADDR *) &sin, sizeof(sin)) == SOCKET_ERROR) {
         perror("connect");
+        net_close(sock);
         return INVALID_SOCKET;
     }
 
     return sock;
 }
 
-socket_t net_listen(Uint32 addr, Uint16 port, int backlog) {
+socket_t net_listen(Uint32 addr, Uint16 port, int backlog,
+                    const struct net_socket_options *options) {
     socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
     if (sock == INVALID_SOCKET) {
         perror("socket");
@@ -50,6 +95,14 @@ socket_t net_listen(Uint32 addr, Uint16 port, int backlog) {
         perror("setsockopt(SO_REUSEADDR)");
     }
 
+    if (options) {
+        struct net_socket_options buffers = {
+            .rcvbuf = options->rcvbuf,
+            .sndbuf = options->sndbuf,
+        };
+        net_set_options(sock, &buffers); // ignore failure
+    }
+
     SOCKADDR_IN sin;
     sin.sin_family = AF_INET;
     sin.sin_addr.s_addr = htonl(addr); // htonl() harmless on INADDR_ANY
@@ -68,10 +121,18 @@ socket_t net_listen(Uint32 addr, Uint16 port, int backlog) {
     return sock;
 }
 
-socket_t net_accept(socket_t server_socket) {
+socket_t net_accept(socket_t server_socket,
+                    const struct net_socket_options *options) {
     SOCKADDR_IN csin;
     socklen_t sinsize = sizeof(csin);
-    return accept(server_socket, (SOCKADDR *) &csin, &sinsize);
+    socket_t sock = accept(server_socket, (SOCKADDR *) &csin, &sinsize);
+    if (sock != INVALID_SOCKET && options) {
+        struct net_socket_options others = *options;
+        others.rcvbuf = 0;
+        others.sndbuf = 0;
+        net_set_options(sock, &others); // ignore failure
+    }
+    return sock;
 }
 
 ssize_t net_recv(socket_t socket, void *buf, size_t len) {
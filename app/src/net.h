@@ -16,12 +16,34 @@
   typedef int socket_t;
 #endif
 
+// options tuned for the traffic of a socket (0 or SDL_FALSE keeps the system
+// default); those not available on the platform are ignored
+struct net_socket_options {
+    int rcvbuf; // SO_RCVBUF, in bytes
+    int sndbuf; // SO_SNDBUF, in bytes
+    SDL_bool nodelay; // TCP_NODELAY: disable Nagle's algorithm
+    int busy_poll; // SO_BUSY_POLL (Linux), in microseconds
+};
+
 SDL_bool net_init(void);
 void net_cleanup(void);
 
-socket_t net_connect(Uint32 addr, Uint16 port);
-socket_t net_listen(Uint32 addr, Uint16 port, int backlog);
-socket_t net_accept(socket_t server_socket);
+// options may be NULL
+// the buffer sizes are set before connecting, since the TCP window scale is
+// negotiated on connection
+socket_t net_connect(Uint32 addr, Uint16 port,
+                     const struct net_socket_options *options);
+// options may be NULL; only the buffer sizes are set on the listening socket
+// (before listen()), they are inherited by the accepted sockets
+socket_t net_listen(Uint32 addr, Uint16 port, int backlog,
+                    const struct net_socket_options *options);
+// options may be NULL; the buffer sizes are ignored, they must be set on the
+// listening socket, since the handshake is already done
+socket_t net_accept(socket_t server_socket,
+                    const struct net_socket_options *options);
+// return SDL_FALSE if any (available) option could not be set
+SDL_bool net_set_options(socket_t socket,
+                         const struct net_socket_options *options);
 
 // the _all versions wait/retry until len bytes have been written/read
 ssize_t net_recv(socket_t socket, void *buf, size_t len);
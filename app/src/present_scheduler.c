@@ -0,0 +1,160 @@
+#include "present_scheduler.h"
+
+#include "events.h"
+#include "log.h"
+
+// if the display does not report its refresh rate
+#define DEFAULT_REFRESH_RATE 60
+// a present requested this close to the next vertical blank still catches it
+#define VBLANK_MARGIN 1000 // µs
+// a present which took this part of a refresh period waited for a vblank
+#define BLOCKED_DIVISOR 4
+// the intervals between presents longer than this number of refresh periods
+// are not taken into account in the stats
+#define STATS_MAX_PERIODS 4
+
+SDL_bool present_scheduler_init(struct present_scheduler *scheduler,
+                                enum present_mode mode, SDL_Window *window,
+                                present_scheduler_fn present, void *opaque) {
+    scheduler->mode = mode;
+    scheduler->window = window;
+    scheduler->present = present;
+    scheduler->opaque = opaque;
+    scheduler->timer = 0;
+    scheduler->pending = SDL_FALSE;
+    scheduler->last_vblank = 0;
+    scheduler->last_present = 0;
+    scheduler->count = 0;
+    scheduler->blocked = 0;
+    scheduler->interval_sum = 0;
+    scheduler->interval_square_sum = 0;
+    scheduler->interval_max = 0;
+    return SDL_TRUE;
+}
+
+void present_scheduler_destroy(struct present_scheduler *scheduler) {
+    if (scheduler->timer) {
+        SDL_RemoveTimer(scheduler->timer);
+    }
+    if (!scheduler->count) {
+        return;
+    }
+    double mean = scheduler->interval_sum / scheduler->count;
+    double variance = scheduler->interval_square_sum / scheduler->count
+                    - mean * mean;
+    // the jitter is the standard deviation of the intervals
+    double jitter = variance > 0 ? SDL_sqrt(variance) : 0;
+    LOGI("Presented frames every %.2f ms (jitter %.2f ms, max %.2f ms), "
+         "%u blocked on vsync", mean, jitter, scheduler->interval_max,
+         scheduler->blocked);
+}
+
+Uint32 present_scheduler_get_renderer_flags(enum present_mode mode) {
+    Uint32 flags = SDL_RENDERER_ACCELERATED;
+    if (mode == PRESENT_SMOOTH) {
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    return flags;
+}
+
+Uint64 present_scheduler_now(void) {
+    Uint64 counter = SDL_GetPerformanceCounter();
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    // avoid overflowing on counter * 1000000
+    return counter / frequency * 1000000
+         + counter % frequency * 1000000 / frequency;
+}
+
+// in microseconds
+static Uint64 get_refresh_period(struct present_scheduler *scheduler) {
+    int refresh_rate = 0;
+    // the window may have been moved to another display
+    int display = SDL_GetWindowDisplayIndex(scheduler->window);
+    SDL_DisplayMode mode;
+    if (display >= 0 && !SDL_GetCurrentDisplayMode(display, &mode)) {
+        refresh_rate = mode.refresh_rate;
+    }
+    if (refresh_rate <= 0) {
+        refresh_rate = DEFAULT_REFRESH_RATE;
+    }
+    return 1000000 / refresh_rate;
+}
+
+static Uint32 push_present_event(Uint32 interval, void *param) {
+    (void) interval;
+    SDL_Event event;
+    event.type = EVENT_PRESENT;
+    event.user.data1 = param;
+    SDL_PushEvent(&event);
+    // do not repeat
+    return 0;
+}
+
+SDL_bool present_scheduler_request(struct present_scheduler *scheduler) {
+    if (scheduler->mode == PRESENT_LATENCY) {
+        return SDL_TRUE;
+    }
+    if (scheduler->pending) {
+        // the frame will be presented with the scheduled present
+        return SDL_FALSE;
+    }
+    if (!scheduler->last_vblank) {
+        return SDL_TRUE;
+    }
+
+    Uint64 now = present_scheduler_now();
+    Uint64 next_vblank = scheduler->last_vblank
+                       + get_refresh_period(scheduler);
+    if (now + VBLANK_MARGIN >= next_vblank) {
+        return SDL_TRUE;
+    }
+
+    // round up, not to wake up just before the vertical blank
+    Uint32 delay = (next_vblank - now + 999) / 1000;
+    scheduler->timer = SDL_AddTimer(delay, push_present_event, scheduler);
+    if (!scheduler->timer) {
+        LOGW("Could not schedule present: %s", SDL_GetError());
+        return SDL_TRUE;
+    }
+    scheduler->pending = SDL_TRUE;
+    return SDL_FALSE;
+}
+
+void present_scheduler_presented(struct present_scheduler *scheduler,
+                                 Uint64 start) {
+    Uint64 now = present_scheduler_now();
+    Uint64 period = get_refresh_period(scheduler);
+
+    if (scheduler->mode == PRESENT_SMOOTH) {
+        if (now - start >= period / BLOCKED_DIVISOR) {
+            // SDL_RenderPresent() returned on a vertical blank
+            scheduler->last_vblank = now;
+            ++scheduler->blocked;
+        } else {
+            // the frame is queued for the next vertical blank, the next one
+            // must not be presented before a full period
+            scheduler->last_vblank = start;
+        }
+    }
+
+    if (scheduler->last_present) {
+        Uint64 interval = now - scheduler->last_present;
+        if (interval <= STATS_MAX_PERIODS * period) {
+            double ms = interval / 1000.0;
+            ++scheduler->count;
+            scheduler->interval_sum += ms;
+            scheduler->interval_square_sum += ms * ms;
+            if (ms > scheduler->interval_max) {
+                scheduler->interval_max = ms;
+            }
+        }
+    }
+    scheduler->last_present = now;
+}
+
+void present_scheduler_handle_event(struct present_scheduler *scheduler) {
+    // the timer has expired
+    scheduler->timer = 0;
+    scheduler->pending = SDL_FALSE;
+    scheduler->present(scheduler->opaque);
+}
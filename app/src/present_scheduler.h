@@ -0,0 +1,66 @@
+#ifndef PRESENT_SCHEDULER_H
+#define PRESENT_SCHEDULER_H
+
+#include <SDL2/SDL.h>
+
+// Decide when a new frame is presented.
+//
+// In PRESENT_LATENCY mode, every frame is presented as soon as it is decoded,
+// without vsync (it may tear, and the frames are shown at uneven intervals).
+//
+// In PRESENT_SMOOTH mode, the renderer waits for the vertical blank, and at
+// most one frame is presented per refresh period: a frame arriving earlier is
+// presented at the next vertical blank (the texture is updated meanwhile, so
+// that only the last one is shown). This avoids both the tearing and blocking
+// the event loop (and the input) in SDL_RenderPresent() for several periods.
+enum present_mode {
+    PRESENT_LATENCY,
+    PRESENT_SMOOTH,
+};
+
+typedef void (*present_scheduler_fn)(void *opaque);
+
+struct present_scheduler {
+    enum present_mode mode;
+    SDL_Window *window;
+    present_scheduler_fn present; // called on EVENT_PRESENT
+    void *opaque;
+    SDL_TimerID timer;
+    SDL_bool pending; // a present is scheduled
+    Uint64 last_vblank; // estimated, in microseconds, 0 if unknown
+    Uint64 last_present; // in microseconds, 0 if none
+    // presentation stats, for the intervals shorter than a few refresh
+    // periods (the longer ones are just missing frames)
+    unsigned count;
+    unsigned blocked; // presents which waited for a vertical blank
+    double interval_sum; // in milliseconds
+    double interval_square_sum;
+    double interval_max;
+};
+
+SDL_bool present_scheduler_init(struct present_scheduler *scheduler,
+                                enum present_mode mode, SDL_Window *window,
+                                present_scheduler_fn present, void *opaque);
+
+// log the stats (may be called if the init failed or was not called, for a
+// zero-initialized scheduler)
+void present_scheduler_destroy(struct present_scheduler *scheduler);
+
+// the flags to create the renderer with
+Uint32 present_scheduler_get_renderer_flags(enum present_mode mode);
+
+// a new frame is ready: return SDL_TRUE if it must be presented now,
+// otherwise the present callback will be called on a later EVENT_PRESENT
+SDL_bool present_scheduler_request(struct present_scheduler *scheduler);
+
+// return the current time, to be passed to present_scheduler_presented()
+Uint64 present_scheduler_now(void);
+
+// the renderer has been presented, started at the given time
+void present_scheduler_presented(struct present_scheduler *scheduler,
+                                 Uint64 start);
+
+// handle an EVENT_PRESENT
+void present_scheduler_handle_event(struct present_scheduler *scheduler);
+
+#endif
@@ -0,0 +1,101 @@
+#include "receiver.h"
+
+#include <string.h>
+#include <SDL2/SDL_assert.h>
+#include <SDL2/SDL_events.h>
+
+#include "events.h"
+#include "log.h"
+
+void receiver_init(struct receiver *receiver, socket_t control_socket) {
+    receiver->control_socket = control_socket;
+}
+
+static void process_message(struct receiver *receiver,
+                            struct device_message *msg) {
+    switch (msg->type) {
+        case DEVICE_MESSAGE_TYPE_CLIPBOARD: {
+            SDL_Event event;
+            event.type = EVENT_DEVICE_CLIPBOARD;
+            // the main thread takes ownership of the text
+            event.user.data1 = msg->clipboard_message.text;
+            event.user.data2 = receiver;
+            if (SDL_PushEvent(&event) < 0) {
+                LOGW("Could not post device clipboard event: %s",
+                     SDL_GetError());
+                device_message_destroy(msg);
+            }
+            break;
+        }
+    }
+}
+
+// return the number of bytes consumed, or -1 on error
+static ssize_t process_messages(struct receiver *receiver,
+                                const unsigned char *buf, size_t len) {
+    size_t head = 0;
+    for (;;) {
+        struct device_message msg;
+        ssize_t r = device_message_deserialize(&buf[head], len - head, &msg);
+        if (r == -1) {
+            return -1;
+        }
+        if (r == 0) {
+            return head;
+        }
+
+        process_message(receiver, &msg);
+
+        head += r;
+        SDL_assert(head <= len);
+        if (head == len) {
+            return head;
+        }
+    }
+}
+
+static int run_receiver(void *data) {
+    struct receiver *receiver = data;
+
+    size_t head = 0;
+    for (;;) {
+        // a message is never larger than the buffer, so an incomplete one
+        // always leaves some space
+        SDL_assert(head < DEVICE_MESSAGE_MAX_SIZE);
+        ssize_t r = net_recv(receiver->control_socket, &receiver->buf[head],
+                             DEVICE_MESSAGE_MAX_SIZE - head);
+        if (r <= 0) {
+            LOGD("Receiver stopped");
+            break;
+        }
+        head += r;
+
+        ssize_t consumed = process_messages(receiver, receiver->buf, head);
+        if (consumed == -1) {
+            // the stream is broken
+            break;
+        }
+        if (consumed) {
+            head -= consumed;
+            // shift the remaining bytes
+            memmove(receiver->buf, &receiver->buf[consumed], head);
+        }
+    }
+    return 0;
+}
+
+SDL_bool receiver_start(struct receiver *receiver) {
+    LOGD("Starting receiver thread");
+
+    receiver->thread = SDL_CreateThread(run_receiver, "receiver", receiver);
+    if (!receiver->thread) {
+        LOGC("Could not start receiver thread");
+        return SDL_FALSE;
+    }
+
+    return SDL_TRUE;
+}
+
+void receiver_join(struct receiver *receiver) {
+    SDL_WaitThread(receiver->thread, NULL);
+}
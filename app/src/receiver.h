@@ -0,0 +1,24 @@
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+#include <SDL2/SDL_stdinc.h>
+#include <SDL2/SDL_thread.h>
+
+#include "device_message.h"
+#include "net.h"
+
+// receive the device messages from the control socket, and forward them to
+// the main thread
+struct receiver {
+    socket_t control_socket;
+    SDL_Thread *thread;
+    unsigned char buf[DEVICE_MESSAGE_MAX_SIZE];
+};
+
+void receiver_init(struct receiver *receiver, socket_t control_socket);
+
+SDL_bool receiver_start(struct receiver *receiver);
+// the receiver stops once the control socket is shut down
+void receiver_join(struct receiver *receiver);
+
+#endif
@@ -1,10 +1,16 @@
 #include "recorder.h"
 
+#include <inttypes.h>
 #include <libavutil/time.h>
 
 #include "config.h"
 #include "log.h"
 
+#define INDEX_SUFFIX ".idx"
+// both dimensions of a thumbnail are at most THUMBNAIL_MAX_SIZE
+#define THUMBNAIL_MAX_SIZE 160
+#define US_IN_ONE_SECOND 1000000
+
 static const AVOutputFormat *find_mp4_muxer(void) {
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 9, 100)
     void *opaque = NULL;
@@ -22,7 +28,8 @@ static const AVOutputFormat *find_mp4_muxer(void) {
 }
 
 SDL_bool recorder_init(struct recorder *recorder, const char *filename,
-                       struct size declared_frame_size) {
+                       struct size declared_frame_size,
+                       Uint32 thumbnail_interval) {
     recorder->filename = SDL_strdup(filename);
     if (!recorder->filename) {
         LOGE("Cannot strdup filename");
@@ -30,6 +37,12 @@ SDL_bool recorder_init(struct recorder *recorder, const char *filename,
     }
 
     recorder->declared_frame_size = declared_frame_size;
+    recorder->index_file = NULL;
+    recorder->thumbnail_interval = thumbnail_interval;
+    recorder->thumbnail_ctx = NULL;
+    recorder->thumbnail_frame = NULL;
+    recorder->next_thumbnail_pts = 0;
+    recorder->thumbnail_count = 0;
 
     return SDL_TRUE;
 }
@@ -38,6 +51,28 @@ void recorder_destroy(struct recorder *recorder) {
     SDL_free(recorder->filename);
 }
 
+static FILE *open_index_file(const char *filename) {
+    size_t len = strlen(filename);
+    char *path = SDL_malloc(len + sizeof(INDEX_SUFFIX));
+    if (!path) {
+        LOGE("Cannot allocate index path");
+        return NULL;
+    }
+    memcpy(path, filename, len);
+    memcpy(&path[len], INDEX_SUFFIX, sizeof(INDEX_SUFFIX)); // include '\0'
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        LOGW("Could not open index file: %s", path);
+    } else {
+        fprintf(file, "# scrcpy recording index\n"
+                      "# keyframe <pts_us> <byte_offset>\n"
+                      "# thumbnail <pts_us> <jpeg_file>\n");
+    }
+    SDL_free(path);
+    return file;
+}
+
 SDL_bool recorder_open(struct recorder *recorder, AVCodec *input_codec) {
     const AVOutputFormat *mp4 = find_mp4_muxer();
     if (!mp4) {
@@ -101,9 +136,20 @@ SDL_bool recorder_open(struct recorder *recorder, AVCodec *input_codec) {
         return SDL_FALSE;
     }
 
+    // the recording is still usable without index, so ignore failure
+    recorder->index_file = open_index_file(recorder->filename);
+
     return SDL_TRUE;
 }
 
+static void close_thumbnail_encoder(struct recorder *recorder) {
+    if (recorder->thumbnail_ctx) {
+        avcodec_close(recorder->thumbnail_ctx);
+        avcodec_free_context(&recorder->thumbnail_ctx);
+    }
+    av_frame_free(&recorder->thumbnail_frame);
+}
+
 void recorder_close(struct recorder *recorder) {
     int ret = av_write_trailer(recorder->ctx);
     if (ret < 0) {
@@ -111,8 +157,202 @@ void recorder_close(struct recorder *recorder) {
     }
     avio_close(recorder->ctx->pb);
     avformat_free_context(recorder->ctx);
+
+    close_thumbnail_encoder(recorder);
+    if (recorder->index_file) {
+        fclose(recorder->index_file);
+        recorder->index_file = NULL;
+    }
 }
 
 SDL_bool recorder_write(struct recorder *recorder, AVPacket *packet) {
-    return av_write_frame(recorder->ctx, packet) >= 0;
+    // the mp4 muxer writes the packet data at the current position, so this is
+    // the offset of the packet in the output file
+    int64_t offset = avio_tell(recorder->ctx->pb);
+    if (av_write_frame(recorder->ctx, packet) < 0) {
+        return SDL_FALSE;
+    }
+    if (recorder->index_file && (packet->flags & AV_PKT_FLAG_KEY)) {
+        fprintf(recorder->index_file, "keyframe %" PRIu64 " %" PRId64 "\n",
+                (uint64_t) packet->pts, offset);
+    }
+    return SDL_TRUE;
+}
+
+static SDL_bool open_thumbnail_encoder(struct recorder *recorder,
+                                       int width, int height) {
+    AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        LOGE("MJPEG encoder not found");
+        return SDL_FALSE;
+    }
+
+    recorder->thumbnail_ctx = avcodec_alloc_context3(codec);
+    if (!recorder->thumbnail_ctx) {
+        LOGC("Could not allocate thumbnail encoder context");
+        return SDL_FALSE;
+    }
+
+    recorder->thumbnail_ctx->width = width;
+    recorder->thumbnail_ctx->height = height;
+    // the MJPEG encoder requires the full range variant of YUV 4:2:0
+    recorder->thumbnail_ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+    recorder->thumbnail_ctx->time_base = (AVRational) {1, US_IN_ONE_SECOND};
+
+    if (avcodec_open2(recorder->thumbnail_ctx, codec, NULL) < 0) {
+        LOGE("Could not open MJPEG encoder");
+        avcodec_free_context(&recorder->thumbnail_ctx);
+        return SDL_FALSE;
+    }
+
+    recorder->thumbnail_frame = av_frame_alloc();
+    if (!recorder->thumbnail_frame) {
+        LOGC("Could not allocate thumbnail frame");
+        close_thumbnail_encoder(recorder);
+        return SDL_FALSE;
+    }
+
+    recorder->thumbnail_frame->format = AV_PIX_FMT_YUVJ420P;
+    recorder->thumbnail_frame->width = width;
+    recorder->thumbnail_frame->height = height;
+    if (av_frame_get_buffer(recorder->thumbnail_frame, 32) < 0) {
+        LOGC("Could not allocate thumbnail frame buffer");
+        close_thumbnail_encoder(recorder);
+        return SDL_FALSE;
+    }
+
+    return SDL_TRUE;
+}
+
+// nearest-neighbor downscaling, good enough for scrubbing thumbnails
+static void downscale_plane(const uint8_t *src, int src_linesize,
+                            uint8_t *dst, int dst_linesize,
+                            int dst_width, int dst_height, int factor) {
+    for (int y = 0; y < dst_height; ++y) {
+        const uint8_t *src_line = &src[y * factor * src_linesize];
+        uint8_t *dst_line = &dst[y * dst_linesize];
+        for (int x = 0; x < dst_width; ++x) {
+            dst_line[x] = src_line[x * factor];
+        }
+    }
+}
+
+static SDL_bool encode_thumbnail(struct recorder *recorder, AVPacket *packet) {
+// the new decoding/encoding API has been introduced by:
+// <http://git.videolan.org/?p=ffmpeg.git;a=commitdiff;h=7fc329e2dd6226dfecaa4a1d7adf353bf2773726>
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 0)
+    int ret = avcodec_send_frame(recorder->thumbnail_ctx,
+                                 recorder->thumbnail_frame);
+    if (ret < 0) {
+        LOGE("Could not send thumbnail frame: %d", ret);
+        return SDL_FALSE;
+    }
+    ret = avcodec_receive_packet(recorder->thumbnail_ctx, packet);
+    if (ret < 0) {
+        LOGE("Could not receive thumbnail packet: %d", ret);
+        return SDL_FALSE;
+    }
+#else
+    int got_packet;
+    int ret = avcodec_encode_video2(recorder->thumbnail_ctx, packet,
+                                    recorder->thumbnail_frame, &got_packet);
+    if (ret < 0 || !got_packet) {
+        LOGE("Could not encode thumbnail: %d", ret);
+        return SDL_FALSE;
+    }
+#endif
+    return SDL_TRUE;
+}
+
+static SDL_bool write_thumbnail_file(const char *path, const AVPacket *packet) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        LOGW("Could not open thumbnail file: %s", path);
+        return SDL_FALSE;
+    }
+    SDL_bool ok = fwrite(packet->data, 1, packet->size, file)
+                      == (size_t) packet->size;
+    if (fclose(file)) {
+        ok = SDL_FALSE;
+    }
+    if (!ok) {
+        LOGW("Could not write thumbnail file: %s", path);
+    }
+    return ok;
+}
+
+void recorder_write_thumbnail(struct recorder *recorder, const AVFrame *frame,
+                              uint64_t pts) {
+    if (!recorder->index_file || !recorder->thumbnail_interval
+            || pts < recorder->next_thumbnail_pts) {
+        return;
+    }
+    if (frame->format != AV_PIX_FMT_YUV420P) {
+        // the H.264 stream from the device is always YUV 4:2:0
+        return;
+    }
+
+    int major = frame->width > frame->height ? frame->width : frame->height;
+    int factor = (major + THUMBNAIL_MAX_SIZE - 1) / THUMBNAIL_MAX_SIZE;
+    // YUV 4:2:0 requires even dimensions
+    int width = (frame->width / factor) & ~1;
+    int height = (frame->height / factor) & ~1;
+    if (!width || !height) {
+        return;
+    }
+
+    if (recorder->thumbnail_ctx && (recorder->thumbnail_ctx->width != width
+            || recorder->thumbnail_ctx->height != height)) {
+        // the device has been rotated
+        close_thumbnail_encoder(recorder);
+    }
+    if (!recorder->thumbnail_ctx
+            && !open_thumbnail_encoder(recorder, width, height)) {
+        // do not retry on every frame
+        recorder->thumbnail_interval = 0;
+        return;
+    }
+
+    AVFrame *thumbnail = recorder->thumbnail_frame;
+    if (av_frame_make_writable(thumbnail) < 0) {
+        LOGE("Could not make thumbnail frame writable");
+        return;
+    }
+    downscale_plane(frame->data[0], frame->linesize[0],
+                    thumbnail->data[0], thumbnail->linesize[0],
+                    width, height, factor);
+    for (int i = 1; i < 3; ++i) {
+        downscale_plane(frame->data[i], frame->linesize[i],
+                        thumbnail->data[i], thumbnail->linesize[i],
+                        width / 2, height / 2, factor);
+    }
+    thumbnail->pts = pts;
+
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = NULL;
+    packet.size = 0;
+    if (!encode_thumbnail(recorder, &packet)) {
+        return;
+    }
+
+    size_t len = strlen(recorder->filename);
+    // ".%04u.jpg" is at most 15 chars
+    char *path = SDL_malloc(len + 16);
+    if (path) {
+        sprintf(path, "%s.%04u.jpg", recorder->filename,
+                recorder->thumbnail_count);
+        if (write_thumbnail_file(path, &packet)) {
+            fprintf(recorder->index_file, "thumbnail %" PRIu64 " %s\n", pts,
+                    path);
+            ++recorder->thumbnail_count;
+        }
+        SDL_free(path);
+    } else {
+        LOGE("Cannot allocate thumbnail path");
+    }
+    av_packet_unref(&packet);
+
+    recorder->next_thumbnail_pts =
+        pts + (uint64_t) recorder->thumbnail_interval * US_IN_ONE_SECOND;
 }
@@ -1,19 +1,32 @@
 #ifndef RECORDER_H
 #define RECORDER_H
 
+#include <stdio.h>
 #include <libavformat/avformat.h>
 #include <SDL2/SDL_stdinc.h>
 
 #include "common.h"
 
+// forward declarations
+typedef struct AVFrame AVFrame;
+
 struct recorder {
     char *filename;
     AVFormatContext *ctx;
     struct size declared_frame_size;
+    // sidecar index "<filename>.idx", listing the keyframe offsets and the
+    // thumbnails, so that a viewer may seek without decoding the whole file
+    FILE *index_file;
+    Uint32 thumbnail_interval; // in seconds, 0 to disable thumbnails
+    AVCodecContext *thumbnail_ctx; // lazily opened on the first frame
+    AVFrame *thumbnail_frame;
+    uint64_t next_thumbnail_pts;
+    unsigned thumbnail_count;
 };
 
 SDL_bool recorder_init(struct recorder *recoder, const char *filename,
-                       struct size declared_frame_size);
+                       struct size declared_frame_size,
+                       Uint32 thumbnail_interval);
 void recorder_destroy(struct recorder *recorder);
 
 SDL_bool recorder_open(struct recorder *recorder, AVCodec *input_codec);
@@ -21,4 +34,10 @@ void recorder_close(struct recorder *recorder);
 
 SDL_bool recorder_write(struct recorder *recorder, AVPacket *packet);
 
+// write a downscaled thumbnail of the decoded frame if the thumbnail interval
+// has elapsed since the last one
+// pts is the PTS (in microseconds) of the packet the frame was decoded from
+void recorder_write_thumbnail(struct recorder *recorder, const AVFrame *frame,
+                              uint64_t pts);
+
 #endif
@@ -0,0 +1,61 @@
+#include "recv_buffer.h"
+
+#include <string.h>
+#include <SDL2/SDL_assert.h>
+
+SDL_bool recv_buffer_init(struct recv_buffer *rb, socket_t socket,
+                          size_t capacity) {
+    rb->data = SDL_malloc(capacity);
+    if (!rb->data) {
+        return SDL_FALSE;
+    }
+    rb->socket = socket;
+    rb->capacity = capacity;
+    rb->head = 0;
+    rb->size = 0;
+    return SDL_TRUE;
+}
+
+void recv_buffer_destroy(struct recv_buffer *rb) {
+    SDL_free(rb->data);
+}
+
+ssize_t recv_buffer_read(struct recv_buffer *rb, void *buf, size_t len) {
+    if (!rb->size) {
+        if (len >= rb->capacity) {
+            // large read, no need to copy
+            return net_recv(rb->socket, buf, len);
+        }
+        ssize_t r = net_recv(rb->socket, rb->data, rb->capacity);
+        if (r <= 0) {
+            return r;
+        }
+        rb->head = 0;
+        rb->size = r;
+    }
+
+    if (len > rb->size) {
+        len = rb->size;
+    }
+    memcpy(buf, &rb->data[rb->head], len);
+    rb->head += len;
+    rb->size -= len;
+    return len;
+}
+
+ssize_t recv_buffer_read_all(struct recv_buffer *rb, void *buf, size_t len) {
+    size_t copied = 0;
+    while (copied < len) {
+        ssize_t r = recv_buffer_read(rb, (Uint8 *) buf + copied,
+                                     len - copied);
+        if (r == -1) {
+            return -1;
+        }
+        if (!r) {
+            // EOF
+            break;
+        }
+        copied += r;
+    }
+    return copied;
+}
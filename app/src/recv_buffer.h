@@ -0,0 +1,30 @@
+#ifndef RECV_BUFFER_H
+#define RECV_BUFFER_H
+
+#include <SDL2/SDL_stdinc.h>
+
+#include "net.h"
+
+// Buffered reader for a socket: read as much as available (up to capacity)
+// in a single recv(), and serve the small reads (like the packet headers)
+// from memory, to reduce the number of syscalls per packet.
+//
+// The buffer is only refilled once empty, so the data is always contiguous.
+struct recv_buffer {
+    socket_t socket;
+    Uint8 *data;
+    size_t capacity;
+    size_t head; // index of the first unread byte
+    size_t size; // number of unread bytes
+};
+
+SDL_bool recv_buffer_init(struct recv_buffer *rb, socket_t socket,
+                          size_t capacity);
+void recv_buffer_destroy(struct recv_buffer *rb);
+
+// same semantics as net_recv(): read at most len bytes, 0 on EOF, -1 on error
+ssize_t recv_buffer_read(struct recv_buffer *rb, void *buf, size_t len);
+// same semantics as net_recv_all(): read len bytes (less only on EOF)
+ssize_t recv_buffer_read_all(struct recv_buffer *rb, void *buf, size_t len);
+
+#endif
@@ -15,16 +15,20 @@
 #include "command.h"
 #include "common.h"
 #include "controller.h"
+#include "decode_pool.h"
 #include "decoder.h"
 #include "device.h"
 #include "events.h"
 #include "file_handler.h"
 #include "frames.h"
 #include "fps_counter.h"
+#include "hid_sender.h"
 #include "input_manager.h"
 #include "log.h"
 #include "lock_util.h"
+#include "mosaic.h"
 #include "net.h"
+#include "receiver.h"
 #include "recorder.h"
 #include "screen.h"
 #include "server.h"
@@ -32,21 +36,209 @@
 
 volatile int quited = 0;
 
-static struct server server = SERVER_INITIALIZER;
-static struct screen screen = SCREEN_INITIALIZER;
-static struct frames frames;
-static struct decoder decoder;
-static struct controller controller;
-static struct file_handler file_handler;
-static struct recorder recorder;
-
-static struct input_manager input_manager = {
-    .controller = &controller,
-    .frames = &frames,
-    .screen = &screen,
-    .server = &server,
+// the AOA HID devices are set up in the background, the event loop is
+// notified by EVENT_HID_SETUP_DONE
+struct hid_setup {
+    SDL_Thread *thread;
+    // posted once SDL is initialized, the result can then be notified
+    SDL_sem *sdl_initialized;
+    uint16_t vid;
+    uint16_t pid;
+    // if set, the device is found by its serial, and vid:pid are ignored
+    const char *serial;
+    SDL_bool with_pointer;
+    // set by the setup thread
+    SDL_bool ok;
+    SDL_bool pointer_ok;
+    SDL_bool libusb_initialized;
+    libusb_device *device;
+    libusb_device_handle *handle;
+    struct hid_sender sender;
+    SDL_bool sender_started;
 };
 
+// the time of each startup step since start_time, 0 if not reached yet
+struct startup_timeline {
+    Uint32 server_started;
+    Uint32 sdl_initialized;
+    Uint32 connected;
+    Uint32 hid_ready;
+};
+
+// everything related to one device (several devices may be mirrored by the
+// same process, each in its own window)
+struct session {
+    const struct scrcpy_options *options;
+    const char *serial; // NULL to use the only device connected to adb
+    Uint16 port;
+    struct server server;
+    struct screen screen;
+    struct frames frames;
+    struct decoder decoder;
+    struct controller controller;
+    struct receiver receiver;
+    struct file_handler file_handler;
+    struct recorder recorder;
+#ifdef FRAME_SINK
+    struct frame_sink frame_sink;
+#endif
+    struct hid_setup hid_setup;
+    struct input_manager input_manager;
+    struct startup_timeline timeline;
+    SDL_Thread *server_thread;
+    process_t proc_show_touches;
+    SDL_bool show_touches_waited;
+    SDL_bool receiver_started;
+    SDL_bool opened; // connected, and all its threads started
+    SDL_bool stopped; // the video stream has ended
+};
+
+static struct session *sessions;
+static unsigned session_count;
+
+// all the devices in a single window
+static struct mosaic mosaic;
+static SDL_bool use_mosaic;
+
+#ifdef IO_URING
+static struct uring_reader uring_reader;
+#endif
+static struct decode_pool decode_pool;
+
+static Uint32 start_time;
+
+static Uint32 startup_elapsed(void) {
+    Uint32 elapsed = SDL_GetTicks() - start_time;
+    // 0 means "not reached"
+    return elapsed ? elapsed : 1;
+}
+
+static const char *session_name(const struct session *session) {
+    return session->serial ? session->serial : "device";
+}
+
+static void log_startup_timeline(const struct session *session) {
+    const struct startup_timeline *timeline = &session->timeline;
+    LOGI("First frame of %s displayed in %" PRIu32 " ms (server started: %"
+         PRIu32 " ms, SDL initialized: %" PRIu32 " ms, connected: %" PRIu32
+         " ms)", session_name(session), startup_elapsed(),
+         timeline->server_started, timeline->sdl_initialized,
+         timeline->connected);
+}
+
+static void process_hid_setup_done(struct session *session) {
+    struct hid_setup *hid_setup = &session->hid_setup;
+    // the setup thread is terminated, its results may be read
+    SDL_WaitThread(hid_setup->thread, NULL);
+    hid_setup->thread = NULL;
+    if (!hid_setup->ok) {
+        return;
+    }
+    session->timeline.hid_ready = startup_elapsed();
+    LOGI("HID of %s ready in %" PRIu32 " ms", session_name(session),
+         session->timeline.hid_ready);
+    session->input_manager.hid_pointer = hid_setup->pointer_ok;
+    session->input_manager.hid_sender = &hid_setup->sender;
+}
+
+// the events which are not related to a window (e.g. pushed by the amos
+// handler) are for the first device
+static struct session *find_session_by_window(Uint32 window_id) {
+    if (!window_id) {
+        return &sessions[0];
+    }
+    for (unsigned i = 0; i < session_count; ++i) {
+        SDL_Window *window = sessions[i].screen.window;
+        if (window && SDL_GetWindowID(window) == window_id) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static struct session *find_session_by_decoder(const struct decoder *decoder) {
+    for (unsigned i = 0; i < session_count; ++i) {
+        if (&sessions[i].decoder == decoder) {
+            return &sessions[i];
+        }
+    }
+    SDL_assert(!"unknown decoder");
+    return NULL;
+}
+
+static struct session *find_session_by_receiver(
+        const struct receiver *receiver) {
+    for (unsigned i = 0; i < session_count; ++i) {
+        if (&sessions[i].receiver == receiver) {
+            return &sessions[i];
+        }
+    }
+    SDL_assert(!"unknown receiver");
+    return NULL;
+}
+
+static struct session *find_session_in_mosaic(SDL_Event *event) {
+    if (event->type == SDL_WINDOWEVENT) {
+        // the mosaic window is handled as the window of the first device
+        return &sessions[0];
+    }
+    int index = mosaic_route_event(&mosaic, event);
+    return index != -1 ? &sessions[index] : NULL;
+}
+
+// return SDL_FALSE if the event is not related to a window
+static SDL_bool get_event_window_id(const SDL_Event *event,
+                                    Uint32 *window_id) {
+    switch (event->type) {
+        case SDL_WINDOWEVENT:
+            *window_id = event->window.windowID;
+            return SDL_TRUE;
+        case SDL_TEXTINPUT:
+            *window_id = event->text.windowID;
+            return SDL_TRUE;
+        case SDL_KEYDOWN:
+        case SDL_KEYUP:
+            *window_id = event->key.windowID;
+            return SDL_TRUE;
+        case SDL_MOUSEMOTION:
+            *window_id = event->motion.windowID;
+            return SDL_TRUE;
+        case SDL_MOUSEWHEEL:
+            *window_id = event->wheel.windowID;
+            return SDL_TRUE;
+        case SDL_MOUSEBUTTONDOWN:
+        case SDL_MOUSEBUTTONUP:
+            *window_id = event->button.windowID;
+            return SDL_TRUE;
+        case SDL_DROPFILE:
+            *window_id = event->drop.windowID;
+            return SDL_TRUE;
+        default:
+            return SDL_FALSE;
+    }
+}
+
+static unsigned count_running_sessions(void) {
+    unsigned count = 0;
+    for (unsigned i = 0; i < session_count; ++i) {
+        if (!sessions[i].stopped) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+static unsigned count_visible_windows(void) {
+    unsigned count = 0;
+    for (unsigned i = 0; i < session_count; ++i) {
+        if (SDL_GetWindowFlags(sessions[i].screen.window)
+                & SDL_WINDOW_SHOWN) {
+            ++count;
+        }
+    }
+    return count;
+}
+
 #if defined(__APPLE__) || defined(__WINDOWS__)
 # define CONTINUOUS_RESIZING_WORKAROUND
 #endif
@@ -60,7 +252,10 @@ static struct input_manager input_manager = {
 static int event_watcher(void *data, SDL_Event *event) {
     if (event->type == SDL_WINDOWEVENT && event->window.event == SDL_WINDOWEVENT_RESIZED) {
         // called from another thread, not very safe, but it's a workaround!
-        screen_render(&screen);
+        struct session *session = find_session_by_window(event->window.windowID);
+        if (session) {
+            screen_render(&session->screen);
+        }
     }
     return 0;
 }
@@ -82,30 +277,82 @@ static void encoder_control(struct controller *controller, int suspend) {
     }
 }
 
+static void flush_if_idle(void) {
+    if (!SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT)) {
+        // all the pending events have been processed, report the HID changes
+        // and present the new tiles at once
+        for (unsigned i = 0; i < session_count; ++i) {
+            input_manager_flush_hid(&sessions[i].input_manager);
+        }
+        if (use_mosaic) {
+            mosaic_present(&mosaic);
+        }
+    }
+}
+
+// suspend or resume the encoders of the devices shown in the window
+static void control_window_encoders(SDL_Window *window, int suspend) {
+    for (unsigned i = 0; i < session_count; ++i) {
+        struct session *session = &sessions[i];
+        if (session->screen.window == window && !session->stopped) {
+            encoder_control(&session->controller, suspend);
+        }
+    }
+}
+
 static SDL_bool event_loop(void) {
 #ifdef CONTINUOUS_RESIZING_WORKAROUND
     SDL_AddEventWatch(event_watcher, NULL);
 #endif
     SDL_Event event;
     while (SDL_WaitEvent(&event)) {
+        struct session *session = NULL;
+        Uint32 window_id;
+        if (get_event_window_id(&event, &window_id)) {
+            session = use_mosaic ? find_session_in_mosaic(&event)
+                                 : find_session_by_window(window_id);
+            if (!session) {
+                // not a device window
+                if (event.type == SDL_DROPFILE) {
+                    SDL_free(event.drop.file);
+                }
+                flush_if_idle();
+                continue;
+            }
+        }
         switch (event.type) {
             case EVENT_DECODER_STOPPED:
                 LOGD("Video decoder stopped");
-                return SDL_FALSE;
+                session = find_session_by_decoder(event.user.data1);
+                session->stopped = SDL_TRUE;
+                if (!count_running_sessions()) {
+                    return SDL_FALSE;
+                }
+                // the other devices are still mirrored
+                LOGI("Device %s disconnected", session_name(session));
+                if (!use_mosaic) {
+                    SDL_HideWindow(session->screen.window);
+                }
+                break;
             case SDL_QUIT:
                 LOGD("User requested to quit");
                 quited = 1;
                 return SDL_TRUE;
             case EVENT_NEW_FRAME:
-                if (!screen.has_frame) {
-                    screen.has_frame = SDL_TRUE;
+                session = find_session_by_decoder(event.user.data1);
+                if (!session->screen.has_frame) {
+                    log_startup_timeline(session);
+                    session->screen.has_frame = SDL_TRUE;
                     // this is the very first frame, show the window
-                    screen_show_window(&screen);
+                    screen_show_window(&session->screen);
                 }
-                if (!screen_update_frame(&screen, &frames)) {
+                if (!screen_update_frame(&session->screen, &session->frames)) {
                     return SDL_FALSE;
                 }
                 break;
+            case EVENT_PRESENT:
+                present_scheduler_handle_event(event.user.data1);
+                break;
             case SDL_WINDOWEVENT:
                 switch (event.window.event) {
                     case SDL_WINDOWEVENT_FOCUS_GAINED:
@@ -113,32 +360,73 @@ static SDL_bool event_loop(void) {
                         break;
                     case SDL_WINDOWEVENT_EXPOSED:
                     case SDL_WINDOWEVENT_SIZE_CHANGED:
-                        screen_render(&screen);
+                        screen_render(&session->screen);
                         break;
                     case SDL_WINDOWEVENT_HIDDEN:
-                        encoder_control(input_manager.controller, 1);
+                        control_window_encoders(session->screen.window, 1);
                         break;
                     case SDL_WINDOWEVENT_SHOWN:
-                        encoder_control(input_manager.controller, 0);
+                        control_window_encoders(session->screen.window, 0);
+                        break;
+                    case SDL_WINDOWEVENT_CLOSE:
+                        // with a single window, SDL_QUIT follows
+                        if (session_count > 1 && !use_mosaic) {
+                            SDL_HideWindow(session->screen.window);
+                            if (!count_visible_windows()) {
+                                LOGD("User closed all the windows");
+                                quited = 1;
+                                return SDL_TRUE;
+                            }
+                        }
                         break;
                 }
                 break;
             case SDL_TEXTINPUT:
-                input_manager_process_text_input(&input_manager, &event.text);
+                input_manager_process_text_input(&session->input_manager,
+                                                 &event.text);
                 break;
             case SDL_KEYDOWN:
             case SDL_KEYUP:
-                input_manager_process_key(&input_manager, &event.key);
+                input_manager_process_key(&session->input_manager, &event.key);
                 break;
             case SDL_MOUSEMOTION:
-                input_manager_process_mouse_motion(&input_manager, &event.motion);
+                input_manager_process_mouse_motion(&session->input_manager,
+                                                   &event.motion);
                 break;
             case SDL_MOUSEWHEEL:
-                input_manager_process_mouse_wheel(&input_manager, &event.wheel);
+                input_manager_process_mouse_wheel(&session->input_manager,
+                                                  &event.wheel);
                 break;
             case SDL_MOUSEBUTTONDOWN:
             case SDL_MOUSEBUTTONUP:
-                input_manager_process_mouse_button(&input_manager, &event.button);
+                input_manager_process_mouse_button(&session->input_manager,
+                                                   &event.button);
+                break;
+            case SDL_CLIPBOARDUPDATE:
+                for (unsigned i = 0; i < session_count; ++i) {
+                    if (!sessions[i].stopped) {
+                        input_manager_process_clipboard_update(
+                                &sessions[i].input_manager);
+                    }
+                }
+                break;
+            case EVENT_HID_SETUP_DONE:
+                session = event.user.data1;
+                process_hid_setup_done(session);
+                if (!session->hid_setup.ok) {
+                    if (session_count == 1) {
+                        LOGE("Could not set up the HID devices");
+                        return SDL_FALSE;
+                    }
+                    // do not stop mirroring the other devices
+                    LOGW("Could not set up the HID devices of %s, its input "
+                         "is injected by the server", session_name(session));
+                }
+                break;
+            case EVENT_DEVICE_CLIPBOARD:
+                session = find_session_by_receiver(event.user.data2);
+                input_manager_process_device_clipboard(&session->input_manager,
+                                                       event.user.data1);
                 break;
             case SDL_DROPFILE: {
                 file_handler_action_t action;
@@ -147,10 +435,12 @@ static SDL_bool event_loop(void) {
                 } else {
                     action = ACTION_PUSH_FILE;
                 }
-                file_handler_request(&file_handler, action, event.drop.file);
+                file_handler_request(&session->file_handler, action,
+                                     event.drop.file);
                 break;
             }
         }
+        flush_if_idle();
     }
     return SDL_FALSE;
 }
@@ -170,12 +460,14 @@ static void wait_show_touches(process_t process) {
 
 #define SOCK_PATH "/tmp/scrcpy.socket"
 
+// the commands are for the first device
 static void handle(char c) {
     SDL_Event sdlevent;
+    SDL_zero(sdlevent);
     sdlevent.type = SDL_KEYUP;
     switch (c) {
         case 'z':
-            encoder_control(input_manager.controller, 0);
+            encoder_control(&sessions[0].controller, 0);
             break;
         case 'm':
             sdlevent.key.keysym.sym = SDLK_MUTE;
@@ -251,35 +543,256 @@ static void* amos_handler(void* arg) {
 }
 
 
-SDL_bool scrcpy(const struct scrcpy_options *options) {
-    SDL_bool send_frame_meta = !!options->record_filename;
-    if (!server_start(&server, options->serial, options->port,
+// the device rejects the HID events until it has registered the HID device
+#define HID_READY_TIMEOUT 2000 // ms
+#define HID_READY_POLL_INTERVAL 10 // ms
+
+// send a neutral report until the device accepts it
+static SDL_bool wait_hid_ready(libusb_device_handle *handle,
+                               uint16_t accessory_id,
+                               const unsigned char *report, uint16_t size) {
+    Uint32 deadline = SDL_GetTicks() + HID_READY_TIMEOUT;
+    int r;
+    while ((r = send_hid_event(handle, accessory_id, report, size))
+            == LIBUSB_ERROR_PIPE) {
+        if (SDL_TICKS_PASSED(SDL_GetTicks(), deadline)) {
+            LOGE("HID device %u not ready after %d ms",
+                 (unsigned) accessory_id, HID_READY_TIMEOUT);
+            return SDL_FALSE;
+        }
+        SDL_Delay(HID_READY_POLL_INTERVAL);
+    }
+    if (r) {
+        LOGE("Could not send HID event: %s", libusb_strerror(r));
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+static SDL_bool setup_hid(struct hid_setup *setup) {
+    if (libusb_init(NULL)) {
+        LOGE("Could not initialize libusb");
+        return SDL_FALSE;
+    }
+    setup->libusb_initialized = SDL_TRUE;
+
+    setup->device = find_device(setup->vid, setup->pid, setup->serial);
+    if (!setup->device) {
+        if (setup->serial) {
+            LOGE("USB device %s not found", setup->serial);
+        } else {
+            LOGE("Device %04x:%04x not found", setup->vid, setup->pid);
+        }
+        return SDL_FALSE;
+    }
+    if (setup->serial) {
+        LOGI("USB device %s found. Opening...", setup->serial);
+    } else {
+        LOGI("Device %04x:%04x found. Opening...", setup->vid, setup->pid);
+    }
+
+    int r = libusb_open(setup->device, &setup->handle);
+    if (r) {
+        print_libusb_error(r);
+        setup->handle = NULL;
+        return SDL_FALSE;
+    }
+
+    LOGI("Registering HID...");
+    if (register_hid(setup->handle, HID_KEYBOARD_ACCESSORY_ID,
+                     REPORT_DESC_SIZE)) {
+        LOGE("Registering HID failed");
+        return SDL_FALSE;
+    }
+
+    struct libusb_device_descriptor desc;
+    libusb_get_device_descriptor(setup->device, &desc);
+    int max_packet_size_0 = desc.bMaxPacketSize0;
+
+    LOGI("Sending HID descriptor...");
+    if (send_hid_descriptor(setup->handle, HID_KEYBOARD_ACCESSORY_ID,
+                            REPORT_DESC, REPORT_DESC_SIZE,
+                            max_packet_size_0)) {
+        LOGE("Sending HID descriptor failed");
+        return SDL_FALSE;
+    }
+
+    if (setup->with_pointer) {
+        LOGI("Registering HID pointer...");
+        if (register_hid(setup->handle, HID_POINTER_ACCESSORY_ID,
+                         HID_POINTER_REPORT_DESC_SIZE)
+                || send_hid_descriptor(setup->handle, HID_POINTER_ACCESSORY_ID,
+                                       HID_POINTER_REPORT_DESC,
+                                       HID_POINTER_REPORT_DESC_SIZE,
+                                       max_packet_size_0)) {
+            // the clicks are still injected by the server
+            LOGW("Could not register HID pointer");
+        } else {
+            setup->pointer_ok = SDL_TRUE;
+        }
+    }
+
+    // an event sent too early after the HID descriptor is rejected, probe the
+    // devices with reports which do not press anything
+    unsigned char keyboard_report[HID_KEYBOARD_REPORT_SIZE] = {
+        HID_KEYBOARD_REPORT_ID,
+    };
+    if (!wait_hid_ready(setup->handle, HID_KEYBOARD_ACCESSORY_ID,
+                        keyboard_report, sizeof(keyboard_report))) {
+        return SDL_FALSE;
+    }
+    if (setup->pointer_ok) {
+        unsigned char pointer_report[HID_POINTER_REPORT_SIZE];
+        struct position origin = {0};
+        hid_pointer_write_report(pointer_report, SDL_FALSE, origin);
+        if (!wait_hid_ready(setup->handle, HID_POINTER_ACCESSORY_ID,
+                            pointer_report, sizeof(pointer_report))) {
+            LOGW("HID pointer not ready");
+            setup->pointer_ok = SDL_FALSE;
+        }
+    }
+
+    // the HID reports are sent asynchronously, not to block the event loop
+    if (!hid_sender_init(&setup->sender, setup->handle)) {
+        LOGE("Could not initialize HID sender");
+        return SDL_FALSE;
+    }
+    if (!hid_sender_start(&setup->sender)) {
+        hid_sender_destroy(&setup->sender);
+        return SDL_FALSE;
+    }
+    setup->sender_started = SDL_TRUE;
+    return SDL_TRUE;
+}
+
+static int run_hid_setup(void *data) {
+    struct session *session = data;
+    struct hid_setup *setup = &session->hid_setup;
+    setup->ok = setup_hid(setup);
+
+    SDL_SemWait(setup->sdl_initialized);
+    SDL_Event event;
+    event.type = EVENT_HID_SETUP_DONE;
+    event.user.data1 = session;
+    SDL_PushEvent(&event);
+    return 0;
+}
+
+// release everything acquired by the setup thread, once it is terminated
+static void destroy_hid_setup(struct hid_setup *setup) {
+    if (setup->sender_started) {
+        hid_sender_stop(&setup->sender);
+        hid_sender_join(&setup->sender);
+        hid_sender_destroy(&setup->sender);
+    }
+    if (setup->handle) {
+        libusb_close(setup->handle);
+    }
+    if (setup->device) {
+        libusb_unref_device(setup->device);
+    }
+    if (setup->libusb_initialized) {
+        libusb_exit(NULL);
+    }
+    SDL_DestroySemaphore(setup->sdl_initialized);
+}
+
+static int run_server_start(void *data) {
+    struct session *session = data;
+    const struct scrcpy_options *options = session->options;
+    SDL_bool send_frame_meta = options->record_filename != NULL;
+    struct server_direct direct = {
+        .addr = options->direct_addr,
+        .port = options->direct_port,
+    };
+    if (!server_start(&session->server, session->serial, session->port,
                       options->max_size, options->bit_rate, options->crop,
-                      send_frame_meta)) {
+                      send_frame_meta, options->clipboard_sync,
+                      options->cache_server, options->daemon,
+                      options->direct_addr ? &direct : NULL)) {
+        return 1;
+    }
+    session->timeline.server_started = startup_elapsed();
+    return 0;
+}
+
+// start the startup steps of the device which run in the background
+static SDL_bool session_start(struct session *session,
+                              const struct scrcpy_options *options,
+                              unsigned index) {
+    session->options = options;
+    session->serial = options->serial_count ? options->serials[index] : NULL;
+    // each device has its own adb tunnel
+    session->port = options->port + index;
+    session->server = (struct server) SERVER_INITIALIZER;
+    session->screen = (struct screen) SCREEN_INITIALIZER;
+
+    struct input_manager *input_manager = &session->input_manager;
+    input_manager->controller = &session->controller;
+    input_manager->frames = &session->frames;
+    input_manager->screen = &session->screen;
+    input_manager->server = &session->server;
+    // set once the HID devices are ready (the clicks are injected by the
+    // server until then)
+    input_manager->hid_sender = NULL;
+    hid_keyboard_init(&input_manager->keyboard);
+
+    session->server_thread = SDL_CreateThread(run_server_start, "server_start",
+                                              session);
+    if (!session->server_thread) {
+        LOGC("Could not start server thread");
+        return SDL_FALSE;
+    }
+
+    struct hid_setup *hid_setup = &session->hid_setup;
+    hid_setup->vid = options->vid;
+    hid_setup->pid = options->pid;
+    // the devices may be of different models, or of the same model (with the
+    // same ids): find them by their USB serial number, which is their adb
+    // serial
+    hid_setup->serial = options->serial_count > 1 ? session->serial : NULL;
+    hid_setup->with_pointer = options->hid_pointer;
+    hid_setup->sdl_initialized = SDL_CreateSemaphore(0);
+    if (hid_setup->sdl_initialized) {
+        hid_setup->thread = SDL_CreateThread(run_hid_setup, "hid_setup",
+                                             session);
+    }
+    if (!hid_setup->thread) {
+        LOGC("Could not start HID setup thread");
+        int server_result;
+        SDL_WaitThread(session->server_thread, &server_result);
+        if (!server_result) {
+            server_stop(&session->server);
+            server_destroy(&session->server);
+        }
+        if (hid_setup->sdl_initialized) {
+            SDL_DestroySemaphore(hid_setup->sdl_initialized);
+        }
         return SDL_FALSE;
     }
 
-    process_t proc_show_touches = PROCESS_NONE;
-    SDL_bool show_touches_waited;
     if (options->show_touches) {
         LOGI("Enable show_touches");
-        proc_show_touches = set_show_touches_enabled(options->serial, SDL_TRUE);
-        show_touches_waited = SDL_FALSE;
+        session->proc_show_touches =
+            set_show_touches_enabled(session->serial, SDL_TRUE);
+        session->show_touches_waited = SDL_FALSE;
     }
+    return SDL_TRUE;
+}
 
-    SDL_bool ret = SDL_TRUE;
+// connect to the started server, and start the threads of the device
+// on failure, the server is stopped and destroyed
+static SDL_bool session_open(struct session *session,
+                             struct uring_reader *uring,
+                             struct decode_pool *pool) {
+    const struct scrcpy_options *options = session->options;
+    struct server *server = &session->server;
 
-    if (!sdl_init_and_configure()) {
-        ret = SDL_FALSE;
-        goto finally_destroy_server;
-    }
-
-    socket_t device_socket = server_connect_to(&server);
-    if (device_socket == INVALID_SOCKET) {
-        server_stop(&server);
-        ret = SDL_FALSE;
-        goto finally_destroy_server;
+    if (!server_connect_to(server)) {
+        server_stop(server);
+        goto error_destroy_server;
     }
+    session->timeline.connected = startup_elapsed();
 
     char device_name[DEVICE_NAME_FIELD_LENGTH];
     struct size frame_size;
@@ -287,152 +800,366 @@ SDL_bool scrcpy(const struct scrcpy_options *options) {
     // screenrecord does not send frames when the screen content does not change
     // therefore, we transmit the screen size before the video stream, to be able
     // to init the window immediately
-    if (!device_read_info(device_socket, device_name, &frame_size)) {
-        server_stop(&server);
-        ret = SDL_FALSE;
-        goto finally_destroy_server;
+    if (!device_read_info(server->video_socket, device_name, &frame_size)) {
+        server_stop(server);
+        goto error_destroy_server;
     }
 
-    if (!frames_init(&frames)) {
-        server_stop(&server);
-        ret = SDL_FALSE;
-        goto finally_destroy_server;
+    if (!frames_init(&session->frames)) {
+        server_stop(server);
+        goto error_destroy_server;
     }
 
-    if (!file_handler_init(&file_handler, server.serial)) {
-        ret = SDL_FALSE;
-        server_stop(&server);
-        goto finally_destroy_frames;
+    if (!file_handler_init(&session->file_handler, server->serial)) {
+        server_stop(server);
+        goto error_destroy_frames;
     }
 
+    struct frame_sink *sink = NULL;
+    if (options->frame_sink_name) {
+#ifdef FRAME_SINK
+        char name[sizeof(session->frame_sink.name)];
+        if (session_count > 1) {
+            // one shared memory object per device
+            snprintf(name, sizeof(name), "%s.%u", options->frame_sink_name,
+                     (unsigned) (session - sessions));
+        } else {
+            snprintf(name, sizeof(name), "%s", options->frame_sink_name);
+        }
+        if (frame_sink_init(&session->frame_sink, name, frame_size)) {
+            sink = &session->frame_sink;
+        }
+#endif
+        // without FRAME_SINK, the option is rejected by the command line
+        if (!sink) {
+            server_stop(server);
+            goto error_destroy_file_handler;
+        }
+    }
+
+    SDL_bool send_frame_meta = options->record_filename != NULL;
     struct recorder *rec = NULL;
     if (options->record_filename) {
-        if (!recorder_init(&recorder, options->record_filename, frame_size)) {
-            ret = SDL_FALSE;
-            server_stop(&server);
-            goto finally_destroy_file_handler;
+        if (!recorder_init(&session->recorder, options->record_filename,
+                           frame_size, options->thumbnail_interval)) {
+            server_stop(server);
+            goto error_destroy_frame_sink;
         }
-        rec = &recorder;
+        rec = &session->recorder;
     }
 
-    decoder_init(&decoder, &frames, &screen, device_socket, rec);
+    decoder_init(&session->decoder, &session->frames, &session->screen,
+                 server->video_socket, rec, send_frame_meta, uring, pool,
+                 sink);
+    session->input_manager.clipboard_sync = options->clipboard_sync;
 
     // now we consumed the header values, the socket receives the video stream
     // start the decoder
-    if (!decoder_start(&decoder)) {
-        ret = SDL_FALSE;
-        server_stop(&server);
-        goto finally_destroy_recorder;
+    if (!decoder_start(&session->decoder)) {
+        server_stop(server);
+        goto error_destroy_recorder;
     }
 
-    if (!controller_init(&controller, device_socket)) {
-        ret = SDL_FALSE;
-        goto finally_stop_decoder;
+    // the device messages (only the clipboard for now) are received on the
+    // control socket
+    session->receiver_started = SDL_FALSE;
+    if (options->clipboard_sync) {
+        receiver_init(&session->receiver, server->control_socket);
+        if (!receiver_start(&session->receiver)) {
+            goto error_stop_decoder;
+        }
+        session->receiver_started = SDL_TRUE;
     }
 
-    if (!controller_start(&controller)) {
-        ret = SDL_FALSE;
-        goto finally_destroy_controller;
+    if (!controller_init(&session->controller, server->control_socket,
+                         options->control_queue_size)) {
+        goto error_stop_decoder;
     }
 
-    if (!screen_init_rendering(&screen, device_name, frame_size)) {
-        ret = SDL_FALSE;
-        goto finally_stop_and_join_controller;
+    if (!controller_start(&session->controller)) {
+        goto error_destroy_controller;
     }
 
-    pthread_t handler;
-    {
-        if (pthread_create(&handler, NULL, amos_handler, NULL)) {
-            perror("pthread_create");
-            exit(1);
-        }
+    SDL_bool screen_ok = use_mosaic
+        ? screen_init_tile(&session->screen, &mosaic, session - sessions,
+                           frame_size)
+        : screen_init_rendering(&session->screen, device_name, frame_size,
+                                options->present_mode);
+    if (!screen_ok) {
+        goto error_stop_and_join_controller;
+    }
+
+    return SDL_TRUE;
+
+error_stop_and_join_controller:
+    controller_stop(&session->controller);
+    controller_join(&session->controller);
+error_destroy_controller:
+    controller_destroy(&session->controller);
+error_stop_decoder:
+    decoder_stop(&session->decoder);
+    // stop the server before decoder_join() to wake up the decoder (and the
+    // receiver)
+    server_stop(server);
+    decoder_join(&session->decoder);
+    if (session->receiver_started) {
+        receiver_join(&session->receiver);
+    }
+error_destroy_recorder:
+    if (rec) {
+        recorder_destroy(rec);
+    }
+error_destroy_frame_sink:
+#ifdef FRAME_SINK
+    if (sink) {
+        frame_sink_destroy(sink);
     }
+#endif
+error_destroy_file_handler:
+    file_handler_stop(&session->file_handler);
+    file_handler_join(&session->file_handler);
+    file_handler_destroy(&session->file_handler);
+error_destroy_frames:
+    frames_destroy(&session->frames);
+error_destroy_server:
+    server_destroy(server);
+    return SDL_FALSE;
+}
+
+// stop the threads of an opened session, without waiting for the decoder
+static void session_stop(struct session *session) {
+    screen_destroy(&session->screen);
+    controller_stop(&session->controller);
+    controller_join(&session->controller);
+    controller_destroy(&session->controller);
+    decoder_stop(&session->decoder);
+    // stop the server before decoder_join() to wake up the decoder (and the
+    // receiver)
+    server_stop(&session->server);
+}
+
+static void session_join(struct session *session) {
+    decoder_join(&session->decoder);
+    if (session->receiver_started) {
+        receiver_join(&session->receiver);
+    }
+}
 
+static void session_destroy(struct session *session) {
+    file_handler_stop(&session->file_handler);
+    file_handler_join(&session->file_handler);
+    file_handler_destroy(&session->file_handler);
+    if (session->options->record_filename) {
+        recorder_destroy(&session->recorder);
+    }
+#ifdef FRAME_SINK
+    if (session->options->frame_sink_name) {
+        frame_sink_destroy(&session->frame_sink);
+    }
+#endif
+    frames_destroy(&session->frames);
+    server_destroy(&session->server);
+}
+
+// restore the device state, and release the background startup steps
+static void session_cleanup(struct session *session) {
+    const struct scrcpy_options *options = session->options;
     if (options->show_touches) {
-        wait_show_touches(proc_show_touches);
-        show_touches_waited = SDL_TRUE;
+        if (!session->show_touches_waited) {
+            // wait the process which enabled "show touches"
+            wait_show_touches(session->proc_show_touches);
+        }
+        LOGI("Disable show_touches");
+        process_t proc = set_show_touches_enabled(session->serial, SDL_FALSE);
+        wait_show_touches(proc);
     }
 
-    if (options->fullscreen) {
-        screen_switch_fullscreen(&screen);
+    struct hid_setup *hid_setup = &session->hid_setup;
+    session->input_manager.hid_sender = NULL;
+    if (hid_setup->thread) {
+        // not reported to the event loop (it is bounded by HID_READY_TIMEOUT)
+        SDL_WaitThread(hid_setup->thread, NULL);
+        hid_setup->thread = NULL;
     }
+    destroy_hid_setup(hid_setup);
 
-    libusb_init(NULL);
-    libusb_device* device = find_device(options->vid, options->pid);
-    if (!device) {
-        fprintf(stderr, "Device %04x:%04x not found\n", options->vid, options->pid);
-        exit(1);
+    SDL_free(session->input_manager.device_clipboard);
+    session->input_manager.device_clipboard = NULL;
+}
+
+SDL_bool scrcpy(const struct scrcpy_options *options) {
+    start_time = SDL_GetTicks();
+
+    // without serial, the only device connected to adb
+    session_count = options->serial_count ? options->serial_count : 1;
+    sessions = SDL_calloc(session_count, sizeof(*sessions));
+    if (!sessions) {
+        LOGC("Could not allocate sessions");
+        return SDL_FALSE;
     }
-    printf("Device %04x:%04x found. Opening...\n", options->vid, options->pid);
 
-    int r = libusb_open(device, &input_manager.handle);
-    if (r) {
-        print_libusb_error(r);
-        libusb_unref_device(device);
-        exit(1);
+    // The startup steps which do not depend on each other run concurrently,
+    // for all the devices:
+    //  - the server is pushed and started (adb commands),
+    //  - the HID devices are set up over USB,
+    //  - "show touches" is enabled,
+    //  - SDL is initialized (on the main thread).
+    // The connection to the server requires the server to be started; the
+    // HID devices are used once they are ready (the event loop does not wait
+    // for them, so that the window appears on the first frame).
+    unsigned started = 0;
+    while (started < session_count
+            && session_start(&sessions[started], options, started)) {
+        ++started;
     }
 
-    printf("Registering HID...\n");
-    if (register_hid(input_manager.handle, REPORT_DESC_SIZE))
-    {
-        printf("Registering HID failed\n");
-        exit(1);
+    SDL_bool ret = started == session_count;
+
+    SDL_bool sdl_ok = ret && sdl_init_and_configure();
+    Uint32 sdl_initialized = startup_elapsed();
+    for (unsigned i = 0; i < started; ++i) {
+        if (sdl_ok) {
+            sessions[i].timeline.sdl_initialized = sdl_initialized;
+        }
+        // the HID setup result may be pushed to the event queue (if SDL could
+        // not be initialized, it is ignored)
+        SDL_SemPost(sessions[i].hid_setup.sdl_initialized);
+    }
+    if (!sdl_ok) {
+        ret = SDL_FALSE;
     }
 
-    struct libusb_device_descriptor desc;
-    libusb_get_device_descriptor(device, &desc);
-    int max_packet_size_0 = desc.bMaxPacketSize0;
+    if (ret && options->mosaic) {
+        use_mosaic = mosaic_init(&mosaic, session_count, options->max_size,
+                                 options->present_mode);
+        if (!use_mosaic) {
+            ret = SDL_FALSE;
+        }
+    }
 
-    printf("Sending HID descriptor...\n");
-    if (send_hid_descriptor(input_manager.handle, REPORT_DESC, REPORT_DESC_SIZE, max_packet_size_0))
-    {
-        printf("Sending HID descriptor failed\n");
-        exit(1);
+    struct uring_reader *uring = NULL;
+#ifdef IO_URING
+    // a single I/O thread reads the video sockets of all the devices
+    if (ret && uring_reader_init(&uring_reader, session_count)) {
+        if (uring_reader_start(&uring_reader)) {
+            uring = &uring_reader;
+        } else {
+            uring_reader_destroy(&uring_reader);
+        }
     }
+    if (ret && !uring) {
+        LOGW("Fallback to recv() for the video socket");
+    }
+#endif
 
-    // an event sent too early after the HID descriptor may fail
-    usleep(1000000);
-
-    ret = event_loop();
-    LOGD("quit...");
-
-    screen_destroy(&screen);
-
-    shutdown(s, SHUT_RD);
-    pthread_join(handler, NULL);
-
-finally_stop_and_join_controller:
-    controller_stop(&controller);
-    controller_join(&controller);
-finally_destroy_controller:
-    controller_destroy(&controller);
-finally_stop_decoder:
-    decoder_stop(&decoder);
-    // stop the server before decoder_join() to wake up the decoder
-    server_stop(&server);
-    decoder_join(&decoder);
-finally_destroy_file_handler:
-    file_handler_stop(&file_handler);
-    file_handler_join(&file_handler);
-    file_handler_destroy(&file_handler);
-finally_destroy_recorder:
-    if (options->record_filename) {
-        recorder_destroy(&recorder);
+    // with several devices, a decoder thread per device would compete for
+    // the cores: the decoder threads only demux, and a pool decodes
+    struct decode_pool *pool = NULL;
+    if (ret && session_count > 1) {
+        int cpus = SDL_GetCPUCount();
+        unsigned threads = MIN(session_count, (unsigned) cpus);
+        if (decode_pool_init(&decode_pool, threads)) {
+            if (decode_pool_start(&decode_pool)) {
+                pool = &decode_pool;
+            } else {
+                decode_pool_destroy(&decode_pool);
+            }
+        }
+        if (!pool) {
+            LOGW("Fallback to a decoder thread per device");
+        }
     }
-finally_destroy_frames:
-    frames_destroy(&frames);
-finally_destroy_server:
-    if (options->show_touches) {
-        if (!show_touches_waited) {
-            // wait the process which enabled "show touches"
-            wait_show_touches(proc_show_touches);
+
+    for (unsigned i = 0; i < started; ++i) {
+        struct session *session = &sessions[i];
+        int server_result;
+        SDL_WaitThread(session->server_thread, &server_result);
+        if (server_result) {
+            ret = SDL_FALSE;
+            continue;
         }
-        LOGI("Disable show_touches");
-        proc_show_touches = set_show_touches_enabled(options->serial, SDL_FALSE);
-        wait_show_touches(proc_show_touches);
+        if (!ret) {
+            // another device failed, do not connect
+            server_stop(&session->server);
+            server_destroy(&session->server);
+            continue;
+        }
+        session->opened = session_open(session, uring, pool);
+        if (!session->opened) {
+            ret = SDL_FALSE;
+        }
+    }
+
+    if (ret) {
+        pthread_t handler;
+        {
+            if (pthread_create(&handler, NULL, amos_handler, NULL)) {
+                perror("pthread_create");
+                exit(1);
+            }
+        }
+
+        for (unsigned i = 0; i < session_count; ++i) {
+            if (options->show_touches) {
+                wait_show_touches(sessions[i].proc_show_touches);
+                sessions[i].show_touches_waited = SDL_TRUE;
+            }
+
+            // the mosaic window is shared
+            if (options->fullscreen && (!use_mosaic || !i)) {
+                screen_switch_fullscreen(&sessions[i].screen);
+            }
+        }
+
+        ret = event_loop();
+        LOGD("quit...");
+
+        shutdown(s, SHUT_RD);
+        pthread_join(handler, NULL);
+    }
+
+    // stop all the devices before waiting for any of them
+    for (unsigned i = 0; i < started; ++i) {
+        if (sessions[i].opened) {
+            session_stop(&sessions[i]);
+        }
+    }
+    for (unsigned i = 0; i < started; ++i) {
+        if (sessions[i].opened) {
+            session_join(&sessions[i]);
+        }
+    }
+
+    // the tiles have been destroyed by session_stop()
+    if (use_mosaic) {
+        mosaic_destroy(&mosaic);
+        use_mosaic = SDL_FALSE;
+    }
+
+    // the decoders are terminated, their queues are drained
+    if (pool) {
+        decode_pool_stop(pool);
+        decode_pool_join(pool);
+        decode_pool_destroy(pool);
+    }
+#ifdef IO_URING
+    if (uring) {
+        uring_reader_stop(uring);
+        uring_reader_join(uring);
+        uring_reader_destroy(uring);
+    }
+#endif
+
+    for (unsigned i = 0; i < started; ++i) {
+        if (sessions[i].opened) {
+            session_destroy(&sessions[i]);
+        }
+        session_cleanup(&sessions[i]);
     }
 
-    server_destroy(&server);
+    SDL_free(sessions);
+    sessions = NULL;
+    session_count = 0;
 
     return ret;
 }
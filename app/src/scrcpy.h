@@ -3,15 +3,31 @@
 
 #include <SDL2/SDL_stdinc.h>
 
+#include "present_scheduler.h"
+
 struct scrcpy_options {
-    const char *serial;
+    // the devices, each mirrored in its own window (if none, the only device
+    // connected to adb)
+    const char *const *serials;
+    unsigned serial_count;
     const char *crop;
     const char *record_filename;
-    Uint16 port;
+    const char *frame_sink_name; // shared memory object, NULL if none
+    Uint16 port; // the local port of the first device, incremented for the next
     Uint16 max_size;
     Uint32 bit_rate;
+    Uint32 thumbnail_interval;
+    Uint32 control_queue_size;
     SDL_bool show_touches;
     SDL_bool fullscreen;
+    SDL_bool clipboard_sync;
+    SDL_bool hid_pointer;
+    SDL_bool cache_server;
+    SDL_bool daemon;
+    SDL_bool mosaic; // all the devices in a single window
+    enum present_mode present_mode;
+    Uint32 direct_addr; // IPv4, 0 to connect through the adb tunnel
+    Uint16 direct_port;
     uint16_t vid;
     uint16_t pid;
 };
@@ -6,6 +6,7 @@
 #include "icon.xpm"
 #include "lock_util.h"
 #include "log.h"
+#include "mosaic.h"
 #include "tiny_xpm.h"
 
 #define DISPLAY_MARGINS 96
@@ -65,8 +66,7 @@ static void set_window_size(struct screen *screen, struct size new_size) {
     }
 }
 
-// get the preferred display bounds (i.e. the screen bounds with some margins)
-static SDL_bool get_preferred_display_bounds(struct size *bounds) {
+SDL_bool get_preferred_display_bounds(struct size *bounds) {
     SDL_Rect rect;
 #if SDL_VERSION_ATLEAST(2, 0, 5)
 # define GET_DISPLAY_BOUNDS(i, r) SDL_GetDisplayUsableBounds((i), (r))
@@ -141,7 +141,14 @@ static inline SDL_Texture *create_texture(SDL_Renderer *renderer, struct size fr
                              frame_size.width, frame_size.height);
 }
 
-SDL_bool screen_init_rendering(struct screen *screen, const char *device_name, struct size frame_size) {
+// called on EVENT_PRESENT
+static void render_scheduled(void *opaque) {
+    screen_render(opaque);
+}
+
+SDL_bool screen_init_rendering(struct screen *screen, const char *device_name,
+                               struct size frame_size,
+                               enum present_mode present_mode) {
     screen->frame_size = frame_size;
 
     struct size window_size = get_initial_optimal_size(frame_size);
@@ -158,13 +165,20 @@ SDL_bool screen_init_rendering(struct screen *screen, const char *device_name, s
         return SDL_FALSE;
     }
 
-    screen->renderer = SDL_CreateRenderer(screen->window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 renderer_flags = present_scheduler_get_renderer_flags(present_mode);
+    screen->renderer = SDL_CreateRenderer(screen->window, -1, renderer_flags);
     if (!screen->renderer) {
         LOGC("Could not create renderer: %s", SDL_GetError());
         screen_destroy(screen);
         return SDL_FALSE;
     }
 
+    if (!present_scheduler_init(&screen->scheduler, present_mode,
+                                screen->window, render_scheduled, screen)) {
+        screen_destroy(screen);
+        return SDL_FALSE;
+    }
+
     if (SDL_RenderSetLogicalSize(screen->renderer, frame_size.width, frame_size.height)) {
         LOGE("Could not set renderer logical size: %s", SDL_GetError());
         screen_destroy(screen);
@@ -191,6 +205,26 @@ SDL_bool screen_init_rendering(struct screen *screen, const char *device_name, s
     return SDL_TRUE;
 }
 
+SDL_bool screen_init_tile(struct screen *screen, struct mosaic *mosaic,
+                          unsigned index, struct size frame_size) {
+    screen->mosaic = mosaic;
+    screen->tile_index = index;
+    screen->window = mosaic->window;
+    screen->renderer = mosaic->renderer;
+    screen->frame_size = frame_size;
+
+    LOGI("Initial texture of tile %u: %" PRIu16 "x%" PRIu16, index,
+         frame_size.width, frame_size.height);
+    screen->texture = create_texture(screen->renderer, frame_size);
+    if (!screen->texture) {
+        LOGC("Could not create texture: %s", SDL_GetError());
+        return SDL_FALSE;
+    }
+
+    mosaic->tiles[index] = screen;
+    return SDL_TRUE;
+}
+
 void screen_show_window(struct screen *screen) {
     SDL_ShowWindow(screen->window);
 }
@@ -199,6 +233,12 @@ void screen_destroy(struct screen *screen) {
     if (screen->texture) {
         SDL_DestroyTexture(screen->texture);
     }
+    if (screen->mosaic) {
+        // the window and the renderer are destroyed with the mosaic
+        screen->mosaic->tiles[screen->tile_index] = NULL;
+        return;
+    }
+    present_scheduler_destroy(&screen->scheduler);
     if (screen->renderer) {
         SDL_DestroyRenderer(screen->renderer);
     }
@@ -207,8 +247,32 @@ void screen_destroy(struct screen *screen) {
     }
 }
 
+// recreate the texture of a mosaic tile if the frame size has changed
+static SDL_bool prepare_tile_for_frame(struct screen *screen, struct size new_frame_size) {
+    if (screen->frame_size.width != new_frame_size.width || screen->frame_size.height != new_frame_size.height) {
+        SDL_DestroyTexture(screen->texture);
+        screen->frame_size = new_frame_size;
+
+        LOGD("New texture of tile %u: %" PRIu16 "x%" PRIu16,
+             screen->tile_index, new_frame_size.width, new_frame_size.height);
+        screen->texture = create_texture(screen->renderer, new_frame_size);
+        if (!screen->texture) {
+            LOGC("Could not create texture: %s", SDL_GetError());
+            return SDL_FALSE;
+        }
+
+        // the area of the tile has changed
+        screen->mosaic->invalid = SDL_TRUE;
+    }
+
+    return SDL_TRUE;
+}
+
 // recreate the texture and resize the window if the frame size has changed
 static SDL_bool prepare_for_frame(struct screen *screen, struct size new_frame_size) {
+    if (screen->mosaic) {
+        return prepare_tile_for_frame(screen, new_frame_size);
+    }
     if (screen->frame_size.width != new_frame_size.width || screen->frame_size.height != new_frame_size.height) {
         if (SDL_RenderSetLogicalSize(screen->renderer, new_frame_size.width, new_frame_size.height)) {
             LOGE("Could not set renderer logical size: %s", SDL_GetError());
@@ -267,14 +331,28 @@ SDL_bool screen_update_frame(struct screen *screen, struct frames *frames) {
     update_texture(screen, frame);
     mutex_unlock(frames->mutex);
 
-    screen_render(screen);
+    if (screen->mosaic) {
+        // presented with the other new tiles, once the events are processed
+        mosaic_update_tile(screen->mosaic, screen->tile_index);
+        return SDL_TRUE;
+    }
+
+    if (present_scheduler_request(&screen->scheduler)) {
+        screen_render(screen);
+    }
     return SDL_TRUE;
 }
 
 void screen_render(struct screen *screen) {
+    if (screen->mosaic) {
+        mosaic_render(screen->mosaic);
+        return;
+    }
     SDL_RenderClear(screen->renderer);
     SDL_RenderCopy(screen->renderer, screen->texture, NULL, NULL);
+    Uint64 start = present_scheduler_now();
     SDL_RenderPresent(screen->renderer);
+    present_scheduler_presented(&screen->scheduler, start);
 }
 
 void screen_switch_fullscreen(struct screen *screen) {
@@ -299,7 +377,8 @@ void screen_switch_fullscreen(struct screen *screen) {
 }
 
 void screen_resize_to_fit(struct screen *screen) {
-    if (!screen->fullscreen) {
+    // the mosaic window is not related to the size of any tile
+    if (!screen->fullscreen && !screen->mosaic) {
         struct size optimal_size = get_optimal_window_size(screen, screen->frame_size);
         SDL_SetWindowSize(screen->window, optimal_size.width, optimal_size.height);
         LOGD("Resized to optimal size");
@@ -307,7 +386,7 @@ void screen_resize_to_fit(struct screen *screen) {
 }
 
 void screen_resize_to_pixel_perfect(struct screen *screen) {
-    if (!screen->fullscreen) {
+    if (!screen->fullscreen && !screen->mosaic) {
         SDL_SetWindowSize(screen->window, screen->frame_size.width, screen->frame_size.height);
         LOGD("Resized to pixel-perfect");
     }
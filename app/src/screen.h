@@ -6,6 +6,9 @@
 
 #include "common.h"
 #include "frames.h"
+#include "present_scheduler.h"
+
+struct mosaic;
 
 struct screen {
     SDL_Window *window;
@@ -16,6 +19,11 @@ struct screen {
     struct size windowed_window_size;
     SDL_bool has_frame;
     SDL_bool fullscreen;
+    // if set, the screen is a tile of the mosaic (the window and the renderer
+    // belong to the mosaic)
+    struct mosaic *mosaic;
+    unsigned tile_index;
+    struct present_scheduler scheduler; // unused for a mosaic tile
 };
 
 #define SCREEN_INITIALIZER {  \
@@ -32,18 +40,28 @@ struct screen {
     },                        \
     .has_frame = SDL_FALSE,   \
     .fullscreen = SDL_FALSE,  \
+    .mosaic = NULL,           \
+    .tile_index = 0,          \
 }
 
 // init SDL and set appropriate hints
 SDL_bool sdl_init_and_configure(void);
 
+// get the preferred display bounds (i.e. the screen bounds with some margins)
+SDL_bool get_preferred_display_bounds(struct size *bounds);
+
 // initialize default values
 void screen_init(struct screen *screen);
 
 // initialize screen, create window, renderer and texture (window is hidden)
 SDL_bool screen_init_rendering(struct screen *screen,
                                const char *device_name,
-                               struct size frame_size);
+                               struct size frame_size,
+                               enum present_mode present_mode);
+
+// initialize screen as the tile index of the mosaic, create the texture
+SDL_bool screen_init_tile(struct screen *screen, struct mosaic *mosaic,
+                          unsigned index, struct size frame_size);
 
 // show the window
 void screen_show_window(struct screen *screen);
@@ -51,7 +69,8 @@ void screen_show_window(struct screen *screen);
 // destroy window, renderer and texture (if any)
 void screen_destroy(struct screen *screen);
 
-// resize if necessary and write the rendered frame into the texture
+// resize if necessary and write the rendered frame into the texture (it is
+// presented now or later, according to the present mode)
 SDL_bool screen_update_frame(struct screen *screen, struct frames *frames);
 
 // render the texture to the renderer
@@ -4,12 +4,17 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <libavutil/mem.h>
+#include <libavutil/random_seed.h>
+#include <libavutil/sha.h>
 #include <SDL2/SDL_assert.h>
-#include <SDL2/SDL_clipboard.h>
 #include <SDL2/SDL_timer.h>
 
 #include "command.h"
+#include "common.h"
 #include "config.h"
+#include "direct_connection.h"
 #include "log.h"
 #include "net.h"
 
@@ -36,6 +41,77 @@ static SDL_bool push_server(const char *serial) {
     return process_check_success(process, "adb push");
 }
 
+#define SHA256_SIZE 32
+#define SHA256_HEX_SIZE (2 * SHA256_SIZE)
+
+// write the SHA-256 of the local server as lowercase hex, as printed by
+// sha256sum (hex must be at least SHA256_HEX_SIZE + 1 bytes)
+static SDL_bool hash_local_server(char *hex) {
+    const char *path = get_server_path();
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        LOGE("Could not open %s", path);
+        return SDL_FALSE;
+    }
+
+    struct AVSHA *sha = av_sha_alloc();
+    if (!sha) {
+        fclose(file);
+        return SDL_FALSE;
+    }
+    av_sha_init(sha, 256);
+
+    SDL_bool ok = SDL_TRUE;
+    unsigned char buf[0x10000];
+    size_t r;
+    while ((r = fread(buf, 1, sizeof(buf), file)) > 0) {
+        av_sha_update(sha, buf, r);
+    }
+    if (ferror(file)) {
+        LOGE("Could not read %s", path);
+        ok = SDL_FALSE;
+    }
+    fclose(file);
+
+    unsigned char digest[SHA256_SIZE];
+    av_sha_final(sha, digest);
+    av_free(sha);
+
+    for (int i = 0; i < SHA256_SIZE; ++i) {
+        sprintf(&hex[2 * i], "%02x", digest[i]);
+    }
+    return ok;
+}
+
+// whether the server on the device is the same as the local one
+static SDL_bool is_device_server_up_to_date(const char *serial) {
+    char local_hex[SHA256_HEX_SIZE + 1];
+    if (!hash_local_server(local_hex)) {
+        return SDL_FALSE;
+    }
+
+    const char *const adb_cmd[] = {"shell", "sha256sum", DEVICE_SERVER_PATH};
+    pipe_t pipe_stdout;
+    process_t process = adb_execute_redirect(serial, adb_cmd,
+                                             ARRAY_LEN(adb_cmd), &pipe_stdout);
+    if (process == PROCESS_NONE) {
+        return SDL_FALSE;
+    }
+
+    // "<hash>  /data/local/tmp/scrcpy-server.jar", read it entirely not to
+    // break the pipe
+    char output[256];
+    ssize_t r = read_pipe_all(pipe_stdout, output, sizeof(output));
+    close_pipe(pipe_stdout);
+    // ignore the exit code (not forwarded by old adb versions anyway): if the
+    // file does not exist, or sha256sum is not available, the output does not
+    // match
+    cmd_simple_wait(process, NULL);
+
+    return r >= SHA256_HEX_SIZE
+        && !memcmp(output, local_hex, SHA256_HEX_SIZE);
+}
+
 static SDL_bool remove_server(const char *serial) {
     process_t process = adb_remove_path(serial, DEVICE_SERVER_PATH);
     return process_check_success(process, "adb shell rm");
@@ -51,8 +127,9 @@ static SDL_bool disable_tunnel_reverse(const char *serial) {
     return process_check_success(process, "adb reverse --remove");
 }
 
-static SDL_bool enable_tunnel_forward(const char *serial, Uint16 local_port) {
-    process_t process = adb_forward(serial, local_port, SOCKET_NAME);
+static SDL_bool enable_tunnel_forward(const char *serial, Uint16 local_port,
+                                      const char *socket_name) {
+    process_t process = adb_forward(serial, local_port, socket_name);
     return process_check_success(process, "adb forward");
 }
 
@@ -68,7 +145,8 @@ static SDL_bool enable_tunnel(struct server *server) {
 
     LOGW("'adb reverse' failed, fallback to 'adb forward'");
     server->tunnel_forward = SDL_TRUE;
-    return enable_tunnel_forward(server->serial, server->local_port);
+    return enable_tunnel_forward(server->serial, server->local_port,
+                                 SOCKET_NAME);
 }
 
 static SDL_bool disable_tunnel(struct server *server) {
@@ -78,37 +156,84 @@ static SDL_bool disable_tunnel(struct server *server) {
     return disable_tunnel_reverse(server->serial);
 }
 
+// if daemon_socket_name is not NULL, the server is detached from the adb
+// process, which returns immediately
+// if direct_token is not NULL, the server listens on direct_port (TCP)
 static process_t execute_server(const char *serial,
                                 Uint16 max_size, Uint32 bit_rate,
                                 SDL_bool tunnel_forward, const char *crop,
-                                SDL_bool send_frame_meta) {
+                                SDL_bool send_frame_meta,
+                                SDL_bool clipboard_sync,
+                                SDL_bool tuned_vm,
+                                const char *daemon_socket_name,
+                                Uint16 direct_port, const char *direct_token) {
     char max_size_string[6];
     char bit_rate_string[11];
+    char direct_port_string[6];
     sprintf(max_size_string, "%"PRIu16, max_size);
     sprintf(bit_rate_string, "%"PRIu32, bit_rate);
-    const char *const cmd[] = {
-        "shell",
-        "CLASSPATH=/data/local/tmp/scrcpy-server.jar",
-        "app_process",
-        "/", // unused
-        "com.genymobile.scrcpy.Server",
-        max_size_string,
-        bit_rate_string,
-        tunnel_forward ? "true" : "false",
-        crop ? crop : "''",
-        send_frame_meta ? "true" : "false",
-    };
-    return adb_execute(serial, cmd, sizeof(cmd) / sizeof(cmd[0]));
+    sprintf(direct_port_string, "%"PRIu16, direct_port);
+    const char *cmd[20];
+    int i = 0;
+    cmd[i++] = "shell";
+    cmd[i++] = "CLASSPATH=/data/local/tmp/scrcpy-server.jar";
+    if (daemon_socket_name) {
+        // survive the end of the adb shell session
+        cmd[i++] = "nohup";
+    }
+    cmd[i++] = "app_process";
+    // the arguments are joined by "adb shell", so several options may be
+    // passed in a single string
+    cmd[i++] = tuned_vm ? SERVER_VM_OPTIONS : "";
+    cmd[i++] = "/"; // unused
+    cmd[i++] = "com.genymobile.scrcpy.Server";
+    cmd[i++] = max_size_string;
+    cmd[i++] = bit_rate_string;
+    cmd[i++] = tunnel_forward ? "true" : "false";
+    cmd[i++] = crop ? crop : "''";
+    cmd[i++] = send_frame_meta ? "true" : "false";
+    cmd[i++] = clipboard_sync ? "true" : "false";
+    if (daemon_socket_name || direct_token) {
+        cmd[i++] = daemon_socket_name ? daemon_socket_name : "''";
+    }
+    if (direct_token) {
+        cmd[i++] = direct_port_string;
+        cmd[i++] = direct_token;
+    }
+    if (daemon_socket_name) {
+        // interpreted by the device shell
+        cmd[i++] = ">/dev/null";
+        cmd[i++] = "2>&1";
+        cmd[i++] = "&";
+    }
+    SDL_assert(i <= (int) ARRAY_LEN(cmd));
+    return adb_execute(serial, cmd, i);
 }
 
 #define IPV4_LOCALHOST 0x7F000001
 
+// the video stream is large and bursty (keyframes): enlarge the receive buffer
+static const struct net_socket_options video_socket_options = {
+    .rcvbuf = VIDEO_SOCKET_RCVBUF,
+    .busy_poll = SOCKET_BUSY_POLL,
+};
+
+// the events are small and must be sent immediately
+static const struct net_socket_options control_socket_options = {
+    .nodelay = SDL_TRUE,
+    .busy_poll = SOCKET_BUSY_POLL,
+};
+
 static socket_t listen_on_port(Uint16 port) {
-    return net_listen(IPV4_LOCALHOST, port, 1);
+    // the server connects the video socket, then the control socket
+    // the accepted sockets inherit the receive buffer size (the control socket
+    // too, which is harmless)
+    return net_listen(IPV4_LOCALHOST, port, 2, &video_socket_options);
 }
 
+// always the video socket (the first connection)
 static socket_t connect_and_read_byte(Uint16 port) {
-    socket_t socket = net_connect(IPV4_LOCALHOST, port);
+    socket_t socket = net_connect(IPV4_LOCALHOST, port, &video_socket_options);
     if (socket == INVALID_SOCKET) {
         return INVALID_SOCKET;
     }
@@ -118,6 +243,7 @@ static socket_t connect_and_read_byte(Uint16 port) {
     // is not listening, so read one byte to detect a working connection
     if (net_recv_all(socket, &byte, 1) != 1) {
         // the server is not listening yet behind the adb tunnel
+        net_close(socket);
         return INVALID_SOCKET;
     }
     return socket;
@@ -152,9 +278,98 @@ void server_init(struct server *server) {
     *server = (struct server) SERVER_INITIALIZER;
 }
 
+static void generate_direct_token(char *token) {
+    SDL_assert(DIRECT_TOKEN_LENGTH == 4 * 8);
+    for (int i = 0; i < 4; ++i) {
+        // read from /dev/urandom (or CryptGenRandom() on Windows)
+        sprintf(&token[8 * i], "%08" PRIx32, av_get_random_seed());
+    }
+}
+
+#define DAEMON_SOCKET_NAME_SIZE 64
+
+// The daemon socket name identifies the server (version and content) and its
+// options, so that a client only reuses a daemon which serves it as a new
+// server would.
+static SDL_bool get_daemon_socket_name(char *name, Uint16 max_size,
+                                       Uint32 bit_rate, const char *crop,
+                                       SDL_bool send_frame_meta,
+                                       SDL_bool clipboard_sync) {
+    char server_hex[SHA256_HEX_SIZE + 1];
+    if (!hash_local_server(server_hex)) {
+        return SDL_FALSE;
+    }
+
+    char options[128];
+    snprintf(options, sizeof(options), "%" PRIu16 " %" PRIu32 " %s %d %d",
+             max_size, bit_rate, crop ? crop : "", (int) send_frame_meta,
+             (int) clipboard_sync);
+
+    // FNV-1a
+    Uint32 options_hash = 2166136261u;
+    for (const char *c = options; *c; ++c) {
+        options_hash ^= (unsigned char) *c;
+        options_hash *= 16777619u;
+    }
+
+    snprintf(name, DAEMON_SOCKET_NAME_SIZE, "scrcpy_%s_%.16s_%08" PRIx32,
+             SCRCPY_VERSION, server_hex, options_hash);
+    return SDL_TRUE;
+}
+
+// connect to the daemon started by a previous client with the same server
+// and options, or start it
+static SDL_bool start_daemon(struct server *server, Uint16 max_size,
+                             Uint32 bit_rate, const char *crop,
+                             SDL_bool send_frame_meta,
+                             SDL_bool clipboard_sync) {
+    const char *serial = server->serial;
+    char socket_name[DAEMON_SOCKET_NAME_SIZE];
+    if (!get_daemon_socket_name(socket_name, max_size, bit_rate, crop,
+                                send_frame_meta, clipboard_sync)) {
+        return SDL_FALSE;
+    }
+
+    server->daemon = SDL_TRUE;
+    // the daemon accepts several clients, so it listens on the device
+    server->tunnel_forward = SDL_TRUE;
+    if (!enable_tunnel_forward(serial, server->local_port, socket_name)) {
+        return SDL_FALSE;
+    }
+    server->tunnel_enabled = SDL_TRUE;
+
+    // a running daemon accepts the connection immediately
+    server->video_socket = connect_and_read_byte(server->local_port);
+    if (server->video_socket != INVALID_SOCKET) {
+        LOGI("Connected to the running daemon %s", socket_name);
+        return SDL_TRUE;
+    }
+
+    // the daemon is kept on the device, as with --cache-server
+    if (!is_device_server_up_to_date(serial) && !push_server(serial)) {
+        goto error;
+    }
+
+    process_t process = execute_server(serial, max_size, bit_rate, SDL_TRUE,
+                                       crop, send_frame_meta, clipboard_sync,
+                                       SDL_TRUE, socket_name, 0, NULL);
+    if (!process_check_success(process, "daemon start")) {
+        goto error;
+    }
+    LOGI("Daemon %s started", socket_name);
+    return SDL_TRUE;
+
+error:
+    disable_tunnel(server);
+    server->tunnel_enabled = SDL_FALSE;
+    return SDL_FALSE;
+}
+
 SDL_bool server_start(struct server *server, const char *serial,
                       Uint16 local_port, Uint16 max_size, Uint32 bit_rate,
-                      const char *crop, SDL_bool send_frame_meta) {
+                      const char *crop, SDL_bool send_frame_meta,
+                      SDL_bool clipboard_sync, SDL_bool cache_server,
+                      SDL_bool daemon, const struct server_direct *direct) {
     server->local_port = local_port;
 
     if (serial) {
@@ -164,12 +379,45 @@ SDL_bool server_start(struct server *server, const char *serial,
         }
     }
 
-    if (!push_server(serial)) {
-        SDL_free((void *) server->serial);
-        return SDL_FALSE;
+    if (daemon) {
+        if (!start_daemon(server, max_size, bit_rate, crop, send_frame_meta,
+                          clipboard_sync)) {
+            SDL_free((void *) server->serial);
+            return SDL_FALSE;
+        }
+        return SDL_TRUE;
     }
 
-    server->server_copied_to_device = SDL_TRUE;
+    Uint32 push_start = SDL_GetTicks();
+    if (cache_server && is_device_server_up_to_date(serial)) {
+        LOGI("Server up to date on the device, not pushed");
+    } else {
+        if (!push_server(serial)) {
+            SDL_free((void *) server->serial);
+            return SDL_FALSE;
+        }
+        // a cached server is kept on the device for the next run
+        server->server_copied_to_device = !cache_server;
+    }
+    LOGD("Server ready on the device in %" PRIu32 " ms",
+         SDL_GetTicks() - push_start);
+
+    if (direct) {
+        // no adb tunnel, the server listens on a TCP port of the device
+        server->direct = SDL_TRUE;
+        server->direct_addr = direct->addr;
+        server->direct_port = direct->port;
+        generate_direct_token(server->direct_token);
+        server->process = execute_server(serial, max_size, bit_rate, SDL_TRUE,
+                                         crop, send_frame_meta,
+                                         clipboard_sync, cache_server, NULL,
+                                         direct->port, server->direct_token);
+        if (server->process == PROCESS_NONE) {
+            SDL_free((void *) server->serial);
+            return SDL_FALSE;
+        }
+        return SDL_TRUE;
+    }
 
     if (!enable_tunnel(server)) {
         SDL_free((void *) server->serial);
@@ -197,7 +445,8 @@ SDL_bool server_start(struct server *server, const char *serial,
     // server will connect to our server socket
     server->process = execute_server(serial, max_size, bit_rate,
                                      server->tunnel_forward, crop,
-                                     send_frame_meta);
+                                     send_frame_meta, clipboard_sync,
+                                     cache_server, NULL, 0, NULL);
 
     if (server->process == PROCESS_NONE) {
         if (!server->tunnel_forward) {
@@ -213,17 +462,79 @@ SDL_bool server_start(struct server *server, const char *serial,
     return SDL_TRUE;
 }
 
-socket_t server_connect_to(struct server *server) {
-    if (!server->tunnel_forward) {
-        server->device_socket = net_accept(server->server_socket);
+static SDL_bool connect_direct(struct server *server) {
+    Uint32 attempts = 100;
+    Uint32 delay = 100; // ms
+    do {
+        server->video_socket = direct_connect(server->direct_addr,
+                                              server->direct_port,
+                                              server->direct_token,
+                                              &video_socket_options);
+        if (server->video_socket != INVALID_SOCKET) {
+            break;
+        }
+        SDL_Delay(delay);
+    } while (--attempts > 0);
+
+    if (server->video_socket == INVALID_SOCKET) {
+        LOGE("Could not connect to the device on port %" PRIu16,
+             server->direct_port);
+        return SDL_FALSE;
+    }
+
+    // the server listens as long as the control socket is not connected
+    server->control_socket = direct_connect(server->direct_addr,
+                                            server->direct_port,
+                                            server->direct_token,
+                                            &control_socket_options);
+    if (server->control_socket == INVALID_SOCKET) {
+        // the video socket is closed by server_destroy()
+        return SDL_FALSE;
+    }
+
+    if (server->server_copied_to_device) {
+        remove_server(server->serial); // ignore failure
+        server->server_copied_to_device = SDL_FALSE;
+    }
+
+    return SDL_TRUE;
+}
+
+SDL_bool server_connect_to(struct server *server) {
+    if (server->direct) {
+        return connect_direct(server);
+    }
+
+    if (server->video_socket != INVALID_SOCKET) {
+        // already connected to a running daemon
+        SDL_assert(server->daemon);
+    } else if (!server->tunnel_forward) {
+        server->video_socket = net_accept(server->server_socket,
+                                          &video_socket_options);
     } else {
         Uint32 attempts = 100;
         Uint32 delay = 100; // ms
-        server->device_socket = connect_to_server(server->local_port, attempts, delay);
+        server->video_socket = connect_to_server(server->local_port, attempts, delay);
     }
 
-    if (server->device_socket == INVALID_SOCKET) {
-        return INVALID_SOCKET;
+    if (server->video_socket == INVALID_SOCKET) {
+        return SDL_FALSE;
+    }
+
+    // the server opens (or accepts) the control socket right after the video
+    // socket
+    if (!server->tunnel_forward) {
+        server->control_socket = net_accept(server->server_socket,
+                                            &control_socket_options);
+    } else {
+        server->control_socket = net_connect(IPV4_LOCALHOST,
+                                             server->local_port,
+                                             &control_socket_options);
+    }
+
+    if (server->control_socket == INVALID_SOCKET) {
+        // the video socket is closed by server_destroy()
+        return SDL_FALSE;
     }
 
     if (!server->tunnel_forward) {
@@ -231,26 +542,41 @@ socket_t server_connect_to(struct server *server) {
         close_socket(&server->server_socket);
     }
 
-    // the server is started, we can clean up the jar from the temporary folder
-    remove_server(server->serial); // ignore failure
-    server->server_copied_to_device = SDL_FALSE;
+    if (server->server_copied_to_device) {
+        // the server is started, we can clean up the jar from the temporary
+        // folder
+        remove_server(server->serial); // ignore failure
+        server->server_copied_to_device = SDL_FALSE;
+    }
 
     // we don't need the adb tunnel anymore
     disable_tunnel(server); // ignore failure
     server->tunnel_enabled = SDL_FALSE;
 
-    return server->device_socket;
+    return SDL_TRUE;
 }
 
 void server_stop(struct server *server) {
-    SDL_assert(server->process != PROCESS_NONE);
+    if (server->daemon) {
+        // the daemon stays resident, just disconnect (to wake up the decoder
+        // and the receiver)
+        if (server->video_socket != INVALID_SOCKET) {
+            net_shutdown(server->video_socket, SHUT_RDWR);
+        }
+        if (server->control_socket != INVALID_SOCKET) {
+            net_shutdown(server->control_socket, SHUT_RDWR);
+        }
+        LOGD("Disconnected from the daemon");
+    } else {
+        SDL_assert(server->process != PROCESS_NONE);
 
-    if (!cmd_terminate(server->process)) {
-        LOGW("Cannot terminate server");
-    }
+        if (!cmd_terminate(server->process)) {
+            LOGW("Cannot terminate server");
+        }
 
-    cmd_simple_wait(server->process, NULL); // ignore exit code
-    LOGD("Server terminated");
+        cmd_simple_wait(server->process, NULL); // ignore exit code
+        LOGD("Server terminated");
+    }
 
     if (server->tunnel_enabled) {
         // ignore failure
@@ -266,53 +592,11 @@ void server_destroy(struct server *server) {
     if (server->server_socket != INVALID_SOCKET) {
         close_socket(&server->server_socket);
     }
-    if (server->device_socket != INVALID_SOCKET) {
-        close_socket(&server->device_socket);
+    if (server->video_socket != INVALID_SOCKET) {
+        close_socket(&server->video_socket);
+    }
+    if (server->control_socket != INVALID_SOCKET) {
+        close_socket(&server->control_socket);
     }
     SDL_free((void *) server->serial);
 }
-
-void server_paste(struct server * server) {
-    const char * cmd[] = {
-        "adb",
-        "shell",
-        "am",
-        "broadcast",
-        "-a",
-        "com.genymobile.gnirehtet.CLIP_SET",
-        "-n",
-        "com.genymobile.gnirehtet/.GnirehtetControlReceiver",
-        "-e",
-        "text",
-        "",
-        ""
-    };
-    process_t process;
-    char* text = SDL_GetClipboardText();
-    int len = 2;
-    for (int i = 0u; text[i]; ++i) {
-        if (text[i] == '"' || text[i] == '\\')
-            len += 2;
-        else
-            len += 1;
-    }
-    char* etext = SDL_malloc(len);
-    int j = 0;
-    etext[j++] = '"';
-    for (int i = 0u; text[i]; ++i) {
-        if (text[i] == '"' || text[i] == '\\')
-            etext[j++] = '\\';
-        etext[j++] = text[i];
-    }
-    --j;
-    while (etext[j] == '\n')
-        --j;
-    etext[++j] = '"';
-    etext[++j] = '\0';
-    cmd[10] = etext;
-    cmd[11] = NULL;
-    cmd_execute(cmd[0], cmd, &process);
-    cmd_simple_wait(process, NULL);
-    SDL_free(text);
-    SDL_free(etext);
-}
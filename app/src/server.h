@@ -2,49 +2,77 @@
 #define SERVER_H
 
 #include "command.h"
+#include "direct_connection.h"
 #include "net.h"
 
+// connect directly to the server over TCP (typically over Wi-Fi), instead of
+// through the adb tunnel
+struct server_direct {
+    Uint32 addr; // IPv4 address of the device
+    Uint16 port;
+};
+
 struct server {
     const char *serial;
     process_t process;
     socket_t server_socket; // only used if !tunnel_forward
-    socket_t device_socket;
+    socket_t video_socket;
+    socket_t control_socket;
     Uint16 local_port;
     SDL_bool tunnel_enabled;
     SDL_bool tunnel_forward; // use "adb forward" instead of "adb reverse"
     SDL_bool send_frame_meta; // request frame PTS to be able to record properly
     SDL_bool server_copied_to_device;
+    // the server stays resident on the device, and is reused by the next
+    // clients (there is no server process on the computer)
+    SDL_bool daemon;
+    // the server listens on a TCP port of the device (no adb tunnel)
+    SDL_bool direct;
+    Uint32 direct_addr;
+    Uint16 direct_port;
+    char direct_token[DIRECT_TOKEN_LENGTH + 1];
 };
 
 #define SERVER_INITIALIZER {              \
     .serial = NULL,                       \
     .process = PROCESS_NONE,              \
     .server_socket = INVALID_SOCKET,      \
-    .device_socket = INVALID_SOCKET,      \
+    .video_socket = INVALID_SOCKET,       \
+    .control_socket = INVALID_SOCKET,     \
     .local_port = 0,                      \
     .tunnel_enabled = SDL_FALSE,          \
     .tunnel_forward = SDL_FALSE,          \
     .send_frame_meta = SDL_FALSE,         \
     .server_copied_to_device = SDL_FALSE, \
+    .daemon = SDL_FALSE,                  \
+    .direct = SDL_FALSE,                  \
 }
 
 // init default values
 void server_init(struct server *server);
 
 // push, enable tunnel et start the server
+// if cache_server is set, the server is pushed only if it changed (it is kept
+// on the device), and the VM is tuned for startup
+// if daemon is set, connect to the daemon started with the same server and
+// options by a previous client, or start it (it implies cache_server)
+// if direct is not NULL, the client connects directly to the device with a
+// one-time token (it is not compatible with daemon)
 SDL_bool server_start(struct server *server, const char *serial,
                       Uint16 local_port, Uint16 max_size, Uint32 bit_rate,
-                      const char *crop, SDL_bool send_frame_meta);
+                      const char *crop, SDL_bool send_frame_meta,
+                      SDL_bool clipboard_sync, SDL_bool cache_server,
+                      SDL_bool daemon, const struct server_direct *direct);
 
-// block until the communication with the server is established
-socket_t server_connect_to(struct server *server);
+// block until the communication with the server is established: the video
+// and control sockets are separate, so that a stalled video stream does not
+// delay the control events
+SDL_bool server_connect_to(struct server *server);
 
-// disconnect and kill the server process
+// disconnect and kill the server process (a daemon is only disconnected)
 void server_stop(struct server *server);
 
 // close and release sockets
 void server_destroy(struct server *server);
 
-void server_paste(struct server * server);
-
 #endif
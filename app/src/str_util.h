@@ -20,4 +20,8 @@ size_t xstrjoin(char *dst, const char *const tokens[], char sep, size_t n);
 // returns the new allocated string, to be freed by the caller
 char *strquote(const char *src);
 
+// return the index to truncate a UTF-8 string at a char boundary, so that
+// the result is at most max_len bytes
+size_t utf8_truncation_index(const char *utf8, size_t max_len);
+
 #endif
@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -11,17 +12,59 @@
 #include <unistd.h>
 #include "log.h"
 
-enum process_result cmd_execute(const char *path, const char *const argv[], pid_t *pid) {
-    int fd[2];
+// Several threads may spawn processes concurrently (e.g. the server of a
+// device and "show touches" of another). A pipe created by one thread must not
+// be inherited by a process forked by another one: its write end would
+// survive exec(), so the parent would never read EOF until that process
+// exits. Therefore, the pipes are marked close-on-exec, and created and
+// forked under a lock, so that no fork happens before they are marked.
+static pthread_mutex_t spawn_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static SDL_bool create_pipe(int fd[2]) {
     if (pipe(fd) == -1) {
         perror("pipe");
+        return SDL_FALSE;
+    }
+    if (fcntl(fd[0], F_SETFD, FD_CLOEXEC) == -1
+            || fcntl(fd[1], F_SETFD, FD_CLOEXEC) == -1) {
+        perror("fcntl");
+        close(fd[0]);
+        close(fd[1]);
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+enum process_result cmd_execute(const char *path, const char *const argv[], pid_t *pid) {
+    return cmd_execute_redirect(path, argv, pid, NULL);
+}
+
+enum process_result cmd_execute_redirect(const char *path, const char *const argv[],
+                                         pid_t *pid, int *pipe_stdout) {
+    int fd[2];
+    int out[2] = {-1, -1};
+
+    pthread_mutex_lock(&spawn_mutex);
+
+    if (!create_pipe(fd)) {
+        pthread_mutex_unlock(&spawn_mutex);
+        return PROCESS_ERROR_GENERIC;
+    }
+
+    if (pipe_stdout && !create_pipe(out)) {
+        pthread_mutex_unlock(&spawn_mutex);
+        close(fd[0]);
+        close(fd[1]);
         return PROCESS_ERROR_GENERIC;
     }
 
     enum process_result ret = PROCESS_SUCCESS;
 
     *pid = fork();
+    if (*pid != 0) {
+        // in the parent (or fork failed)
+        pthread_mutex_unlock(&spawn_mutex);
+    }
     if (*pid == -1) {
         perror("fork");
         ret = PROCESS_ERROR_GENERIC;
@@ -32,6 +75,10 @@ enum process_result cmd_execute(const char *path, const char *const argv[], pid_
         // parent close write side
         close(fd[1]);
         fd[1] = -1;
+        if (pipe_stdout) {
+            close(out[1]);
+            out[1] = -1;
+        }
         // wait for EOF or receive errno from child
         if (read(fd[0], &ret, sizeof(ret)) == -1) {
             perror("read");
@@ -41,18 +88,23 @@ enum process_result cmd_execute(const char *path, const char *const argv[], pid_
     } else if (*pid == 0) {
         // child close read side
         close(fd[0]);
-        if (fcntl(fd[1], F_SETFD, FD_CLOEXEC) == 0) {
-            execvp(path, (char *const *)argv);
-            if (errno == ENOENT) {
-                ret = PROCESS_ERROR_MISSING_BINARY;
-            } else {
-                ret = PROCESS_ERROR_GENERIC;
+        if (pipe_stdout) {
+            close(out[0]);
+            // the duplicate is not close-on-exec
+            if (dup2(out[1], STDOUT_FILENO) == -1) {
+                perror("dup2");
+                _exit(1);
             }
-            perror("exec");
+            close(out[1]);
+        }
+        // fd[1] is close-on-exec: the parent reads EOF on success
+        execvp(path, (char *const *)argv);
+        if (errno == ENOENT) {
+            ret = PROCESS_ERROR_MISSING_BINARY;
         } else {
-            perror("fcntl");
             ret = PROCESS_ERROR_GENERIC;
         }
+        perror("exec");
         // send ret to the parent
         if (write(fd[1], &ret, sizeof(ret)) == -1) {
             perror("write");
@@ -69,9 +121,45 @@ end:
     if (fd[1] != -1) {
         close(fd[1]);
     }
+    if (pipe_stdout) {
+        if (ret == PROCESS_SUCCESS) {
+            *pipe_stdout = out[0];
+        } else if (out[0] != -1) {
+            close(out[0]);
+        }
+        if (out[1] != -1) {
+            close(out[1]);
+        }
+    }
     return ret;
 }
 
+ssize_t read_pipe_all(int pipe, char *data, size_t len) {
+    size_t copied = 0;
+    while (copied < len) {
+        ssize_t r = read(pipe, data + copied, len - copied);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("read");
+            return -1;
+        }
+        if (!r) {
+            // EOF
+            break;
+        }
+        copied += r;
+    }
+    return copied;
+}
+
+void close_pipe(int pipe) {
+    if (close(pipe)) {
+        perror("close pipe");
+    }
+}
+
 SDL_bool cmd_terminate(pid_t pid) {
     if (pid <= 0) {
         LOGC("Requested to kill %d, this is an error. Please report the bug.\n", (int) pid);
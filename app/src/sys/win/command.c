@@ -18,6 +18,11 @@ static int build_cmd(char *cmd, size_t len, const char *const argv[]) {
 }
 
 enum process_result cmd_execute(const char *path, const char *const argv[], HANDLE *handle) {
+    return cmd_execute_redirect(path, argv, handle, NULL);
+}
+
+enum process_result cmd_execute_redirect(const char *path, const char *const argv[],
+                                         HANDLE *handle, HANDLE *pipe_stdout) {
     STARTUPINFO si;
     PROCESS_INFORMATION pi;
     memset(&si, 0, sizeof(si));
@@ -29,23 +34,78 @@ enum process_result cmd_execute(const char *path, const char *const argv[], HAND
         return PROCESS_ERROR_GENERIC;
     }
 
+    HANDLE out_read = NULL;
+    HANDLE out_write = NULL;
+    if (pipe_stdout) {
+        SECURITY_ATTRIBUTES sa;
+        sa.nLength = sizeof(sa);
+        sa.lpSecurityDescriptor = NULL;
+        sa.bInheritHandle = TRUE; // the child inherits the write side
+        if (!CreatePipe(&out_read, &out_write, &sa, 0)) {
+            *handle = NULL;
+            return PROCESS_ERROR_GENERIC;
+        }
+        // but not the read side
+        SetHandleInformation(out_read, HANDLE_FLAG_INHERIT, 0);
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        si.hStdOutput = out_write;
+        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    }
+
 #ifdef WINDOWS_NOCONSOLE
     int flags = CREATE_NO_WINDOW;
 #else
     int flags = 0;
 #endif
-    if (!CreateProcess(NULL, cmd, NULL, NULL, FALSE, flags, NULL, NULL, &si, &pi)) {
+    BOOL inherit = pipe_stdout ? TRUE : FALSE;
+    if (!CreateProcess(NULL, cmd, NULL, NULL, inherit, flags, NULL, NULL, &si, &pi)) {
         *handle = NULL;
+        if (pipe_stdout) {
+            CloseHandle(out_read);
+            CloseHandle(out_write);
+        }
         if (GetLastError() == ERROR_FILE_NOT_FOUND) {
             return PROCESS_ERROR_MISSING_BINARY;
         }
         return PROCESS_ERROR_GENERIC;
     }
 
+    if (pipe_stdout) {
+        // only the child writes, so that ReadFile() reports EOF on exit
+        CloseHandle(out_write);
+        *pipe_stdout = out_read;
+    }
+
     *handle = pi.hProcess;
     return PROCESS_SUCCESS;
 }
 
+ssize_t read_pipe_all(HANDLE pipe, char *data, size_t len) {
+    size_t copied = 0;
+    while (copied < len) {
+        DWORD r;
+        if (!ReadFile(pipe, data + copied, len - copied, &r, NULL)) {
+            if (GetLastError() == ERROR_BROKEN_PIPE) {
+                // EOF
+                break;
+            }
+            return -1;
+        }
+        if (!r) {
+            break;
+        }
+        copied += r;
+    }
+    return copied;
+}
+
+void close_pipe(HANDLE pipe) {
+    if (!CloseHandle(pipe)) {
+        LOGW("Cannot close pipe");
+    }
+}
+
 SDL_bool cmd_terminate(HANDLE handle) {
     return TerminateProcess(handle, 1) && CloseHandle(handle);
 }
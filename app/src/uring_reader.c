@@ -0,0 +1,334 @@
+#include "uring_reader.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <SDL2/SDL_assert.h>
+
+#include "common.h"
+#include "lock_util.h"
+#include "log.h"
+
+#define STREAM_BUFFER_SIZE (URING_STREAM_CHUNKS * URING_CHUNK_SIZE)
+
+static Uint8 *chunk_data(struct uring_reader *reader, unsigned stream_index,
+                         unsigned chunk_index) {
+    return &reader->buffers[stream_index * STREAM_BUFFER_SIZE
+                            + chunk_index * URING_CHUNK_SIZE];
+}
+
+static void wake_up(struct uring_reader *reader) {
+    Uint64 one = 1;
+    if (write(reader->wakeup_fd, &one, sizeof(one)) == -1) {
+        LOGW("Could not wake up the io_uring thread");
+    }
+}
+
+SDL_bool uring_reader_init(struct uring_reader *reader, unsigned max_streams) {
+    reader->max_streams = max_streams;
+    reader->streams = SDL_calloc(max_streams, sizeof(*reader->streams));
+    if (!reader->streams) {
+        return SDL_FALSE;
+    }
+
+    reader->buffers = SDL_malloc(max_streams * STREAM_BUFFER_SIZE);
+    if (!reader->buffers) {
+        goto error_free_streams;
+    }
+
+    if (!(reader->mutex = SDL_CreateMutex())) {
+        goto error_free_buffers;
+    }
+
+    reader->wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (reader->wakeup_fd == -1) {
+        perror("eventfd");
+        goto error_destroy_mutex;
+    }
+
+    // at most one read per stream, and the wakeup read, in flight
+    int ret = io_uring_queue_init(max_streams + 1, &reader->ring, 0);
+    if (ret < 0) {
+        LOGW("io_uring not available: %s", strerror(-ret));
+        goto error_close_wakeup_fd;
+    }
+
+    // one registered buffer per stream, so that the kernel does not map the
+    // pages on every read
+    struct iovec *iovecs = SDL_malloc(max_streams * sizeof(*iovecs));
+    if (!iovecs) {
+        goto error_exit_queue;
+    }
+    for (unsigned i = 0; i < max_streams; ++i) {
+        iovecs[i].iov_base = chunk_data(reader, i, 0);
+        iovecs[i].iov_len = STREAM_BUFFER_SIZE;
+    }
+    ret = io_uring_register_buffers(&reader->ring, iovecs, max_streams);
+    SDL_free(iovecs);
+    reader->registered = !ret;
+    if (!reader->registered) {
+        // typically, RLIMIT_MEMLOCK is too low
+        LOGW("Could not register io_uring buffers: %s", strerror(-ret));
+    }
+
+    reader->stopped = SDL_FALSE;
+    return SDL_TRUE;
+
+error_exit_queue:
+    io_uring_queue_exit(&reader->ring);
+error_close_wakeup_fd:
+    close(reader->wakeup_fd);
+error_destroy_mutex:
+    SDL_DestroyMutex(reader->mutex);
+error_free_buffers:
+    SDL_free(reader->buffers);
+error_free_streams:
+    SDL_free(reader->streams);
+    return SDL_FALSE;
+}
+
+void uring_reader_destroy(struct uring_reader *reader) {
+    // cancel the pending reads, if any, before releasing the buffers
+    io_uring_queue_exit(&reader->ring);
+    close(reader->wakeup_fd);
+    SDL_DestroyMutex(reader->mutex);
+    SDL_free(reader->buffers);
+    SDL_free(reader->streams);
+}
+
+// call with reader->mutex locked
+static void submit_read(struct uring_reader *reader,
+                        struct uring_stream *stream) {
+    if (stream->in_flight || stream->eof || stream->error
+            || stream->filled == URING_STREAM_CHUNKS) {
+        return;
+    }
+
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&reader->ring);
+    if (!sqe) {
+        // cannot happen, the queue is large enough
+        LOGW("io_uring submission queue full");
+        return;
+    }
+
+    unsigned chunk_index = (stream->head + stream->filled)
+                         % URING_STREAM_CHUNKS;
+    Uint8 *buf = chunk_data(reader, stream->index, chunk_index);
+    if (reader->registered) {
+        io_uring_prep_read_fixed(sqe, stream->socket, buf, URING_CHUNK_SIZE,
+                                 0, stream->index);
+    } else {
+        io_uring_prep_read(sqe, stream->socket, buf, URING_CHUNK_SIZE, 0);
+    }
+    io_uring_sqe_set_data(sqe, stream);
+    stream->in_flight = SDL_TRUE;
+}
+
+// call with reader->mutex locked
+static void complete_read(struct uring_stream *stream, int res) {
+    SDL_assert(stream->in_flight);
+    stream->in_flight = SDL_FALSE;
+    if (res > 0) {
+        unsigned chunk_index = (stream->head + stream->filled)
+                             % URING_STREAM_CHUNKS;
+        struct uring_chunk *chunk = &stream->chunks[chunk_index];
+        chunk->size = res;
+        chunk->offset = 0;
+        ++stream->filled;
+    } else if (!res) {
+        stream->eof = SDL_TRUE;
+    } else if (res != -EINTR && res != -EAGAIN) {
+        stream->error = -res;
+    } // else the read will be submitted again
+    cond_signal(stream->cond);
+}
+
+static int run_uring_reader(void *data) {
+    struct uring_reader *reader = data;
+
+    SDL_bool wakeup_armed = SDL_FALSE;
+    for (;;) {
+        mutex_lock(reader->mutex);
+        if (reader->stopped) {
+            mutex_unlock(reader->mutex);
+            break;
+        }
+        if (!wakeup_armed) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&reader->ring);
+            SDL_assert(sqe);
+            io_uring_prep_read(sqe, reader->wakeup_fd, &reader->wakeup_value,
+                               sizeof(reader->wakeup_value), 0);
+            io_uring_sqe_set_data(sqe, NULL);
+            wakeup_armed = SDL_TRUE;
+        }
+        for (unsigned i = 0; i < reader->max_streams; ++i) {
+            if (reader->streams[i]) {
+                submit_read(reader, reader->streams[i]);
+            }
+        }
+        mutex_unlock(reader->mutex);
+
+        int ret = io_uring_submit(&reader->ring);
+        if (ret < 0) {
+            LOGE("Could not submit io_uring reads: %s", strerror(-ret));
+            break;
+        }
+
+        struct io_uring_cqe *cqe;
+        ret = io_uring_wait_cqe(&reader->ring, &cqe);
+        if (ret == -EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            LOGE("Could not wait for io_uring completion: %s",
+                 strerror(-ret));
+            break;
+        }
+
+        mutex_lock(reader->mutex);
+        do {
+            struct uring_stream *stream = io_uring_cqe_get_data(cqe);
+            if (!stream) {
+                wakeup_armed = SDL_FALSE;
+            } else if (!reader->stopped) {
+                // once stopped, the streams may be destroyed without waiting
+                // for their pending read
+                complete_read(stream, cqe->res);
+            }
+            io_uring_cqe_seen(&reader->ring, cqe);
+        } while (!io_uring_peek_cqe(&reader->ring, &cqe));
+        mutex_unlock(reader->mutex);
+    }
+
+    // on error, do not let the decoders wait forever
+    mutex_lock(reader->mutex);
+    reader->stopped = SDL_TRUE;
+    for (unsigned i = 0; i < reader->max_streams; ++i) {
+        if (reader->streams[i]) {
+            cond_signal(reader->streams[i]->cond);
+        }
+    }
+    mutex_unlock(reader->mutex);
+
+    LOGD("io_uring reader stopped");
+    return 0;
+}
+
+SDL_bool uring_reader_start(struct uring_reader *reader) {
+    LOGD("Starting io_uring reader thread");
+
+    reader->thread = SDL_CreateThread(run_uring_reader, "uring_reader",
+                                      reader);
+    if (!reader->thread) {
+        LOGC("Could not start io_uring reader thread");
+        return SDL_FALSE;
+    }
+    return SDL_TRUE;
+}
+
+void uring_reader_stop(struct uring_reader *reader) {
+    mutex_lock(reader->mutex);
+    reader->stopped = SDL_TRUE;
+    mutex_unlock(reader->mutex);
+    wake_up(reader);
+}
+
+void uring_reader_join(struct uring_reader *reader) {
+    SDL_WaitThread(reader->thread, NULL);
+}
+
+SDL_bool uring_stream_init(struct uring_stream *stream,
+                           struct uring_reader *reader, socket_t socket) {
+    if (!(stream->cond = SDL_CreateCond())) {
+        return SDL_FALSE;
+    }
+
+    stream->reader = reader;
+    stream->socket = socket;
+    stream->head = 0;
+    stream->filled = 0;
+    stream->in_flight = SDL_FALSE;
+    stream->eof = SDL_FALSE;
+    stream->error = 0;
+
+    mutex_lock(reader->mutex);
+    unsigned i = 0;
+    while (i < reader->max_streams && reader->streams[i]) {
+        ++i;
+    }
+    if (i == reader->max_streams) {
+        mutex_unlock(reader->mutex);
+        LOGE("Too many io_uring streams (max %u)", reader->max_streams);
+        SDL_DestroyCond(stream->cond);
+        return SDL_FALSE;
+    }
+    stream->index = i;
+    reader->streams[i] = stream;
+    mutex_unlock(reader->mutex);
+
+    // submit the first read
+    wake_up(reader);
+    return SDL_TRUE;
+}
+
+void uring_stream_destroy(struct uring_stream *stream) {
+    struct uring_reader *reader = stream->reader;
+
+    // complete the pending read (with EOF), if any
+    net_shutdown(stream->socket, SHUT_RD);
+
+    mutex_lock(reader->mutex);
+    while (stream->in_flight && !reader->stopped) {
+        cond_wait(stream->cond, reader->mutex);
+    }
+    reader->streams[stream->index] = NULL;
+    mutex_unlock(reader->mutex);
+
+    SDL_DestroyCond(stream->cond);
+}
+
+ssize_t uring_stream_read(struct uring_stream *stream, void *buf, size_t len) {
+    struct uring_reader *reader = stream->reader;
+
+    mutex_lock(reader->mutex);
+    while (!stream->filled && !stream->eof && !stream->error
+            && !reader->stopped) {
+        cond_wait(stream->cond, reader->mutex);
+    }
+    if (!stream->filled) {
+        int error = stream->error;
+        mutex_unlock(reader->mutex);
+        if (error) {
+            errno = error;
+            return -1;
+        }
+        // EOF
+        return 0;
+    }
+    // the I/O thread never writes to the filled chunks, so they may be read
+    // without lock
+    struct uring_chunk *chunk = &stream->chunks[stream->head];
+    Uint8 *data = chunk_data(reader, stream->index, stream->head);
+    mutex_unlock(reader->mutex);
+
+    size_t r = MIN(len, chunk->size - chunk->offset);
+    memcpy(buf, &data[chunk->offset], r);
+
+    mutex_lock(reader->mutex);
+    chunk->offset += r;
+    if (chunk->offset == chunk->size) {
+        // release the chunk
+        SDL_bool was_full = stream->filled == URING_STREAM_CHUNKS;
+        stream->head = (stream->head + 1) % URING_STREAM_CHUNKS;
+        --stream->filled;
+        if (was_full) {
+            // no read is in flight, submit one
+            wake_up(reader);
+        }
+    }
+    mutex_unlock(reader->mutex);
+
+    return r;
+}
@@ -0,0 +1,76 @@
+#ifndef URING_READER_H
+#define URING_READER_H
+
+#include <liburing.h>
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_stdinc.h>
+#include <SDL2/SDL_thread.h>
+
+#include "net.h"
+
+// Read the video sockets of all the devices from a single I/O thread with
+// io_uring (Linux only, built with -Dio_uring=true).
+//
+// The socket data is received directly into per-stream chunks (registered
+// once to the kernel, if RLIMIT_MEMLOCK allows it), then consumed by the
+// decoders from memory. A stream has one read in flight at a time, so the
+// chunks are filled in order.
+
+#define URING_STREAM_CHUNKS 4
+#define URING_CHUNK_SIZE 0x10000
+
+struct uring_chunk {
+    size_t size; // bytes received
+    size_t offset; // bytes consumed
+};
+
+struct uring_reader;
+
+struct uring_stream {
+    struct uring_reader *reader;
+    socket_t socket;
+    unsigned index; // in reader->streams, and in the registered buffers
+    SDL_cond *cond; // signaled on data, EOF or error
+    // circular: chunks [head, head + filled) contain unread data, the next
+    // one is being received if in_flight
+    struct uring_chunk chunks[URING_STREAM_CHUNKS];
+    unsigned head;
+    unsigned filled;
+    SDL_bool in_flight;
+    SDL_bool eof;
+    int error; // errno of the failed read, 0 if none
+};
+
+struct uring_reader {
+    struct io_uring ring;
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    int wakeup_fd; // eventfd, to wake up the I/O thread
+    Uint64 wakeup_value; // receives the eventfd counter
+    SDL_bool stopped;
+    SDL_bool registered; // the buffers are registered (fixed reads)
+    unsigned max_streams;
+    Uint8 *buffers; // URING_STREAM_CHUNKS chunks per stream
+    struct uring_stream **streams; // NULL for the free slots
+};
+
+// return SDL_FALSE if io_uring is not available (the caller may fall back to
+// recv())
+SDL_bool uring_reader_init(struct uring_reader *reader, unsigned max_streams);
+void uring_reader_destroy(struct uring_reader *reader);
+
+SDL_bool uring_reader_start(struct uring_reader *reader);
+// the pending reads return EOF
+void uring_reader_stop(struct uring_reader *reader);
+void uring_reader_join(struct uring_reader *reader);
+
+// the reads start immediately
+SDL_bool uring_stream_init(struct uring_stream *stream,
+                           struct uring_reader *reader, socket_t socket);
+// the socket must be shut down (or the reader stopped) before
+void uring_stream_destroy(struct uring_stream *stream);
+
+// same semantics as net_recv()
+ssize_t uring_stream_read(struct uring_stream *stream, void *buf, size_t len);
+
+#endif
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 /**
@@ -487,7 +488,9 @@ static const unsigned char REPORT_DESC[] = {
     0xC0, // End Collection
 };
 #define REPORT_DESC_SIZE (sizeof(REPORT_DESC) / sizeof(REPORT_DESC[0]))
-#define HID_EVENT_SIZE 5
+// in the hid_keys tables, the press report contains the modifiers and the key
+#define HID_KEY_MODIFIERS_INDEX 1
+#define HID_KEY_USAGE_INDEX 4
 
 // <https://source.android.com/devices/accessories/aoa2#hid-support>
 #define AOA_REGISTER_HID 54
@@ -501,7 +504,21 @@ inline static void print_libusb_error(enum libusb_error errcode) {
     fprintf(stderr, "%s\n", libusb_strerror(errcode));
 }
 
-inline static libusb_device* find_device(uint16_t vid, uint16_t pid) {
+// the USB serial number of an Android device is its adb serial
+inline static int device_has_serial(libusb_device* device, const struct libusb_device_descriptor* desc, const char* serial) {
+    libusb_device_handle* handle;
+    if (!desc->iSerialNumber || libusb_open(device, &handle)) {
+        return 0;
+    }
+    unsigned char buffer[128];
+    int len = libusb_get_string_descriptor_ascii(handle, desc->iSerialNumber, buffer, sizeof(buffer));
+    libusb_close(handle);
+    return len > 0 && (size_t)len == strlen(serial) && !memcmp(buffer, serial, len);
+}
+
+// match the first device with these ids if serial is NULL, otherwise the
+// device with this serial, whatever its ids (the devices may be of any model)
+inline static libusb_device* find_device(uint16_t vid, uint16_t pid, const char* serial) {
     libusb_device** list;
     libusb_device* found = NULL;
     ssize_t cnt = libusb_get_device_list(NULL, &list);
@@ -514,7 +531,8 @@ inline static libusb_device* find_device(uint16_t vid, uint16_t pid) {
         libusb_device* device = list[i];
         struct libusb_device_descriptor desc;
         libusb_get_device_descriptor(device, &desc);
-        if (vid == desc.idVendor && pid == desc.idProduct) {
+        if (serial ? device_has_serial(device, &desc, serial)
+                   : vid == desc.idVendor && pid == desc.idProduct) {
             libusb_ref_device(device);
             found = device;
             break;
@@ -524,13 +542,13 @@ inline static libusb_device* find_device(uint16_t vid, uint16_t pid) {
     return found;
 }
 
-inline static int register_hid(libusb_device_handle* handle, uint16_t descriptor_size) {
+inline static int register_hid(libusb_device_handle* handle, uint16_t id, uint16_t descriptor_size) {
     const uint8_t requestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     const uint8_t request = AOA_REGISTER_HID;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
     // index (arg1): total length of the HID report descriptor
-    const uint16_t value = 0;
+    const uint16_t value = id;
     const uint16_t index = descriptor_size;
     unsigned char* const buffer = NULL;
     const uint16_t length = 0;
@@ -544,13 +562,13 @@ inline static int register_hid(libusb_device_handle* handle, uint16_t descriptor
     return 0;
 }
 
-inline static int send_hid_descriptor(libusb_device_handle* handle, const unsigned char* descriptor,
+inline static int send_hid_descriptor(libusb_device_handle* handle, uint16_t id, const unsigned char* descriptor,
     uint16_t size, uint8_t max_packet_size_0) {
     const uint8_t requestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     const uint8_t request = AOA_SET_HID_REPORT_DESC;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
-    const uint16_t value = 0;
+    const uint16_t value = id;
     // libusb_control_transfer expects non-const but should not modify it
     unsigned char* const buffer = (unsigned char*)descriptor;
     const unsigned int timeout = DEFAULT_TIMEOUT;
@@ -581,24 +599,23 @@ inline static int send_hid_descriptor(libusb_device_handle* handle, const unsign
     return 0;
 }
 
-inline static int send_hid_event(
-    libusb_device_handle* handle, const unsigned char* event, uint16_t size) {
+// Send a HID event synchronously, and return the libusb error, if any (the
+// input events are sent asynchronously by the hid_sender).
+//
+// The device registers the HID device asynchronously once it received the
+// descriptor: until then, the events are rejected (LIBUSB_ERROR_PIPE).
+inline static int send_hid_event(libusb_device_handle* handle, uint16_t id, const unsigned char* event, uint16_t size) {
     const uint8_t requestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR;
     const uint8_t request = AOA_SEND_HID_EVENT;
     // <https://source.android.com/devices/accessories/aoa2.html#hid-support>
     // value (arg0): accessory assigned ID for the HID device
     // index (arg1): 0 (unused)
-    const uint16_t value = 0;
+    const uint16_t value = id;
     const uint16_t index = 0;
     // libusb_control_transfer expects non-const but should not modify it
     unsigned char* const buffer = (unsigned char*)event;
-    const uint16_t length = size;
     const unsigned int timeout = DEFAULT_TIMEOUT;
     int r = libusb_control_transfer(
-        handle, requestType, request, value, index, buffer, length, timeout);
-    if (r < 0) {
-        print_libusb_error((enum libusb_error)r);
-        return 1;
-    }
-    return 0;
+        handle, requestType, request, value, index, buffer, size, timeout);
+    return r < 0 ? r : 0;
 }
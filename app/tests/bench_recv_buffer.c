@@ -0,0 +1,120 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+
+#include "buffer_util.h"
+#include "common.h"
+#include "recv_buffer.h"
+
+// Compare, over a socketpair, the number of syscalls and the time needed to
+// receive a stream of small packets, each preceded by a 12-byte meta header
+// (like the video stream when recording), read:
+//  - directly from the socket (one recv() for the header, at least one for
+//    the payload);
+//  - through a recv_buffer.
+
+#define HEADER_SIZE 12
+#define READ_SIZE 0x10000 // the decoder avio buffer size
+#define PACKETS 200000
+
+// typical sizes of P-frames for a mostly static screen
+static const size_t payload_sizes[] = { 200, 1500, 80, 5000, 800, 120 };
+
+static size_t payload_size(int i) {
+    return payload_sizes[i % ARRAY_LEN(payload_sizes)];
+}
+
+static int run_writer(void *data) {
+    socket_t socket = *(socket_t *) data;
+    static Uint8 packet[HEADER_SIZE + 5000];
+    for (int i = 0; i < PACKETS; ++i) {
+        size_t size = payload_size(i);
+        buffer_write32be(&packet[8], size);
+        ssize_t w = net_send_all(socket, packet, HEADER_SIZE + size);
+        assert(w != -1);
+    }
+    return 0;
+}
+
+struct result {
+    unsigned syscalls;
+    Uint64 ticks;
+};
+
+static void read_direct(socket_t socket, struct result *result) {
+    static Uint8 buf[READ_SIZE];
+    for (int i = 0; i < PACKETS; ++i) {
+        Uint8 header[HEADER_SIZE];
+        ssize_t r = net_recv_all(socket, header, HEADER_SIZE);
+        assert(r == HEADER_SIZE);
+        ++result->syscalls;
+        size_t remaining = buffer_read32be(&header[8]);
+        while (remaining) {
+            r = net_recv(socket, buf, MIN(remaining, READ_SIZE));
+            assert(r > 0);
+            ++result->syscalls;
+            remaining -= r;
+        }
+    }
+}
+
+static void read_buffered(socket_t socket, struct result *result) {
+    static Uint8 buf[READ_SIZE];
+    struct recv_buffer rb;
+    SDL_bool ok = recv_buffer_init(&rb, socket, READ_SIZE);
+    assert(ok);
+    for (int i = 0; i < PACKETS; ++i) {
+        Uint8 header[HEADER_SIZE];
+        // the buffer is refilled (a syscall) only once empty
+        if (!rb.size) {
+            ++result->syscalls;
+        }
+        ssize_t r = recv_buffer_read_all(&rb, header, HEADER_SIZE);
+        assert(r == HEADER_SIZE);
+        size_t remaining = buffer_read32be(&header[8]);
+        while (remaining) {
+            if (!rb.size) {
+                ++result->syscalls;
+            }
+            r = recv_buffer_read(&rb, buf, MIN(remaining, READ_SIZE));
+            assert(r > 0);
+            remaining -= r;
+        }
+    }
+    recv_buffer_destroy(&rb);
+}
+
+static void bench(const char *name,
+                  void (*read_all)(socket_t, struct result *)) {
+    socket_t sockets[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!ret);
+
+    SDL_Thread *thread = SDL_CreateThread(run_writer, "writer", &sockets[1]);
+    assert(thread);
+
+    struct result result = {0};
+    Uint64 start = SDL_GetPerformanceCounter();
+    read_all(sockets[0], &result);
+    result.ticks = SDL_GetPerformanceCounter() - start;
+
+    SDL_WaitThread(thread, NULL);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+
+    double ms = result.ticks * 1000.0 / SDL_GetPerformanceFrequency();
+    printf("%-10s %10u %14.2f %10.1f %10.3f\n", name, result.syscalls,
+           (double) result.syscalls / PACKETS, ms, ms * 1000 / PACKETS);
+    fflush(stdout);
+}
+
+int main(void) {
+    printf("%-10s %10s %14s %10s %10s\n", "reader", "syscalls",
+           "syscalls/pkt", "total(ms)", "us/pkt");
+    bench("direct", read_direct);
+    bench("buffered", read_buffered);
+    return 0;
+}
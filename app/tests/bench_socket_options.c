@@ -0,0 +1,152 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+
+#include "common.h"
+#include "net.h"
+
+// Measure, over loopback, the effect of each socket option on:
+//  - the latency of small messages (like the control events), sent in two
+//    writes (like the frame meta header followed by the packet), which is the
+//    worst case for Nagle's algorithm combined with delayed ACKs;
+//  - the throughput of a large stream (like the video).
+//
+// Loopback hides the network, so it only measures the overhead on the
+// endpoints. The options are applied on both sides.
+
+#define IPV4_LOCALHOST 0x7F000001
+#define BENCH_PORT 27198
+
+#define MESSAGE_HEADER_SIZE 12
+#define MESSAGE_SIZE 64
+#define ROUND_TRIPS 200
+
+#define CHUNK_SIZE 0x10000
+#define STREAM_SIZE (256 << 20) // 256MiB
+
+struct bench_case {
+    const char *name;
+    struct net_socket_options options;
+};
+
+static const struct bench_case cases[] = {
+    { "default",          { 0 } },
+    { "nodelay",          { .nodelay = SDL_TRUE } },
+    { "buffers 1MiB",     { .rcvbuf = 1 << 20, .sndbuf = 1 << 20 } },
+    { "busy_poll 50us",   { .busy_poll = 50 } },
+};
+
+struct peer {
+    socket_t server_socket;
+    const struct net_socket_options *options;
+};
+
+static int run_peer(void *data) {
+    struct peer *peer = data;
+    socket_t socket = net_accept(peer->server_socket, peer->options);
+    assert(socket != INVALID_SOCKET);
+
+    // echo the messages
+    char msg[MESSAGE_SIZE];
+    for (int i = 0; i < ROUND_TRIPS; ++i) {
+        ssize_t r = net_recv_all(socket, msg, MESSAGE_SIZE);
+        assert(r == MESSAGE_SIZE);
+        ssize_t w = net_send_all(socket, msg, MESSAGE_SIZE);
+        assert(w != -1);
+    }
+
+    // then stream
+    char *chunk = calloc(1, CHUNK_SIZE);
+    assert(chunk);
+    for (size_t sent = 0; sent < STREAM_SIZE; sent += CHUNK_SIZE) {
+        ssize_t w = net_send_all(socket, chunk, CHUNK_SIZE);
+        assert(w != -1);
+    }
+    free(chunk);
+
+    net_close(socket);
+    return 0;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    Uint64 x = *(const Uint64 *) a;
+    Uint64 y = *(const Uint64 *) b;
+    return x < y ? -1 : x > y;
+}
+
+static double to_us(Uint64 ticks) {
+    return ticks * 1000000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void bench(const struct bench_case *c) {
+    socket_t server_socket = net_listen(IPV4_LOCALHOST, BENCH_PORT, 1,
+                                        &c->options);
+    assert(server_socket != INVALID_SOCKET);
+
+    struct peer peer = {
+        .server_socket = server_socket,
+        .options = &c->options,
+    };
+    SDL_Thread *thread = SDL_CreateThread(run_peer, "peer", &peer);
+    assert(thread);
+
+    socket_t socket = net_connect(IPV4_LOCALHOST, BENCH_PORT, &c->options);
+    assert(socket != INVALID_SOCKET);
+
+    static Uint64 rtt[ROUND_TRIPS];
+    char msg[MESSAGE_SIZE] = {0};
+    for (int i = 0; i < ROUND_TRIPS; ++i) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        ssize_t w = net_send_all(socket, msg, MESSAGE_HEADER_SIZE);
+        assert(w != -1);
+        w = net_send_all(socket, msg + MESSAGE_HEADER_SIZE,
+                         MESSAGE_SIZE - MESSAGE_HEADER_SIZE);
+        assert(w != -1);
+        ssize_t r = net_recv_all(socket, msg, MESSAGE_SIZE);
+        assert(r == MESSAGE_SIZE);
+        rtt[i] = SDL_GetPerformanceCounter() - start;
+    }
+    qsort(rtt, ROUND_TRIPS, sizeof(rtt[0]), compare_u64);
+    Uint64 total = 0;
+    for (int i = 0; i < ROUND_TRIPS; ++i) {
+        total += rtt[i];
+    }
+
+    char *chunk = malloc(CHUNK_SIZE);
+    assert(chunk);
+    Uint64 start = SDL_GetPerformanceCounter();
+    size_t received = 0;
+    while (received < STREAM_SIZE) {
+        ssize_t r = net_recv(socket, chunk, CHUNK_SIZE);
+        assert(r > 0);
+        received += r;
+    }
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+    free(chunk);
+
+    printf("%-18s %10.1f %10.1f %10.1f %12.1f\n", c->name,
+           to_us(total / ROUND_TRIPS), to_us(rtt[ROUND_TRIPS / 2]),
+           to_us(rtt[ROUND_TRIPS * 99 / 100]),
+           STREAM_SIZE / (to_us(elapsed) / 1000000) / (1 << 20));
+    fflush(stdout);
+
+    net_close(socket);
+    SDL_WaitThread(thread, NULL);
+    net_close(server_socket);
+}
+
+int main(void) {
+    assert(net_init());
+    printf("%-18s %10s %10s %10s %12s\n", "options", "rtt avg", "rtt p50",
+           "rtt p99", "throughput");
+    printf("%-18s %10s %10s %10s %12s\n", "", "(us)", "(us)", "(us)",
+           "(MiB/s)");
+    for (size_t i = 0; i < ARRAY_LEN(cases); ++i) {
+        bench(&cases[i]);
+    }
+    net_cleanup();
+    return 0;
+}
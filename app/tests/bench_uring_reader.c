@@ -0,0 +1,138 @@
+#include <assert.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+
+#include "uring_reader.h"
+
+// Compare the CPU time spent to receive several video streams (like several
+// devices), over socketpairs:
+//  - with one thread per stream, calling recv() (the default path);
+//  - with the shared io_uring I/O thread, the consumers reading the chunks.
+//
+// The CPU time of the writers is measured separately, and subtracted.
+
+#define STREAMS 4
+#define STREAM_SIZE (256 << 20) // 256MiB per stream
+#define WRITE_SIZE 0x4000 // like an encoded frame
+#define READ_SIZE 0x10000 // the decoder avio buffer size
+
+static struct uring_reader uring_reader;
+
+struct stream {
+    socket_t sockets[2];
+    struct uring_stream uring_stream;
+    SDL_bool use_uring;
+    double writer_cpu; // in seconds
+    Uint8 buf[READ_SIZE];
+};
+
+static double cpu_time(clockid_t clock) {
+    struct timespec ts;
+    int ret = clock_gettime(clock, &ts);
+    assert(!ret);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int run_writer(void *data) {
+    struct stream *stream = data;
+    double start = cpu_time(CLOCK_THREAD_CPUTIME_ID);
+    static Uint8 buf[WRITE_SIZE];
+    for (size_t sent = 0; sent < STREAM_SIZE; sent += WRITE_SIZE) {
+        ssize_t w = net_send_all(stream->sockets[1], buf, WRITE_SIZE);
+        assert(w != -1);
+    }
+    net_shutdown(stream->sockets[1], SHUT_WR);
+    stream->writer_cpu = cpu_time(CLOCK_THREAD_CPUTIME_ID) - start;
+    return 0;
+}
+
+static int run_consumer(void *data) {
+    struct stream *stream = data;
+    Uint8 *buf = stream->buf;
+    size_t received = 0;
+    for (;;) {
+        ssize_t r = stream->use_uring
+                  ? uring_stream_read(&stream->uring_stream, buf, READ_SIZE)
+                  : net_recv(stream->sockets[0], buf, READ_SIZE);
+        assert(r >= 0);
+        if (!r) {
+            break;
+        }
+        received += r;
+    }
+    assert(received == STREAM_SIZE);
+    return 0;
+}
+
+static void bench(const char *name, SDL_bool use_uring) {
+    static struct stream streams[STREAMS];
+    SDL_Thread *writers[STREAMS];
+    SDL_Thread *consumers[STREAMS];
+
+    if (use_uring) {
+        SDL_bool ok = uring_reader_start(&uring_reader);
+        assert(ok);
+    }
+
+    double cpu_start = cpu_time(CLOCK_PROCESS_CPUTIME_ID);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < STREAMS; ++i) {
+        struct stream *stream = &streams[i];
+        int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, stream->sockets);
+        assert(!ret);
+        stream->use_uring = use_uring;
+        if (use_uring) {
+            SDL_bool ok = uring_stream_init(&stream->uring_stream,
+                                            &uring_reader, stream->sockets[0]);
+            assert(ok);
+        }
+        consumers[i] = SDL_CreateThread(run_consumer, "consumer", stream);
+        writers[i] = SDL_CreateThread(run_writer, "writer", stream);
+        assert(consumers[i] && writers[i]);
+    }
+
+    double writers_cpu = 0;
+    for (int i = 0; i < STREAMS; ++i) {
+        SDL_WaitThread(writers[i], NULL);
+        SDL_WaitThread(consumers[i], NULL);
+        writers_cpu += streams[i].writer_cpu;
+    }
+    double elapsed = (SDL_GetPerformanceCounter() - start)
+                   / (double) SDL_GetPerformanceFrequency();
+    double reader_cpu = cpu_time(CLOCK_PROCESS_CPUTIME_ID) - cpu_start
+                      - writers_cpu;
+
+    for (int i = 0; i < STREAMS; ++i) {
+        if (use_uring) {
+            uring_stream_destroy(&streams[i].uring_stream);
+        }
+        net_close(streams[i].sockets[0]);
+        net_close(streams[i].sockets[1]);
+    }
+    if (use_uring) {
+        uring_reader_stop(&uring_reader);
+        uring_reader_join(&uring_reader);
+    }
+
+    double mbits = (double) STREAMS * STREAM_SIZE * 8 / 1e6;
+    printf("%-8s %10.0f %12.1f %14.3f\n", name, mbits / elapsed,
+           reader_cpu * 1000, reader_cpu * 1e6 / mbits);
+    fflush(stdout);
+}
+
+int main(void) {
+    printf("%d streams of %d MiB\n", STREAMS, STREAM_SIZE >> 20);
+    printf("%-8s %10s %12s %14s\n", "reader", "Mbps", "cpu(ms)",
+           "cpu(us)/Mbit");
+    bench("recv", SDL_FALSE);
+    if (!uring_reader_init(&uring_reader, STREAMS)) {
+        fprintf(stderr, "io_uring not available\n");
+        return 0;
+    }
+    bench("io_uring", SDL_TRUE);
+    uring_reader_destroy(&uring_reader);
+    return 0;
+}
@@ -1,17 +1,19 @@
 #include <assert.h>
 #include <string.h>
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_thread.h>
 
 #include "control_event.h"
 
 static void test_control_event_queue_empty(void) {
     struct control_event_queue queue;
-    SDL_bool init_ok = control_event_queue_init(&queue);
+    SDL_bool init_ok = control_event_queue_init(&queue, 64);
     assert(init_ok);
 
     assert(control_event_queue_is_empty(&queue));
 
     struct control_event dummy_event;
-    SDL_bool push_ok = control_event_queue_push(&queue, &dummy_event);
+    SDL_bool push_ok = control_event_queue_push(&queue, &dummy_event, NULL);
     assert(push_ok);
     assert(!control_event_queue_is_empty(&queue));
 
@@ -27,14 +29,17 @@ static void test_control_event_queue_empty(void) {
 
 static void test_control_event_queue_full(void) {
     struct control_event_queue queue;
-    SDL_bool init_ok = control_event_queue_init(&queue);
+    SDL_bool init_ok = control_event_queue_init(&queue, 64);
     assert(init_ok);
 
     assert(!control_event_queue_is_full(&queue));
 
     struct control_event dummy_event;
     // fill the queue
-    while (control_event_queue_push(&queue, &dummy_event));
+    while (control_event_queue_push(&queue, &dummy_event, NULL));
+    assert(control_event_queue_is_full(&queue));
+    assert(queue.max_depth == 64);
+    assert(queue.dropped == 1);
 
     SDL_bool take_ok = control_event_queue_take(&queue, &dummy_event);
     assert(take_ok);
@@ -45,7 +50,7 @@ static void test_control_event_queue_full(void) {
 
 static void test_control_event_queue_push_take(void) {
     struct control_event_queue queue;
-    SDL_bool init_ok = control_event_queue_init(&queue);
+    SDL_bool init_ok = control_event_queue_init(&queue, 64);
     assert(init_ok);
 
     struct control_event event = {
@@ -57,7 +62,7 @@ static void test_control_event_queue_push_take(void) {
         },
     };
 
-    SDL_bool push1_ok = control_event_queue_push(&queue, &event);
+    SDL_bool push1_ok = control_event_queue_push(&queue, &event, NULL);
     assert(push1_ok);
 
     event = (struct control_event) {
@@ -67,7 +72,7 @@ static void test_control_event_queue_push_take(void) {
         },
     };
 
-    SDL_bool push2_ok = control_event_queue_push(&queue, &event);
+    SDL_bool push2_ok = control_event_queue_push(&queue, &event, NULL);
     assert(push2_ok);
 
     // overwrite event
@@ -87,9 +92,226 @@ static void test_control_event_queue_push_take(void) {
     control_event_queue_destroy(&queue);
 }
 
+static void init_mouse_event(struct control_event *event,
+                             enum android_motionevent_action action,
+                             Uint16 x, Uint16 y) {
+    *event = (struct control_event) {
+        .type = CONTROL_EVENT_TYPE_MOUSE,
+        .mouse_event = {
+            .action = action,
+            .buttons = AMOTION_EVENT_BUTTON_PRIMARY,
+            .position = {
+                .point = {
+                    .x = x,
+                    .y = y,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+        },
+    };
+}
+
+static void test_control_event_queue_coalesce(void) {
+    struct control_event_queue queue;
+    SDL_bool init_ok = control_event_queue_init(&queue, 64);
+    assert(init_ok);
+
+    struct control_event event;
+
+    // nothing to merge into
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_MOVE, 10, 20);
+    assert(!control_event_queue_coalesce(&queue, &event));
+
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_DOWN, 10, 20);
+    SDL_bool push_ok = control_event_queue_push(&queue, &event, NULL);
+    assert(push_ok);
+
+    // a MOVE is never merged into a DOWN
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_MOVE, 11, 21);
+    assert(!control_event_queue_coalesce(&queue, &event));
+    push_ok = control_event_queue_push(&queue, &event, NULL);
+    assert(push_ok);
+
+    // consecutive MOVE are merged
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_MOVE, 12, 22);
+    assert(control_event_queue_coalesce(&queue, &event));
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_MOVE, 13, 23);
+    assert(control_event_queue_coalesce(&queue, &event));
+
+    // an UP is never merged
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_UP, 13, 23);
+    assert(!control_event_queue_coalesce(&queue, &event));
+    push_ok = control_event_queue_push(&queue, &event, NULL);
+    assert(push_ok);
+
+    SDL_bool take_ok = control_event_queue_take(&queue, &event);
+    assert(take_ok);
+    assert(event.mouse_event.action == AMOTION_EVENT_ACTION_DOWN);
+    assert(event.mouse_event.position.point.x == 10);
+    assert(event.mouse_event.position.point.y == 20);
+
+    take_ok = control_event_queue_take(&queue, &event);
+    assert(take_ok);
+    assert(event.mouse_event.action == AMOTION_EVENT_ACTION_MOVE);
+    assert(event.mouse_event.position.point.x == 13);
+    assert(event.mouse_event.position.point.y == 23);
+
+    take_ok = control_event_queue_take(&queue, &event);
+    assert(take_ok);
+    assert(event.mouse_event.action == AMOTION_EVENT_ACTION_UP);
+
+    assert(control_event_queue_is_empty(&queue));
+
+    control_event_queue_destroy(&queue);
+}
+
+static void test_control_event_queue_capacity(void) {
+    struct control_event_queue queue;
+    SDL_bool init_ok = control_event_queue_init(&queue, 5);
+    assert(init_ok);
+
+    // rounded up to a power of 2
+    assert(queue.capacity == 8);
+
+    struct control_event event;
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_DOWN, 0, 0);
+    for (int i = 0; i < 8; ++i) {
+        SDL_bool push_ok = control_event_queue_push(&queue, &event, NULL);
+        assert(push_ok);
+    }
+    assert(!control_event_queue_push(&queue, &event, NULL));
+    assert(!control_event_queue_push(&queue, &event, NULL));
+    assert(queue.dropped == 2);
+
+    control_event_queue_destroy(&queue);
+}
+
+static void test_control_event_queue_take_all(void) {
+    struct control_event_queue queue;
+    SDL_bool init_ok = control_event_queue_init(&queue, 4);
+    assert(init_ok);
+
+    struct control_event events[4];
+    assert(!control_event_queue_take_all(&queue, events, 4));
+
+    // wrap around the ring several times
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            struct control_event event;
+            init_mouse_event(&event, AMOTION_EVENT_ACTION_DOWN, i, round);
+            SDL_bool push_ok = control_event_queue_push(&queue, &event, NULL);
+            assert(push_ok);
+        }
+
+        unsigned count = control_event_queue_take_all(&queue, events, 2);
+        assert(count == 2);
+        assert(events[0].mouse_event.position.point.x == 0);
+        assert(events[1].mouse_event.position.point.x == 1);
+
+        count = control_event_queue_take_all(&queue, events, 4);
+        assert(count == 1);
+        assert(events[0].mouse_event.position.point.x == 2);
+        assert(events[0].mouse_event.position.point.y == round);
+    }
+    assert(queue.max_depth == 3);
+
+    control_event_queue_destroy(&queue);
+}
+
+static void test_control_event_queue_no_coalesce_after_take(void) {
+    struct control_event_queue queue;
+    SDL_bool init_ok = control_event_queue_init(&queue, 64);
+    assert(init_ok);
+
+    struct control_event event;
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_MOVE, 10, 20);
+    SDL_bool push_ok = control_event_queue_push(&queue, &event, NULL);
+    assert(push_ok);
+
+    SDL_bool take_ok = control_event_queue_take(&queue, &event);
+    assert(take_ok);
+
+    // the MOVE has been consumed, it must not be modified anymore
+    init_mouse_event(&event, AMOTION_EVENT_ACTION_MOVE, 11, 21);
+    assert(!control_event_queue_coalesce(&queue, &event));
+
+    control_event_queue_destroy(&queue);
+}
+
+#define STRESS_EVENT_COUNT 200000
+
+struct stress_data {
+    struct control_event_queue queue;
+    SDL_sem *sem;
+};
+
+// push like the controller: wake up the consumer only on the empty -> non-empty
+// transition
+static int run_stress_producer(void *data) {
+    struct stress_data *stress = data;
+    for (unsigned i = 0; i < STRESS_EVENT_COUNT; ++i) {
+        struct control_event event;
+        init_mouse_event(&event, AMOTION_EVENT_ACTION_DOWN, i & 0xFFFF,
+                         i >> 16);
+        SDL_bool first;
+        while (!control_event_queue_push(&stress->queue, &event, &first)) {
+            // the queue is full, the consumer has been woken up already
+        }
+        if (first) {
+            SDL_SemPost(stress->sem);
+        }
+    }
+    return 0;
+}
+
+static void test_control_event_queue_wakeup(void) {
+    struct stress_data stress;
+    // a small queue, to be often empty and full
+    SDL_bool init_ok = control_event_queue_init(&stress.queue, 4);
+    assert(init_ok);
+    stress.sem = SDL_CreateSemaphore(0);
+    assert(stress.sem);
+
+    SDL_Thread *thread = SDL_CreateThread(run_stress_producer, "producer",
+                                          &stress);
+    assert(thread);
+
+    // consume like the controller: wait only once the queue is found empty (a
+    // lost wakeup would block forever)
+    unsigned expected = 0;
+    while (expected < STRESS_EVENT_COUNT) {
+        struct control_event events[3];
+        unsigned count = control_event_queue_take_all(&stress.queue, events, 3);
+        if (!count) {
+            SDL_SemWait(stress.sem);
+            continue;
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            const struct position *position = &events[i].mouse_event.position;
+            unsigned value = position->point.x
+                           | (unsigned) position->point.y << 16;
+            assert(value == expected);
+            ++expected;
+        }
+    }
+
+    SDL_WaitThread(thread, NULL);
+    assert(control_event_queue_is_empty(&stress.queue));
+    SDL_DestroySemaphore(stress.sem);
+    control_event_queue_destroy(&stress.queue);
+}
+
 int main(void) {
     test_control_event_queue_empty();
     test_control_event_queue_full();
     test_control_event_queue_push_take();
+    test_control_event_queue_coalesce();
+    test_control_event_queue_capacity();
+    test_control_event_queue_take_all();
+    test_control_event_queue_no_coalesce_after_take();
+    test_control_event_queue_wakeup();
     return 0;
 }
@@ -132,10 +132,105 @@ static void test_serialize_scroll_event(void) {
     assert(!memcmp(buf, expected, sizeof(expected)));
 }
 
+static void test_serialize_swipe_event(void) {
+    struct point points[] = {
+        { .x = 260, .y = 1026 },
+        { .x = 300, .y = 1000 },
+        { .x = 340, .y = 980 },
+    };
+    struct control_event event = {
+        .type = CONTROL_EVENT_TYPE_SWIPE,
+        .swipe_event = {
+            .screen_size = {
+                .width = 1080,
+                .height = 1920,
+            },
+            .points = points,
+            .count = 3,
+            .delay = 50,
+        },
+    };
+
+    unsigned char buf[SERIALIZED_EVENT_MAX_SIZE];
+    int size = control_event_serialize(&event, buf);
+    assert(size == 20);
+
+    const unsigned char expected[] = {
+        0x05, // CONTROL_EVENT_TYPE_SWIPE
+        0x00, 0x32, // 50 ms
+        0x04, 0x38, 0x07, 0x80, // 1080 1920
+        0x03, // 3 points
+        0x01, 0x04, 0x04, 0x02, // 260 1026
+        0x01, 0x2c, 0x03, 0xe8, // 300 1000
+        0x01, 0x54, 0x03, 0xd4, // 340 980
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_touch_event(void) {
+    struct control_event event = {
+        .type = CONTROL_EVENT_TYPE_TOUCH,
+        .touch_event = {
+            .action = AMOTION_EVENT_ACTION_MOVE,
+            .pointer_id = 1,
+            .position = {
+                .point = {
+                    .x = 260,
+                    .y = 1026,
+                },
+                .screen_size = {
+                    .width = 1080,
+                    .height = 1920,
+                },
+            },
+            .pressure = TOUCH_PRESSURE_MAX,
+        },
+    };
+
+    unsigned char buf[SERIALIZED_EVENT_MAX_SIZE];
+    int size = control_event_serialize(&event, buf);
+    assert(size == 13);
+
+    const unsigned char expected[] = {
+        0x06, // CONTROL_EVENT_TYPE_TOUCH
+        0x02, // AMOTION_EVENT_ACTION_MOVE
+        0x01, // pointer id
+        0x01, 0x04, 0x04, 0x02, // 260 1026
+        0x04, 0x38, 0x07, 0x80, // 1080 1920
+        0xff, 0xff, // pressure 1.0
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
+static void test_serialize_set_clipboard_event(void) {
+    struct control_event event = {
+        .type = CONTROL_EVENT_TYPE_SET_CLIPBOARD,
+        .set_clipboard_event = {
+            .text = "hello, world!",
+            .paste = SDL_TRUE,
+        },
+    };
+
+    unsigned char buf[SERIALIZED_EVENT_MAX_SIZE];
+    int size = control_event_serialize(&event, buf);
+    assert(size == 19);
+
+    const unsigned char expected[] = {
+        0x07, // CONTROL_EVENT_TYPE_SET_CLIPBOARD
+        1, // paste
+        0x00, 0x00, 0x00, 0x0d, // text length
+        'h', 'e', 'l', 'l', 'o', ',', ' ', 'w', 'o', 'r', 'l', 'd', '!', // text
+    };
+    assert(!memcmp(buf, expected, sizeof(expected)));
+}
+
 int main(void) {
     test_serialize_keycode_event();
     test_serialize_text_event();
     test_serialize_long_text_event();
     test_serialize_mouse_event();
     test_serialize_scroll_event();
+    test_serialize_swipe_event();
+    test_serialize_touch_event();
+    test_serialize_set_clipboard_event();
 }
@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <stdint.h>
+
+#include "decode_pool.h"
+
+#define DEVICES 3
+#define PACKETS 1000
+
+// the packets are the integers 1..PACKETS (as pointers)
+struct device {
+    struct decode_pool_queue queue;
+    uintptr_t last; // last packet decoded
+    uintptr_t fail_at; // 0 not to fail
+};
+
+static SDL_bool decode(void *opaque, void *packet) {
+    struct device *device = opaque;
+    uintptr_t value = (uintptr_t) packet;
+    // in order, and never decoded concurrently
+    assert(value == device->last + 1);
+    device->last = value;
+    return value != device->fail_at;
+}
+
+static void test_decode_in_order(void) {
+    struct decode_pool pool;
+    SDL_bool ok = decode_pool_init(&pool, 2);
+    assert(ok);
+    ok = decode_pool_start(&pool);
+    assert(ok);
+
+    struct device devices[DEVICES] = {0};
+    for (int i = 0; i < DEVICES; ++i) {
+        ok = decode_pool_queue_init(&devices[i].queue, &pool, decode,
+                                    &devices[i]);
+        assert(ok);
+    }
+
+    // interleave the devices, the queues are often full
+    for (uintptr_t p = 1; p <= PACKETS; ++p) {
+        for (int i = 0; i < DEVICES; ++i) {
+            ok = decode_pool_queue_push(&devices[i].queue, (void *) p);
+            assert(ok);
+        }
+    }
+
+    for (int i = 0; i < DEVICES; ++i) {
+        ok = decode_pool_queue_drain(&devices[i].queue);
+        assert(ok);
+        assert(devices[i].last == PACKETS);
+        decode_pool_queue_destroy(&devices[i].queue);
+    }
+
+    decode_pool_stop(&pool);
+    decode_pool_join(&pool);
+    decode_pool_destroy(&pool);
+}
+
+static void test_decode_failure(void) {
+    struct decode_pool pool;
+    SDL_bool ok = decode_pool_init(&pool, 1);
+    assert(ok);
+    ok = decode_pool_start(&pool);
+    assert(ok);
+
+    struct device device = {
+        .fail_at = 10,
+    };
+    ok = decode_pool_queue_init(&device.queue, &pool, decode, &device);
+    assert(ok);
+
+    // once the failure is reported, the packets are not accepted anymore
+    uintptr_t p = 1;
+    while (decode_pool_queue_push(&device.queue, (void *) p)) {
+        assert(p < PACKETS);
+        ++p;
+    }
+    assert(p > device.fail_at);
+
+    ok = decode_pool_queue_drain(&device.queue);
+    assert(!ok);
+    // the packets pushed before the failure was reported are all passed
+    assert(device.last == p - 1);
+    decode_pool_queue_destroy(&device.queue);
+
+    decode_pool_stop(&pool);
+    decode_pool_join(&pool);
+    decode_pool_destroy(&pool);
+}
+
+int main(void) {
+    test_decode_in_order();
+    test_decode_failure();
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <assert.h>
+#include <string.h>
+
+#include "device_message.h"
+
+static void test_deserialize_clipboard(void) {
+    const unsigned char input[] = {
+        0x00, // DEVICE_MESSAGE_TYPE_CLIPBOARD
+        0x00, 0x00, 0x00, 0x03, // text length
+        'A', 'B', 'C', // text
+    };
+
+    struct device_message msg;
+    ssize_t r = device_message_deserialize(input, sizeof(input), &msg);
+    assert(r == 8);
+    assert(msg.type == DEVICE_MESSAGE_TYPE_CLIPBOARD);
+    assert(!strcmp("ABC", msg.clipboard_message.text));
+
+    device_message_destroy(&msg);
+}
+
+static void test_deserialize_clipboard_empty(void) {
+    const unsigned char input[] = {
+        0x00, // DEVICE_MESSAGE_TYPE_CLIPBOARD
+        0x00, 0x00, 0x00, 0x00, // text length
+    };
+
+    struct device_message msg;
+    ssize_t r = device_message_deserialize(input, sizeof(input), &msg);
+    assert(r == 5);
+    assert(!strcmp("", msg.clipboard_message.text));
+
+    device_message_destroy(&msg);
+}
+
+static void test_deserialize_incomplete(void) {
+    const unsigned char input[] = {
+        0x00, // DEVICE_MESSAGE_TYPE_CLIPBOARD
+        0x00, 0x00, 0x00, 0x03, // text length
+        'A', 'B', 'C', // text
+    };
+
+    struct device_message msg;
+    // header not complete
+    assert(device_message_deserialize(input, 3, &msg) == 0);
+    // text not complete
+    assert(device_message_deserialize(input, 7, &msg) == 0);
+}
+
+static void test_deserialize_invalid(void) {
+    const unsigned char unknown_type[] = {
+        0x42, 0x00, 0x00, 0x00, 0x00,
+    };
+    const unsigned char too_long[] = {
+        0x00, // DEVICE_MESSAGE_TYPE_CLIPBOARD
+        0x7f, 0xff, 0xff, 0xff, // text length
+    };
+
+    struct device_message msg;
+    assert(device_message_deserialize(unknown_type, sizeof(unknown_type),
+                                      &msg) == -1);
+    assert(device_message_deserialize(too_long, sizeof(too_long), &msg) == -1);
+}
+
+static void test_deserialize_several(void) {
+    const unsigned char input[] = {
+        0x00, 0x00, 0x00, 0x00, 0x01, 'A',
+        0x00, 0x00, 0x00, 0x00, 0x02, 'B', 'C',
+    };
+
+    struct device_message msg;
+    ssize_t r = device_message_deserialize(input, sizeof(input), &msg);
+    assert(r == 6);
+    assert(!strcmp("A", msg.clipboard_message.text));
+    device_message_destroy(&msg);
+
+    r = device_message_deserialize(&input[r], sizeof(input) - r, &msg);
+    assert(r == 7);
+    assert(!strcmp("BC", msg.clipboard_message.text));
+    device_message_destroy(&msg);
+}
+
+int main(void) {
+    test_deserialize_clipboard();
+    test_deserialize_clipboard_empty();
+    test_deserialize_incomplete();
+    test_deserialize_invalid();
+    test_deserialize_several();
+    return 0;
+}
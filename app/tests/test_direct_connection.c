@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <string.h>
+#include <SDL2/SDL_thread.h>
+
+#include "direct_connection.h"
+
+#define IPV4_LOCALHOST 0x7F000001
+#define TEST_PORT 27199
+
+static const char *TOKEN = "0123456789abcdef0123456789abcdef";
+
+// a stand-in for the device server: accept one client, and acknowledge it
+// only if it sends the expected token
+static int run_server(void *data) {
+    socket_t server_socket = *(socket_t *) data;
+    socket_t socket = net_accept(server_socket, NULL);
+    assert(socket != INVALID_SOCKET);
+
+    char token[DIRECT_TOKEN_LENGTH];
+    ssize_t r = net_recv_all(socket, token, DIRECT_TOKEN_LENGTH);
+    if (r == DIRECT_TOKEN_LENGTH
+            && !memcmp(token, TOKEN, DIRECT_TOKEN_LENGTH)) {
+        char ack = 0;
+        net_send_all(socket, &ack, 1);
+        // wait for the client to close
+        char c;
+        net_recv(socket, &c, 1);
+    }
+    net_close(socket);
+    return 0;
+}
+
+static void test_connect(const char *token, SDL_bool expect_success) {
+    socket_t server_socket = net_listen(IPV4_LOCALHOST, TEST_PORT, 1, NULL);
+    assert(server_socket != INVALID_SOCKET);
+
+    SDL_Thread *thread = SDL_CreateThread(run_server, "server",
+                                          &server_socket);
+    assert(thread);
+
+    socket_t socket = direct_connect(IPV4_LOCALHOST, TEST_PORT, token, NULL);
+    if (expect_success) {
+        assert(socket != INVALID_SOCKET);
+        net_close(socket);
+    } else {
+        assert(socket == INVALID_SOCKET);
+    }
+
+    SDL_WaitThread(thread, NULL);
+    net_close(server_socket);
+}
+
+static void test_valid_token(void) {
+    test_connect(TOKEN, SDL_TRUE);
+}
+
+static void test_invalid_token(void) {
+    test_connect("00000000000000000000000000000000", SDL_FALSE);
+}
+
+static void test_no_server(void) {
+    socket_t socket = direct_connect(IPV4_LOCALHOST, TEST_PORT, TOKEN, NULL);
+    assert(socket == INVALID_SOCKET);
+}
+
+int main(void) {
+    assert(net_init());
+    test_valid_token();
+    test_invalid_token();
+    test_no_server();
+    net_cleanup();
+    return 0;
+}
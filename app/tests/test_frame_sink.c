@@ -0,0 +1,119 @@
+#define _DEFAULT_SOURCE
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <libavutil/frame.h>
+
+#include "frame_sink.h"
+
+#define WIDTH 6
+#define HEIGHT 5
+// padded lines, as decoded
+#define LINESIZE 16
+
+static Uint8 planes[3][LINESIZE * HEIGHT];
+
+static void fill_frame(AVFrame *frame, Uint8 value, int width, int height) {
+    memset(frame, 0, sizeof(*frame));
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < LINESIZE * HEIGHT; ++j) {
+            // the padding must not be copied
+            planes[i][j] = j % LINESIZE < width ? value + i : 0xFF;
+        }
+        frame->data[i] = planes[i];
+        frame->linesize[i] = LINESIZE;
+    }
+}
+
+static const struct frame_sink_header *map_reader(const char *name,
+                                                  size_t *size) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    assert(fd != -1);
+    struct stat st;
+    int r = fstat(fd, &st);
+    assert(!r);
+    *size = st.st_size;
+    void *mem = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+    assert(mem != MAP_FAILED);
+    close(fd);
+    return mem;
+}
+
+static void test_publish(void) {
+    char name[64];
+    sprintf(name, "/scrcpy_test_frame_sink_%d", (int) getpid());
+
+    struct frame_sink sink;
+    SDL_bool ok = frame_sink_init(&sink, name + 1, (struct size) {HEIGHT, WIDTH});
+    assert(ok);
+    assert(!strcmp(sink.name, name));
+
+    size_t size;
+    const struct frame_sink_header *header = map_reader(name, &size);
+    assert(header->magic == FRAME_SINK_MAGIC);
+    assert(header->version == FRAME_SINK_VERSION);
+    assert(header->slot_count == FRAME_SINK_SLOTS);
+    // the chroma planes are rounded up: 6x5 + 2 * 3x3
+    assert(header->slot_capacity >= 48);
+    assert(SDL_AtomicGet((SDL_atomic_t *) &header->sequence) == 0);
+
+    AVFrame frame;
+    for (int n = 1; n <= 4; ++n) {
+        // the frame is rotated compared to the initial frame size
+        fill_frame(&frame, n * 10, WIDTH, HEIGHT);
+        frame_sink_publish(&sink, &frame);
+
+        int sequence = SDL_AtomicGet((SDL_atomic_t *) &header->sequence);
+        assert(sequence == n);
+        const struct frame_sink_slot *slot =
+                &header->slots[sequence % FRAME_SINK_SLOTS];
+        assert(SDL_AtomicGet((SDL_atomic_t *) &slot->sequence) == n);
+        assert(slot->width == WIDTH);
+        assert(slot->height == HEIGHT);
+        assert(slot->format == FRAME_SINK_FORMAT_YUV420P);
+        assert(slot->size == 48);
+        assert(slot->offset + slot->size <= size);
+
+        const Uint8 *pixels = (const Uint8 *) header + slot->offset;
+        for (int i = 0; i < 30; ++i) {
+            assert(pixels[i] == n * 10);
+        }
+        for (int i = 30; i < 39; ++i) {
+            assert(pixels[i] == n * 10 + 1);
+        }
+        for (int i = 39; i < 48; ++i) {
+            assert(pixels[i] == n * 10 + 2);
+        }
+    }
+
+    // a larger frame is not published
+    fill_frame(&frame, 99, LINESIZE, HEIGHT);
+    frame_sink_publish(&sink, &frame);
+    assert(SDL_AtomicGet((SDL_atomic_t *) &header->sequence) == 4);
+
+    frame_sink_destroy(&sink);
+    // unlinked, but still mapped by the reader
+    assert(shm_open(name, O_RDONLY, 0) == -1);
+    assert(header->magic == FRAME_SINK_MAGIC);
+    munmap((void *) header, size);
+}
+
+static void test_invalid_name(void) {
+    struct frame_sink sink;
+    assert(!frame_sink_init(&sink, "", (struct size) {WIDTH, HEIGHT}));
+    assert(!frame_sink_init(&sink, "/", (struct size) {WIDTH, HEIGHT}));
+    assert(!frame_sink_init(&sink, "a/b", (struct size) {WIDTH, HEIGHT}));
+}
+
+int main(void) {
+    test_publish();
+    test_invalid_name();
+    return 0;
+}
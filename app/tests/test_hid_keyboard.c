@@ -0,0 +1,132 @@
+#include <assert.h>
+#include <string.h>
+
+#include "hid_keyboard.h"
+
+#define KEY_A 0x04
+#define KEY_B 0x05
+#define KEY_C 0x06
+#define MOD_LSHIFT 0x02
+
+static void test_press_release(void) {
+    struct hid_keyboard kb;
+    hid_keyboard_init(&kb);
+
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    assert(!hid_keyboard_take_report(&kb, report));
+
+    assert(!hid_keyboard_press(&kb, KEY_A, 0, report));
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char pressed[] = {0x01, 0x00, 0x00, KEY_A, 0, 0, 0, 0, 0};
+    assert(!memcmp(report, pressed, sizeof(pressed)));
+
+    // nothing changed
+    assert(!hid_keyboard_take_report(&kb, report));
+
+    assert(!hid_keyboard_release(&kb, KEY_A, report));
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char released[] = {0x01, 0x00, 0x00, 0, 0, 0, 0, 0, 0};
+    assert(!memcmp(report, released, sizeof(released)));
+}
+
+static void test_merge_changes(void) {
+    struct hid_keyboard kb;
+    hid_keyboard_init(&kb);
+
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    assert(!hid_keyboard_press(&kb, KEY_A, 0, report));
+    assert(hid_keyboard_take_report(&kb, report));
+
+    // independent changes are merged into a single report
+    assert(!hid_keyboard_release(&kb, KEY_A, report));
+    assert(!hid_keyboard_press(&kb, KEY_B, 0, report));
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char expected[] = {0x01, 0x00, 0x00, KEY_B, 0, 0, 0, 0, 0};
+    assert(!memcmp(report, expected, sizeof(expected)));
+}
+
+static void test_no_merge_press_release(void) {
+    struct hid_keyboard kb;
+    hid_keyboard_init(&kb);
+
+    unsigned char flushed[HID_KEYBOARD_REPORT_SIZE];
+    assert(!hid_keyboard_press(&kb, KEY_A, 0, flushed));
+
+    // the press must be reported before the release
+    assert(hid_keyboard_release(&kb, KEY_A, flushed));
+    const unsigned char pressed[] = {0x01, 0x00, 0x00, KEY_A, 0, 0, 0, 0, 0};
+    assert(!memcmp(flushed, pressed, sizeof(pressed)));
+
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char released[] = {0x01, 0x00, 0x00, 0, 0, 0, 0, 0, 0};
+    assert(!memcmp(report, released, sizeof(released)));
+}
+
+static void test_no_merge_modifiers(void) {
+    struct hid_keyboard kb;
+    hid_keyboard_init(&kb);
+
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    assert(!hid_keyboard_press(&kb, KEY_A, MOD_LSHIFT, report));
+    assert(hid_keyboard_take_report(&kb, report));
+
+    // the modifiers change once, it can be merged
+    assert(!hid_keyboard_press(&kb, KEY_B, 0, report));
+
+    // the modifiers change again, the pending state must be reported first
+    assert(hid_keyboard_press(&kb, KEY_C, MOD_LSHIFT, report));
+    const unsigned char a_b[] = {0x01, 0x00, 0x00, KEY_A, KEY_B, 0, 0, 0, 0};
+    assert(!memcmp(report, a_b, sizeof(a_b)));
+
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char a_b_c[] = {0x01, MOD_LSHIFT, 0x00, KEY_A, KEY_B, KEY_C, 0, 0, 0};
+    assert(!memcmp(report, a_b_c, sizeof(a_b_c)));
+}
+
+static void test_chord(void) {
+    struct hid_keyboard kb;
+    hid_keyboard_init(&kb);
+
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    assert(!hid_keyboard_press(&kb, KEY_A, 0, report));
+    assert(!hid_keyboard_press(&kb, KEY_B, 0, report));
+    // already pressed
+    assert(!hid_keyboard_press(&kb, KEY_A, 0, report));
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char both[] = {0x01, 0x00, 0x00, KEY_A, KEY_B, 0, 0, 0, 0};
+    assert(!memcmp(report, both, sizeof(both)));
+
+    assert(!hid_keyboard_release(&kb, KEY_A, report));
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char b[] = {0x01, 0x00, 0x00, KEY_B, 0, 0, 0, 0, 0};
+    assert(!memcmp(report, b, sizeof(b)));
+}
+
+static void test_roll_over(void) {
+    struct hid_keyboard kb;
+    hid_keyboard_init(&kb);
+
+    unsigned char report[HID_KEYBOARD_REPORT_SIZE];
+    for (int i = 0; i < HID_KEYBOARD_KEYS + 1; ++i) {
+        assert(!hid_keyboard_press(&kb, KEY_A + i, 0, report));
+    }
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char roll_over[] = {0x01, 0x00, 0x00, 1, 1, 1, 1, 1, 1};
+    assert(!memcmp(report, roll_over, sizeof(roll_over)));
+
+    assert(!hid_keyboard_release(&kb, KEY_A, report));
+    assert(hid_keyboard_take_report(&kb, report));
+    const unsigned char six[] = {0x01, 0x00, 0x00, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a};
+    assert(!memcmp(report, six, sizeof(six)));
+}
+
+int main(void) {
+    test_press_release();
+    test_merge_changes();
+    test_no_merge_press_release();
+    test_no_merge_modifiers();
+    test_chord();
+    test_roll_over();
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include <assert.h>
+#include <string.h>
+
+#include "hid_pointer.h"
+
+static void test_report(void) {
+    struct position position = {
+        .screen_size = {
+            .width = 1081,
+            .height = 1921,
+        },
+        .point = {
+            .x = 540,
+            .y = 1920,
+        },
+    };
+
+    unsigned char report[HID_POINTER_REPORT_SIZE];
+    hid_pointer_write_report(report, SDL_TRUE, position);
+
+    const unsigned char expected[] = {
+        0x03, // tip switch | in range
+        0xff, 0x3f, // 16383 (center)
+        0xff, 0x7f, // 32767 (bottom)
+    };
+    assert(!memcmp(report, expected, sizeof(expected)));
+}
+
+static void test_report_up(void) {
+    struct position position = {
+        .screen_size = {
+            .width = 1080,
+            .height = 1920,
+        },
+        .point = {
+            .x = 0,
+            .y = 5000, // out of range
+        },
+    };
+
+    unsigned char report[HID_POINTER_REPORT_SIZE];
+    hid_pointer_write_report(report, SDL_FALSE, position);
+
+    const unsigned char expected[] = {
+        0x02, // in range
+        0x00, 0x00, // 0
+        0xff, 0x7f, // clamped to 32767
+    };
+    assert(!memcmp(report, expected, sizeof(expected)));
+}
+
+int main(void) {
+    test_report();
+    test_report_up();
+    return 0;
+}
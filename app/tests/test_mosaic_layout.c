@@ -0,0 +1,65 @@
+#include <assert.h>
+
+#include "mosaic_layout.h"
+
+static void test_grid(void) {
+    unsigned columns;
+    unsigned rows;
+
+    mosaic_layout_get_grid(1, &columns, &rows);
+    assert(columns == 1 && rows == 1);
+
+    mosaic_layout_get_grid(2, &columns, &rows);
+    assert(columns == 2 && rows == 1);
+
+    mosaic_layout_get_grid(4, &columns, &rows);
+    assert(columns == 2 && rows == 2);
+
+    mosaic_layout_get_grid(5, &columns, &rows);
+    assert(columns == 3 && rows == 2);
+
+    mosaic_layout_get_grid(16, &columns, &rows);
+    assert(columns == 4 && rows == 4);
+}
+
+static void test_tile_rect(void) {
+    // 3 tiles in a 2x2 grid of 400x600 cells
+    struct size output = {800, 1200};
+
+    // portrait frame (1:2), black borders on left and right
+    struct size portrait = {540, 1080};
+    SDL_Rect rect = mosaic_layout_get_tile_rect(3, 1, output, portrait);
+    assert(rect.w == 300 && rect.h == 600);
+    assert(rect.x == 400 + 50 && rect.y == 0);
+
+    // landscape frame (2:1), black borders on top and bottom
+    struct size landscape = {1080, 540};
+    rect = mosaic_layout_get_tile_rect(3, 2, output, landscape);
+    assert(rect.w == 400 && rect.h == 200);
+    assert(rect.x == 0 && rect.y == 600 + 200);
+
+    // no frame yet
+    struct size none = {0, 0};
+    rect = mosaic_layout_get_tile_rect(3, 0, output, none);
+    assert(rect.x == 0 && rect.y == 0 && rect.w == 400 && rect.h == 600);
+}
+
+static void test_cell_index(void) {
+    struct size output = {800, 1200};
+    assert(mosaic_layout_get_cell_index(3, output, 0, 0) == 0);
+    assert(mosaic_layout_get_cell_index(3, output, 399, 599) == 0);
+    assert(mosaic_layout_get_cell_index(3, output, 400, 0) == 1);
+    assert(mosaic_layout_get_cell_index(3, output, 10, 600) == 2);
+    // the last cell is empty
+    assert(mosaic_layout_get_cell_index(3, output, 500, 700) == -1);
+    // outside
+    assert(mosaic_layout_get_cell_index(3, output, -1, 0) == -1);
+    assert(mosaic_layout_get_cell_index(3, output, 800, 0) == -1);
+}
+
+int main(void) {
+    test_grid();
+    test_tile_rect();
+    test_cell_index();
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <assert.h>
+#include <string.h>
+
+#include "recv_buffer.h"
+
+#define IPV4_LOCALHOST 0x7F000001
+#define TEST_PORT 27197
+
+// connect a pair of sockets over loopback
+static void connect_pair(socket_t *reader, socket_t *writer) {
+    socket_t server_socket = net_listen(IPV4_LOCALHOST, TEST_PORT, 1, NULL);
+    assert(server_socket != INVALID_SOCKET);
+    *writer = net_connect(IPV4_LOCALHOST, TEST_PORT, NULL);
+    assert(*writer != INVALID_SOCKET);
+    *reader = net_accept(server_socket, NULL);
+    assert(*reader != INVALID_SOCKET);
+    net_close(server_socket);
+}
+
+static void test_small_reads(void) {
+    socket_t reader, writer;
+    connect_pair(&reader, &writer);
+
+    struct recv_buffer rb;
+    SDL_bool ok = recv_buffer_init(&rb, reader, 16);
+    assert(ok);
+
+    const char *data = "0123456789abcdefghijklmnopqrstuvwxyz";
+    size_t len = strlen(data);
+    ssize_t w = net_send_all(writer, data, len);
+    assert(w != -1);
+    net_shutdown(writer, SHUT_WR);
+
+    // reads of 5 bytes do not match the buffer capacity (16), so some of
+    // them span two refills
+    char buf[64];
+    size_t total = 0;
+    ssize_t r;
+    while ((r = recv_buffer_read_all(&rb, &buf[total], 5)) == 5) {
+        total += r;
+    }
+    assert(r >= 0);
+    total += r;
+    assert(total == len);
+    assert(!memcmp(buf, data, len));
+
+    // EOF
+    r = recv_buffer_read(&rb, buf, 1);
+    assert(r == 0);
+
+    recv_buffer_destroy(&rb);
+    net_close(reader);
+    net_close(writer);
+}
+
+static void test_large_read(void) {
+    socket_t reader, writer;
+    connect_pair(&reader, &writer);
+
+    struct recv_buffer rb;
+    SDL_bool ok = recv_buffer_init(&rb, reader, 4);
+    assert(ok);
+
+    ssize_t w = net_send_all(writer, "abcdefghij", 10);
+    assert(w != -1);
+    net_shutdown(writer, SHUT_WR);
+
+    char buf[16];
+    ssize_t r = recv_buffer_read(&rb, buf, 2);
+    assert(r == 2);
+    assert(!memcmp(buf, "ab", 2));
+
+    // only the buffered bytes are returned, without blocking
+    r = recv_buffer_read(&rb, buf, sizeof(buf));
+    assert(r == 2);
+    assert(!memcmp(buf, "cd", 2));
+
+    // the buffer is empty, a large read bypasses it
+    r = recv_buffer_read_all(&rb, buf, 6);
+    assert(r == 6);
+    assert(!memcmp(buf, "efghij", 6));
+
+    recv_buffer_destroy(&rb);
+    net_close(reader);
+    net_close(writer);
+}
+
+int main(void) {
+    assert(net_init());
+    test_small_reads();
+    test_large_read();
+    net_cleanup();
+    return 0;
+}
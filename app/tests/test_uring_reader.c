@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <SDL2/SDL_thread.h>
+
+#include "common.h"
+#include "uring_reader.h"
+
+#define DATA_SIZE (1 << 20) // larger than all the chunks of a stream
+
+static Uint8 byte_at(int stream, size_t i) {
+    return (Uint8) (i * 7 + stream);
+}
+
+struct writer {
+    int stream;
+    socket_t socket;
+};
+
+static int run_writer(void *data) {
+    struct writer *writer = data;
+    static Uint8 buf[2][DATA_SIZE];
+    Uint8 *b = buf[writer->stream];
+    for (size_t i = 0; i < DATA_SIZE; ++i) {
+        b[i] = byte_at(writer->stream, i);
+    }
+    // odd sizes, so that the chunks are not aligned
+    size_t sent = 0;
+    while (sent < DATA_SIZE) {
+        size_t len = MIN(DATA_SIZE - sent, 10007);
+        ssize_t w = net_send_all(writer->socket, &b[sent], len);
+        assert(w != -1);
+        sent += len;
+    }
+    net_shutdown(writer->socket, SHUT_WR);
+    return 0;
+}
+
+static void test_streams(void) {
+    struct uring_reader reader;
+    if (!uring_reader_init(&reader, 2)) {
+        // io_uring may be disabled (e.g. by seccomp in containers)
+        fprintf(stderr, "io_uring not available, skipped\n");
+        return;
+    }
+    SDL_bool ok = uring_reader_start(&reader);
+    assert(ok);
+
+    socket_t sockets[2][2];
+    struct uring_stream streams[2];
+    struct writer writers[2];
+    SDL_Thread *threads[2];
+    for (int i = 0; i < 2; ++i) {
+        int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets[i]);
+        assert(!ret);
+        ok = uring_stream_init(&streams[i], &reader, sockets[i][0]);
+        assert(ok);
+        writers[i].stream = i;
+        writers[i].socket = sockets[i][1];
+        threads[i] = SDL_CreateThread(run_writer, "writer", &writers[i]);
+        assert(threads[i]);
+    }
+
+    // consume the streams alternately, with small reads
+    size_t received[2] = {0, 0};
+    SDL_bool eof[2] = {SDL_FALSE, SDL_FALSE};
+    while (!eof[0] || !eof[1]) {
+        for (int i = 0; i < 2; ++i) {
+            if (eof[i]) {
+                continue;
+            }
+            Uint8 buf[1000];
+            ssize_t r = uring_stream_read(&streams[i], buf, sizeof(buf));
+            assert(r >= 0);
+            if (!r) {
+                eof[i] = SDL_TRUE;
+                continue;
+            }
+            for (ssize_t j = 0; j < r; ++j) {
+                assert(buf[j] == byte_at(i, received[i] + j));
+            }
+            received[i] += r;
+        }
+    }
+    assert(received[0] == DATA_SIZE);
+    assert(received[1] == DATA_SIZE);
+
+    for (int i = 0; i < 2; ++i) {
+        SDL_WaitThread(threads[i], NULL);
+        uring_stream_destroy(&streams[i]);
+        net_close(sockets[i][0]);
+        net_close(sockets[i][1]);
+    }
+
+    uring_reader_stop(&reader);
+    uring_reader_join(&reader);
+    uring_reader_destroy(&reader);
+}
+
+static void test_destroy_pending(void) {
+    struct uring_reader reader;
+    if (!uring_reader_init(&reader, 1)) {
+        return;
+    }
+    SDL_bool ok = uring_reader_start(&reader);
+    assert(ok);
+
+    socket_t sockets[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+    assert(!ret);
+
+    struct uring_stream stream;
+    ok = uring_stream_init(&stream, &reader, sockets[0]);
+    assert(ok);
+
+    // nothing is sent, the read is pending: it must not block
+    uring_stream_destroy(&stream);
+    net_close(sockets[0]);
+    net_close(sockets[1]);
+
+    uring_reader_stop(&reader);
+    uring_reader_join(&reader);
+    uring_reader_destroy(&reader);
+}
+
+int main(void) {
+    test_streams();
+    test_destroy_pending();
+    return 0;
+}
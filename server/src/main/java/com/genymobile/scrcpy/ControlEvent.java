@@ -2,6 +2,9 @@ package com.genymobile.scrcpy;
 
 /**
  * Union of all supported event types, identified by their {@code type}.
+ * <p>
+ * To avoid allocations on the control path, {@link ControlEventReader} reuses a single instance, updated in place by the {@code set*()}
+ * methods: an event is only valid until the next one is read.
  */
 public final class ControlEvent {
 
@@ -10,13 +13,16 @@ public final class ControlEvent {
     public static final int TYPE_MOUSE = 2;
     public static final int TYPE_SCROLL = 3;
     public static final int TYPE_COMMAND = 4;
+    public static final int TYPE_SWIPE = 5;
+    public static final int TYPE_TOUCH = 6;
+    public static final int TYPE_SET_CLIPBOARD = 7;
 
     public static final int COMMAND_BACK_OR_SCREEN_ON = 0;
     public static final int SUSPEND_ENCODER = 1;
     public static final int RESUME_ENCODER = 2;
 
     private int type;
-    private String text;
+    private CharSequence text;
     private int metaState; // KeyEvent.META_*
     private int action; // KeyEvent.ACTION_* or MotionEvent.ACTION_* or COMMAND_*
     private int keycode; // KeyEvent.KEYCODE_*
@@ -24,59 +30,136 @@ public final class ControlEvent {
     private Position position;
     private int hScroll;
     private int vScroll;
+    private long pointerId;
+    private float pressure;
+    private Position[] positions; // swipe points
+    private int delay; // between swipe points, in milliseconds
+    private boolean paste; // inject PASTE after setting the clipboard
 
-    private ControlEvent() {
+    ControlEvent() {
     }
 
     public static ControlEvent createKeycodeControlEvent(int action, int keycode, int metaState) {
         ControlEvent event = new ControlEvent();
-        event.type = TYPE_KEYCODE;
-        event.action = action;
-        event.keycode = keycode;
-        event.metaState = metaState;
+        event.setKeycode(action, keycode, metaState);
         return event;
     }
 
-    public static ControlEvent createTextControlEvent(String text) {
+    public static ControlEvent createTextControlEvent(CharSequence text) {
         ControlEvent event = new ControlEvent();
-        event.type = TYPE_TEXT;
-        event.text = text;
+        event.setText(text);
+        return event;
+    }
+
+    public static ControlEvent createSetClipboardControlEvent(CharSequence text, boolean paste) {
+        ControlEvent event = new ControlEvent();
+        event.setSetClipboard(text, paste);
         return event;
     }
 
     public static ControlEvent createMotionControlEvent(int action, int buttons, Position position) {
         ControlEvent event = new ControlEvent();
-        event.type = TYPE_MOUSE;
-        event.action = action;
-        event.buttons = buttons;
-        event.position = position;
+        event.setMotion(action, buttons, position);
+        return event;
+    }
+
+    public static ControlEvent createTouchControlEvent(int action, long pointerId, Position position, float pressure) {
+        ControlEvent event = new ControlEvent();
+        event.setTouch(action, pointerId, position, pressure);
         return event;
     }
 
     public static ControlEvent createScrollControlEvent(Position position, int hScroll, int vScroll) {
         ControlEvent event = new ControlEvent();
-        event.type = TYPE_SCROLL;
-        event.position = position;
-        event.hScroll = hScroll;
-        event.vScroll = vScroll;
+        event.setScroll(position, hScroll, vScroll);
         return event;
     }
 
     public static ControlEvent createCommandControlEvent(int action) {
         ControlEvent event = new ControlEvent();
-        event.type = TYPE_COMMAND;
-        event.action = action;
+        event.setCommand(action);
+        return event;
+    }
+
+    public static ControlEvent createSwipeControlEvent(Position[] positions, int delay) {
+        ControlEvent event = new ControlEvent();
+        event.setSwipe(positions, delay);
         return event;
     }
 
+    void setKeycode(int action, int keycode, int metaState) {
+        this.type = TYPE_KEYCODE;
+        this.action = action;
+        this.keycode = keycode;
+        this.metaState = metaState;
+    }
+
+    void setText(CharSequence text) {
+        this.type = TYPE_TEXT;
+        this.text = text;
+    }
+
+    void setSetClipboard(CharSequence text, boolean paste) {
+        this.type = TYPE_SET_CLIPBOARD;
+        this.text = text;
+        this.paste = paste;
+    }
+
+    void setMotion(int action, int buttons, Position position) {
+        this.type = TYPE_MOUSE;
+        this.action = action;
+        this.buttons = buttons;
+        this.position = position;
+    }
+
+    void setTouch(int action, long pointerId, Position position, float pressure) {
+        this.type = TYPE_TOUCH;
+        this.action = action;
+        this.pointerId = pointerId;
+        this.position = position;
+        this.pressure = pressure;
+    }
+
+    void setScroll(Position position, int hScroll, int vScroll) {
+        this.type = TYPE_SCROLL;
+        this.position = position;
+        this.hScroll = hScroll;
+        this.vScroll = vScroll;
+    }
+
+    void setCommand(int action) {
+        this.type = TYPE_COMMAND;
+        this.action = action;
+    }
+
+    void setSwipe(Position[] positions, int delay) {
+        this.type = TYPE_SWIPE;
+        this.positions = positions;
+        this.delay = delay;
+    }
+
     public int getType() {
         return type;
     }
 
+    /**
+     * Return a copy of the text (this allocates, use {@link #getTextChars()} on the control path).
+     */
     public String getText() {
+        return text.toString();
+    }
+
+    /**
+     * Return the text without copy, only valid until the next event is read.
+     */
+    public CharSequence getTextChars() {
         return text;
     }
 
+    public boolean getPaste() {
+        return paste;
+    }
+
     public int getMetaState() {
         return metaState;
     }
@@ -104,4 +187,20 @@ public final class ControlEvent {
     public int getVScroll() {
         return vScroll;
     }
+
+    public long getPointerId() {
+        return pointerId;
+    }
+
+    public float getPressure() {
+        return pressure;
+    }
+
+    public Position[] getPositions() {
+        return positions;
+    }
+
+    public int getDelay() {
+        return delay;
+    }
 }
@@ -1,9 +1,14 @@
 package com.genymobile.scrcpy;
 
+import android.graphics.Point;
+
 import java.io.EOFException;
 import java.io.IOException;
 import java.io.InputStream;
 import java.nio.ByteBuffer;
+import java.nio.CharBuffer;
+import java.nio.charset.CharsetDecoder;
+import java.nio.charset.CodingErrorAction;
 import java.nio.charset.StandardCharsets;
 
 public class ControlEventReader {
@@ -12,13 +17,28 @@ public class ControlEventReader {
     private static final int MOUSE_PAYLOAD_LENGTH = 13;
     private static final int SCROLL_PAYLOAD_LENGTH = 16;
     private static final int COMMAND_PAYLOAD_LENGTH = 1;
+    private static final int TOUCH_PAYLOAD_LENGTH = 12;
+    private static final int SWIPE_HEADER_LENGTH = 7;
+    private static final int SWIPE_POINT_LENGTH = 4;
+    private static final int SET_CLIPBOARD_HEADER_LENGTH = 5;
 
     public static final int TEXT_MAX_LENGTH = 300;
-    private static final int RAW_BUFFER_SIZE = 1024;
+    // must be able to contain a whole clipboard event
+    private static final int RAW_BUFFER_SIZE = 1 << 18;
+    public static final int CLIPBOARD_TEXT_MAX_LENGTH = RAW_BUFFER_SIZE - 1 - SET_CLIPBOARD_HEADER_LENGTH;
 
     private final byte[] rawBuffer = new byte[RAW_BUFFER_SIZE];
     private final ByteBuffer buffer = ByteBuffer.wrap(rawBuffer);
-    private final byte[] textBuffer = new byte[TEXT_MAX_LENGTH];
+
+    // reused for every event, so that parsing does not allocate
+    private final ControlEvent event = new ControlEvent();
+    // a UTF-8 sequence never decodes to more chars than bytes
+    private final CharBuffer textBuffer = CharBuffer.allocate(TEXT_MAX_LENGTH);
+    private final CharsetDecoder textDecoder = StandardCharsets.UTF_8.newDecoder()
+            .onMalformedInput(CodingErrorAction.REPLACE)
+            .onUnmappableCharacter(CodingErrorAction.REPLACE);
+    private Position position; // created on first use
+    private Size screenSize; // only replaced when the client screen size changes
 
     public ControlEventReader() {
         // invariant: the buffer is always in "get" mode
@@ -67,6 +87,15 @@ public class ControlEventReader {
             case ControlEvent.TYPE_COMMAND:
                 controlEvent = parseCommandControlEvent();
                 break;
+            case ControlEvent.TYPE_SWIPE:
+                controlEvent = parseSwipeControlEvent();
+                break;
+            case ControlEvent.TYPE_TOUCH:
+                controlEvent = parseTouchControlEvent();
+                break;
+            case ControlEvent.TYPE_SET_CLIPBOARD:
+                controlEvent = parseSetClipboardControlEvent();
+                break;
             default:
                 Ln.w("Unknown event type: " + type);
                 controlEvent = null;
@@ -87,7 +116,8 @@ public class ControlEventReader {
         int action = toUnsigned(buffer.get());
         int keycode = buffer.getInt();
         int metaState = buffer.getInt();
-        return ControlEvent.createKeycodeControlEvent(action, keycode, metaState);
+        event.setKeycode(action, keycode, metaState);
+        return event;
     }
 
     private ControlEvent parseTextControlEvent() {
@@ -98,9 +128,37 @@ public class ControlEventReader {
         if (buffer.remaining() < len) {
             return null;
         }
-        buffer.get(textBuffer, 0, len);
-        String text = new String(textBuffer, 0, len, StandardCharsets.UTF_8);
-        return ControlEvent.createTextControlEvent(text);
+        int limit = buffer.limit();
+        int end = buffer.position() + len;
+        buffer.limit(end);
+        textBuffer.clear();
+        textDecoder.reset();
+        textDecoder.decode(buffer, textBuffer, true);
+        textDecoder.flush(textBuffer);
+        textBuffer.flip();
+        buffer.limit(limit);
+        buffer.position(end);
+        event.setText(textBuffer);
+        return event;
+    }
+
+    private ControlEvent parseSetClipboardControlEvent() {
+        if (buffer.remaining() < SET_CLIPBOARD_HEADER_LENGTH) {
+            return null;
+        }
+        boolean paste = buffer.get() != 0;
+        int len = buffer.getInt();
+        if (len < 0 || len > CLIPBOARD_TEXT_MAX_LENGTH) {
+            throw new IllegalStateException("Invalid clipboard text length: " + len);
+        }
+        if (buffer.remaining() < len) {
+            return null;
+        }
+        // setting the clipboard is rare, and ClipData keeps its own copy anyway
+        String text = new String(rawBuffer, buffer.position(), len, StandardCharsets.UTF_8);
+        buffer.position(buffer.position() + len);
+        event.setSetClipboard(text, paste);
+        return event;
     }
 
     private ControlEvent parseMouseControlEvent() {
@@ -109,18 +167,33 @@ public class ControlEventReader {
         }
         int action = toUnsigned(buffer.get());
         int buttons = buffer.getInt();
-        Position position = readPosition(buffer);
-        return ControlEvent.createMotionControlEvent(action, buttons, position);
+        event.setMotion(action, buttons, readPosition());
+        return event;
+    }
+
+    @SuppressWarnings("checkstyle:MagicNumber")
+    private ControlEvent parseTouchControlEvent() {
+        if (buffer.remaining() < TOUCH_PAYLOAD_LENGTH) {
+            return null;
+        }
+        int action = toUnsigned(buffer.get());
+        int pointerId = toUnsigned(buffer.get());
+        Position touchPosition = readPosition();
+        // 16 bits fixed-point
+        float pressure = toUnsigned(buffer.getShort()) / (float) 0xffff;
+        event.setTouch(action, pointerId, touchPosition, pressure);
+        return event;
     }
 
     private ControlEvent parseScrollControlEvent() {
         if (buffer.remaining() < SCROLL_PAYLOAD_LENGTH) {
             return null;
         }
-        Position position = readPosition(buffer);
+        Position scrollPosition = readPosition();
         int hScroll = buffer.getInt();
         int vScroll = buffer.getInt();
-        return ControlEvent.createScrollControlEvent(position, hScroll, vScroll);
+        event.setScroll(scrollPosition, hScroll, vScroll);
+        return event;
     }
 
     private ControlEvent parseCommandControlEvent() {
@@ -128,15 +201,52 @@ public class ControlEventReader {
             return null;
         }
         int action = toUnsigned(buffer.get());
-        return ControlEvent.createCommandControlEvent(action);
+        event.setCommand(action);
+        return event;
+    }
+
+    private ControlEvent parseSwipeControlEvent() {
+        if (buffer.remaining() < SWIPE_HEADER_LENGTH) {
+            return null;
+        }
+        int delay = toUnsigned(buffer.getShort());
+        int screenWidth = toUnsigned(buffer.getShort());
+        int screenHeight = toUnsigned(buffer.getShort());
+        int count = toUnsigned(buffer.get());
+        if (buffer.remaining() < count * SWIPE_POINT_LENGTH) {
+            return null;
+        }
+        // a swipe is rare and replayed asynchronously, so its points are not reused
+        Size swipeScreenSize = getScreenSize(screenWidth, screenHeight);
+        Position[] positions = new Position[count];
+        for (int i = 0; i < count; ++i) {
+            int x = toUnsigned(buffer.getShort());
+            int y = toUnsigned(buffer.getShort());
+            positions[i] = new Position(new Point(x, y), swipeScreenSize);
+        }
+        event.setSwipe(positions, delay);
+        return event;
     }
 
-    private static Position readPosition(ByteBuffer buffer) {
+    private Size getScreenSize(int width, int height) {
+        if (screenSize == null || screenSize.getWidth() != width || screenSize.getHeight() != height) {
+            screenSize = new Size(width, height);
+        }
+        return screenSize;
+    }
+
+    private Position readPosition() {
         int x = toUnsigned(buffer.getShort());
         int y = toUnsigned(buffer.getShort());
         int screenWidth = toUnsigned(buffer.getShort());
         int screenHeight = toUnsigned(buffer.getShort());
-        return new Position(x, y, screenWidth, screenHeight);
+        Size size = getScreenSize(screenWidth, screenHeight);
+        if (position == null) {
+            position = new Position(new Point(x, y), size);
+        } else {
+            position.set(x, y, size);
+        }
+        return position;
     }
 
     @SuppressWarnings("checkstyle:MagicNumber")
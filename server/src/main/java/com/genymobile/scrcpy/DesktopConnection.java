@@ -3,29 +3,62 @@ package com.genymobile.scrcpy;
 import android.net.LocalServerSocket;
 import android.net.LocalSocket;
 import android.net.LocalSocketAddress;
+import android.os.ParcelFileDescriptor;
 
 import java.io.Closeable;
+import java.io.DataInputStream;
 import java.io.FileDescriptor;
 import java.io.IOException;
 import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.ServerSocket;
+import java.net.Socket;
 import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
 
+/**
+ * The connection to the client: the video stream and the control (events from the client, messages to the client) use separate sockets, so
+ * that a stalled video stream does not delay the control.
+ */
 public final class DesktopConnection implements Closeable {
 
     private static final int DEVICE_NAME_FIELD_LENGTH = 64;
 
     private static final String SOCKET_NAME = "scrcpy";
 
-    private final LocalSocket socket;
-    private final InputStream inputStream;
-    private final FileDescriptor fd;
+    private static final int DIRECT_TOKEN_TIMEOUT_MS = 5000;
+    private static final int DIRECT_VIDEO_SEND_BUFFER_SIZE = 1 << 20;
+
+    // a LocalSocket or a (direct TCP) Socket
+    private final Closeable videoSocket;
+    private final FileDescriptor videoFd;
+    // owns videoFd for a TCP socket, null otherwise
+    private final ParcelFileDescriptor videoPfd;
+
+    private final Closeable controlSocket;
+    private final InputStream controlInputStream;
+    private final OutputStream controlOutputStream;
 
     private final ControlEventReader reader = new ControlEventReader();
+    private final DeviceMessageWriter writer = new DeviceMessageWriter();
+
+    private DesktopConnection(LocalSocket videoSocket, LocalSocket controlSocket) throws IOException {
+        this.videoSocket = videoSocket;
+        this.controlSocket = controlSocket;
+        videoFd = videoSocket.getFileDescriptor();
+        videoPfd = null;
+        controlInputStream = controlSocket.getInputStream();
+        controlOutputStream = controlSocket.getOutputStream();
+    }
 
-    private DesktopConnection(LocalSocket socket) throws IOException {
-        this.socket = socket;
-        inputStream = socket.getInputStream();
-        fd = socket.getFileDescriptor();
+    private DesktopConnection(Socket videoSocket, Socket controlSocket) throws IOException {
+        this.videoSocket = videoSocket;
+        this.controlSocket = controlSocket;
+        // the encoder writes to a raw file descriptor
+        videoPfd = ParcelFileDescriptor.fromSocket(videoSocket);
+        videoFd = videoPfd.getFileDescriptor();
+        controlInputStream = controlSocket.getInputStream();
+        controlOutputStream = controlSocket.getOutputStream();
     }
 
     private static LocalSocket connect(String abstractName) throws IOException {
@@ -34,34 +67,148 @@ public final class DesktopConnection implements Closeable {
         return localSocket;
     }
 
-    private static LocalSocket listenAndAccept(String abstractName) throws IOException {
-        LocalServerSocket localServerSocket = new LocalServerSocket(abstractName);
+    public static DesktopConnection open(Device device, boolean tunnelForward) throws IOException {
+        LocalSocket videoSocket;
+        LocalSocket controlSocket;
+        if (tunnelForward) {
+            LocalServerSocket localServerSocket = new LocalServerSocket(SOCKET_NAME);
+            try {
+                videoSocket = localServerSocket.accept();
+                try {
+                    // send one byte so the client may read() to detect a connection error
+                    videoSocket.getOutputStream().write(0);
+                    controlSocket = localServerSocket.accept();
+                } catch (IOException e) {
+                    videoSocket.close();
+                    throw e;
+                }
+            } finally {
+                localServerSocket.close();
+            }
+        } else {
+            videoSocket = connect(SOCKET_NAME);
+            try {
+                controlSocket = connect(SOCKET_NAME);
+            } catch (IOException e) {
+                videoSocket.close();
+                throw e;
+            }
+        }
+
+        return init(device, videoSocket, controlSocket);
+    }
+
+    /**
+     * Open the connection to the next client of a daemon (always through "adb forward").
+     */
+    public static DesktopConnection accept(Device device, LocalServerSocket serverSocket) throws IOException {
+        LocalSocket videoSocket = serverSocket.accept();
+        LocalSocket controlSocket;
         try {
-            return localServerSocket.accept();
+            // send one byte so the client may read() to detect a connection error
+            videoSocket.getOutputStream().write(0);
+            controlSocket = serverSocket.accept();
+        } catch (IOException e) {
+            videoSocket.close();
+            throw e;
+        }
+        return init(device, videoSocket, controlSocket);
+    }
+
+    /**
+     * Open the connection over TCP, without adb tunnel (typically over Wi-Fi).
+     *
+     * <p>Any host on the network may connect, so the client must first send the one-time token it passed on the server command line (over
+     * adb). Connections with an invalid token are rejected, the server keeps listening.</p>
+     */
+    public static DesktopConnection openDirect(Device device, int port, String token) throws IOException {
+        byte[] expectedToken = token.getBytes(StandardCharsets.US_ASCII);
+        Socket videoSocket;
+        Socket controlSocket;
+        ServerSocket serverSocket = new ServerSocket(port);
+        try {
+            Ln.i("Listening on TCP port " + port);
+            videoSocket = acceptDirect(serverSocket, expectedToken);
+            try {
+                // the video stream is large, let the kernel absorb the bursts (keyframes)
+                videoSocket.setSendBufferSize(DIRECT_VIDEO_SEND_BUFFER_SIZE);
+                controlSocket = acceptDirect(serverSocket, expectedToken);
+            } catch (IOException e) {
+                videoSocket.close();
+                throw e;
+            }
         } finally {
-            localServerSocket.close();
+            serverSocket.close();
+        }
+
+        DesktopConnection connection;
+        try {
+            connection = new DesktopConnection(videoSocket, controlSocket);
+        } catch (IOException e) {
+            videoSocket.close();
+            controlSocket.close();
+            throw e;
         }
+        return init(device, connection);
     }
 
-    public static DesktopConnection open(Device device, boolean tunnelForward) throws IOException {
-        LocalSocket socket;
-        if (tunnelForward) {
-            socket = listenAndAccept(SOCKET_NAME);
-            // send one byte so the client may read() to detect a connection error
-            socket.getOutputStream().write(0);
-        } else {
-            socket = connect(SOCKET_NAME);
+    private static Socket acceptDirect(ServerSocket serverSocket, byte[] expectedToken) throws IOException {
+        while (true) {
+            Socket socket = serverSocket.accept();
+            try {
+                socket.setSoTimeout(DIRECT_TOKEN_TIMEOUT_MS);
+                byte[] token = new byte[expectedToken.length];
+                new DataInputStream(socket.getInputStream()).readFully(token);
+                // constant-time comparison
+                if (MessageDigest.isEqual(expectedToken, token)) {
+                    socket.setSoTimeout(0);
+                    // the events and the small packets must not be delayed by Nagle's algorithm
+                    socket.setTcpNoDelay(true);
+                    // send one byte so the client may read() to detect an authentication failure
+                    socket.getOutputStream().write(0);
+                    return socket;
+                }
+                Ln.w("Connection rejected (invalid token) from " + socket.getInetAddress());
+            } catch (IOException e) {
+                Ln.w("Connection rejected from " + socket.getInetAddress() + ": " + e.getMessage());
+            }
+            socket.close();
         }
+    }
 
-        DesktopConnection connection = new DesktopConnection(socket);
-        Size videoSize = device.getScreenInfo().getVideoSize();
-        connection.send(Device.getDeviceName(), videoSize.getWidth(), videoSize.getHeight());
+    private static DesktopConnection init(Device device, LocalSocket videoSocket, LocalSocket controlSocket) throws IOException {
+        return init(device, new DesktopConnection(videoSocket, controlSocket));
+    }
+
+    private static DesktopConnection init(Device device, DesktopConnection connection) throws IOException {
+        try {
+            Size videoSize = device.getScreenInfo().getVideoSize();
+            connection.send(Device.getDeviceName(), videoSize.getWidth(), videoSize.getHeight());
+        } catch (IOException e) {
+            connection.close();
+            throw e;
+        }
         return connection;
     }
 
     public void close() throws IOException {
-        socket.shutdownInput();
-        socket.shutdownOutput();
+        shutdownAndClose(videoSocket);
+        if (videoPfd != null) {
+            videoPfd.close();
+        }
+        shutdownAndClose(controlSocket);
+    }
+
+    private static void shutdownAndClose(Closeable socket) throws IOException {
+        if (socket instanceof LocalSocket) {
+            LocalSocket localSocket = (LocalSocket) socket;
+            localSocket.shutdownInput();
+            localSocket.shutdownOutput();
+        } else {
+            Socket tcpSocket = (Socket) socket;
+            tcpSocket.shutdownInput();
+            tcpSocket.shutdownOutput();
+        }
         socket.close();
     }
 
@@ -78,19 +225,28 @@ public final class DesktopConnection implements Closeable {
         buffer[DEVICE_NAME_FIELD_LENGTH + 1] = (byte) width;
         buffer[DEVICE_NAME_FIELD_LENGTH + 2] = (byte) (height >> 8);
         buffer[DEVICE_NAME_FIELD_LENGTH + 3] = (byte) height;
-        IO.writeFully(fd, buffer, 0, buffer.length);
+        IO.writeFully(videoFd, buffer, 0, buffer.length);
     }
 
-    public FileDescriptor getFd() {
-        return fd;
+    public FileDescriptor getVideoFd() {
+        return videoFd;
     }
 
     public ControlEvent receiveControlEvent() throws IOException {
         ControlEvent event = reader.next();
         while (event == null) {
-            reader.readFrom(inputStream);
+            reader.readFrom(controlInputStream);
             event = reader.next();
         }
         return event;
     }
+
+    /**
+     * Send the device clipboard text to the client (may be called from any thread).
+     */
+    public void sendClipboardText(String text) throws IOException {
+        synchronized (writer) {
+            writer.writeClipboardText(text, controlOutputStream);
+        }
+    }
 }
@@ -2,6 +2,7 @@ package com.genymobile.scrcpy;
 
 import com.genymobile.scrcpy.wrappers.ServiceManager;
 
+import android.content.IOnPrimaryClipChangedListener;
 import android.graphics.Point;
 import android.graphics.Rect;
 import android.os.Build;
@@ -15,10 +16,19 @@ public final class Device {
         void onRotationChanged(int rotation);
     }
 
+    public interface ClipboardListener {
+        void onClipboardTextChanged(String text);
+    }
+
     private final ServiceManager serviceManager = new ServiceManager();
 
     private ScreenInfo screenInfo;
     private RotationListener rotationListener;
+    private ClipboardListener clipboardListener;
+    private boolean clipboardListenerRegistered;
+    // the last text set from the client, not to send it back (only once: the
+    // same text may be copied again on the device later)
+    private String clipboardTextFromClient;
 
     public Device(Options options) {
         screenInfo = computeScreenInfo(options.getCrop(), options.getMaxSize());
@@ -95,6 +105,18 @@ public final class Device {
     }
 
     public Point getPhysicalPoint(Position position) {
+        Point point = new Point();
+        return getPhysicalPoint(position, point) ? point : null;
+    }
+
+    /**
+     * Convert the position to device coordinates, without allocation.
+     *
+     * @param position the position received from the client
+     * @param result the point to store the physical coordinates into
+     * @return {@code false} if the position must be ignored (the video size changed)
+     */
+    public boolean getPhysicalPoint(Position position, Point result) {
         // it hides the field on purpose, to read it with a lock
         @SuppressWarnings("checkstyle:HiddenField")
         ScreenInfo screenInfo = getScreenInfo(); // read with synchronization
@@ -103,13 +125,14 @@ public final class Device {
         if (!videoSize.equals(clientVideoSize)) {
             // The client sends a click relative to a video with wrong dimensions,
             // the device may have been rotated since the event was generated, so ignore the event
-            return null;
+            return false;
         }
         Rect contentRect = screenInfo.getContentRect();
         Point point = position.getPoint();
         int scaledX = contentRect.left + point.x * contentRect.width() / videoSize.getWidth();
         int scaledY = contentRect.top + point.y * contentRect.height() / videoSize.getHeight();
-        return new Point(scaledX, scaledY);
+        result.set(scaledX, scaledY);
+        return true;
     }
 
     public static String getDeviceName() {
@@ -128,6 +151,62 @@ public final class Device {
         serviceManager.getWindowManager().registerRotationWatcher(rotationWatcher);
     }
 
+    public CharSequence getClipboardText() {
+        return serviceManager.getClipboardManager().getText();
+    }
+
+    public boolean setClipboardText(CharSequence text) {
+        synchronized (this) {
+            clipboardTextFromClient = text.toString();
+        }
+        boolean ok = serviceManager.getClipboardManager().setText(text);
+        if (!ok) {
+            synchronized (this) {
+                // there will be no change to ignore
+                clipboardTextFromClient = null;
+            }
+        }
+        return ok;
+    }
+
+    /**
+     * Set the listener notified of the device clipboard text changes, except the ones set by {@link #setClipboardText(CharSequence)}.
+     * <p>
+     * The listener may be replaced (or removed by passing {@code null}) between client sessions.
+     */
+    public void setClipboardListener(ClipboardListener listener) {
+        synchronized (this) {
+            clipboardListener = listener;
+            if (clipboardListenerRegistered) {
+                return;
+            }
+            clipboardListenerRegistered = true;
+        }
+        serviceManager.getClipboardManager().addPrimaryClipChangedListener(new IOnPrimaryClipChangedListener.Stub() {
+            @Override
+            public void dispatchPrimaryClipChanged() {
+                CharSequence text = getClipboardText();
+                if (text == null) {
+                    return;
+                }
+                String newText = text.toString();
+                ClipboardListener listenerToNotify;
+                synchronized (Device.this) {
+                    String expectedEcho = clipboardTextFromClient;
+                    clipboardTextFromClient = null;
+                    if (newText.equals(expectedEcho)) {
+                        // set by the client, do not send it back
+                        return;
+                    }
+                    listenerToNotify = clipboardListener;
+                }
+                if (listenerToNotify != null) {
+                    listenerToNotify.onClipboardTextChanged(newText);
+                }
+            }
+        });
+    }
+
     public synchronized void setRotationListener(RotationListener rotationListener) {
         this.rotationListener = rotationListener;
     }
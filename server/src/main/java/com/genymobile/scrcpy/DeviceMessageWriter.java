@@ -0,0 +1,30 @@
+package com.genymobile.scrcpy;
+
+import java.io.IOException;
+import java.io.OutputStream;
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Serialize the messages sent from the device to the client, on the control socket.
+ */
+public class DeviceMessageWriter {
+
+    public static final int TYPE_CLIPBOARD = 0;
+
+    // type (1 byte) + length (4 bytes)
+    private static final int HEADER_SIZE = 5;
+    private static final int CLIPBOARD_TEXT_MAX_LENGTH = (1 << 18) - 6; // same as the client to device limit
+
+    private final ByteBuffer headerBuffer = ByteBuffer.allocate(HEADER_SIZE);
+
+    public void writeClipboardText(String text, OutputStream output) throws IOException {
+        byte[] raw = text.getBytes(StandardCharsets.UTF_8);
+        int len = StringUtils.getUtf8TruncationIndex(raw, CLIPBOARD_TEXT_MAX_LENGTH);
+        headerBuffer.clear();
+        headerBuffer.put((byte) TYPE_CLIPBOARD);
+        headerBuffer.putInt(len);
+        output.write(headerBuffer.array(), 0, HEADER_SIZE);
+        output.write(raw, 0, len);
+    }
+}
@@ -11,6 +11,9 @@ import android.view.KeyEvent;
 import android.view.MotionEvent;
 
 import java.io.IOException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ThreadFactory;
 
 
 public class EventController {
@@ -21,23 +24,49 @@ public class EventController {
 
     private final KeyCharacterMap charMap = KeyCharacterMap.load(KeyCharacterMap.VIRTUAL_KEYBOARD);
 
+    // reused to avoid allocations on the control path
+    private final Point physicalPoint = new Point();
+    private final char[] singleChar = new char[1];
+
     private long lastMouseDown;
+    private long lastTouchDown;
+    private final PointersState pointersState = new PointersState();
+    private final MotionEvent.PointerProperties[] touchPointerProperties = new MotionEvent.PointerProperties[PointersState.MAX_POINTERS];
+    private final MotionEvent.PointerCoords[] touchPointerCoords = new MotionEvent.PointerCoords[PointersState.MAX_POINTERS];
     private final MotionEvent.PointerProperties[] pointerProperties = {new MotionEvent.PointerProperties()};
     private final MotionEvent.PointerCoords[] pointerCoords = {new MotionEvent.PointerCoords()};
 
+    // swipes are replayed on a separate thread, so that they do not delay the next events
+    private final ExecutorService swipeExecutor = Executors.newSingleThreadExecutor(new ThreadFactory() {
+        @Override
+        public Thread newThread(Runnable r) {
+            Thread thread = new Thread(r, "swipe");
+            // do not prevent the server to exit
+            thread.setDaemon(true);
+            return thread;
+        }
+    });
+    // only accessed from the swipe thread
+    private final MotionEvent.PointerProperties[] swipePointerProperties = {new MotionEvent.PointerProperties()};
+    private final MotionEvent.PointerCoords[] swipePointerCoords = {new MotionEvent.PointerCoords()};
+
     public EventController(Device device, DesktopConnection connection, ScreenEncoder encoder) {
         this.device = device;
         this.connection = connection;
         this.encoder = encoder;
-        initPointer();
+        initPointer(pointerProperties[0], pointerCoords[0]);
+        initPointer(swipePointerProperties[0], swipePointerCoords[0]);
+        for (int i = 0; i < PointersState.MAX_POINTERS; ++i) {
+            touchPointerProperties[i] = new MotionEvent.PointerProperties();
+            touchPointerCoords[i] = new MotionEvent.PointerCoords();
+            initPointer(touchPointerProperties[i], touchPointerCoords[i]);
+        }
     }
 
-    private void initPointer() {
-        MotionEvent.PointerProperties props = pointerProperties[0];
+    private static void initPointer(MotionEvent.PointerProperties props, MotionEvent.PointerCoords coords) {
         props.id = 0;
         props.toolType = MotionEvent.TOOL_TYPE_FINGER;
 
-        MotionEvent.PointerCoords coords = pointerCoords[0];
         coords.orientation = 0;
         coords.pressure = 1;
         coords.size = 1;
@@ -59,8 +88,13 @@ public class EventController {
         // on start, turn screen on
         turnScreenOn();
 
-        while (true) {
-            handleEvent();
+        try {
+            while (true) {
+                handleEvent();
+            }
+        } finally {
+            // in daemon mode, a new controller is created for every client
+            swipeExecutor.shutdownNow();
         }
     }
 
@@ -71,7 +105,7 @@ public class EventController {
                 injectKeycode(controlEvent.getAction(), controlEvent.getKeycode(), controlEvent.getMetaState());
                 break;
             case ControlEvent.TYPE_TEXT:
-                injectText(controlEvent.getText());
+                injectText(controlEvent.getTextChars());
                 break;
             case ControlEvent.TYPE_MOUSE:
                 injectMouse(controlEvent.getAction(), controlEvent.getButtons(), controlEvent.getPosition());
@@ -82,6 +116,15 @@ public class EventController {
             case ControlEvent.TYPE_COMMAND:
                 executeCommand(controlEvent.getAction());
                 break;
+            case ControlEvent.TYPE_SET_CLIPBOARD:
+                setClipboard(controlEvent.getTextChars(), controlEvent.getPaste());
+                break;
+            case ControlEvent.TYPE_TOUCH:
+                injectTouch(controlEvent.getAction(), controlEvent.getPointerId(), controlEvent.getPosition(), controlEvent.getPressure());
+                break;
+            case ControlEvent.TYPE_SWIPE:
+                injectSwipe(controlEvent.getPositions(), controlEvent.getDelay());
+                break;
             default:
                 // do nothing
         }
@@ -93,7 +136,13 @@ public class EventController {
 
     private boolean injectChar(char c) {
         String decomposed = KeyComposition.decompose(c);
-        char[] chars = decomposed != null ? decomposed.toCharArray() : new char[] {c};
+        char[] chars;
+        if (decomposed != null) {
+            chars = decomposed.toCharArray();
+        } else {
+            singleChar[0] = c;
+            chars = singleChar;
+        }
         KeyEvent[] events = charMap.getEvents(chars);
         if (events == null) {
             return false;
@@ -106,43 +155,141 @@ public class EventController {
         return true;
     }
 
-    private boolean injectText(String text) {
-        for (char c : text.toCharArray()) {
-            if (!injectChar(c)) {
+    private boolean injectText(CharSequence text) {
+        for (int i = 0; i < text.length(); ++i) {
+            if (!injectChar(text.charAt(i))) {
                 return false;
             }
         }
         return true;
     }
 
+    private boolean setClipboard(CharSequence text, boolean paste) {
+        if (!device.setClipboardText(text)) {
+            Ln.w("Could not set device clipboard");
+            return false;
+        }
+        // a single PASTE is much faster than injecting the text char by char
+        return !paste || injectKeycode(KeyEvent.KEYCODE_PASTE);
+    }
+
     private boolean injectMouse(int action, int buttons, Position position) {
         long now = SystemClock.uptimeMillis();
         if (action == MotionEvent.ACTION_DOWN) {
             lastMouseDown = now;
         }
-        Point point = device.getPhysicalPoint(position);
-        if (point == null) {
+        if (!device.getPhysicalPoint(position, physicalPoint)) {
             // ignore event
             return false;
         }
-        setPointerCoords(point);
+        setPointerCoords(physicalPoint);
         MotionEvent event = MotionEvent.obtain(lastMouseDown, now, action, 1, pointerProperties, pointerCoords, 0, buttons, 1f, 1f, 0, 0,
                 InputDevice.SOURCE_TOUCHSCREEN, 0);
-        return injectEvent(event);
+        return injectMotionEvent(event);
+    }
+
+    private boolean injectTouch(int action, long pointerId, Position position, float pressure) {
+        long now = SystemClock.uptimeMillis();
+        if (!device.getPhysicalPoint(position, physicalPoint)) {
+            // ignore event
+            return false;
+        }
+
+        int pointerIndex = pointersState.getPointerIndex(pointerId);
+        if (pointerIndex == -1) {
+            Ln.w("Too many pointers for touch event");
+            return false;
+        }
+        Pointer pointer = pointersState.get(pointerIndex);
+        pointer.setPoint(physicalPoint);
+        pointer.setPressure(pressure);
+        pointer.setUp(action == MotionEvent.ACTION_UP);
+
+        int pointerCount = pointersState.update(touchPointerProperties, touchPointerCoords);
+
+        if (pointerCount == 1) {
+            if (action == MotionEvent.ACTION_DOWN) {
+                lastTouchDown = now;
+            }
+        } else {
+            // secondary pointers must use ACTION_POINTER_* ORed with the pointer index
+            if (action == MotionEvent.ACTION_UP) {
+                action = MotionEvent.ACTION_POINTER_UP | (pointerIndex << MotionEvent.ACTION_POINTER_INDEX_SHIFT);
+            } else if (action == MotionEvent.ACTION_DOWN) {
+                action = MotionEvent.ACTION_POINTER_DOWN | (pointerIndex << MotionEvent.ACTION_POINTER_INDEX_SHIFT);
+            }
+        }
+
+        MotionEvent event = MotionEvent.obtain(lastTouchDown, now, action, pointerCount, touchPointerProperties, touchPointerCoords, 0, 0, 1f, 1f,
+                0, 0, InputDevice.SOURCE_TOUCHSCREEN, 0);
+        return injectMotionEvent(event);
     }
 
     private boolean injectScroll(Position position, int hScroll, int vScroll) {
         long now = SystemClock.uptimeMillis();
-        Point point = device.getPhysicalPoint(position);
-        if (point == null) {
+        if (!device.getPhysicalPoint(position, physicalPoint)) {
             // ignore event
             return false;
         }
-        setPointerCoords(point);
+        setPointerCoords(physicalPoint);
         setScroll(hScroll, vScroll);
         MotionEvent event = MotionEvent.obtain(lastMouseDown, now, MotionEvent.ACTION_SCROLL, 1, pointerProperties, pointerCoords, 0, 0, 1f, 1f, 0,
                 0, InputDevice.SOURCE_MOUSE, 0);
-        return injectEvent(event);
+        return injectMotionEvent(event);
+    }
+
+    private boolean injectSwipe(Position[] positions, final int delay) {
+        if (positions.length == 0) {
+            return false;
+        }
+        // convert the points now, the screen info may change during the replay
+        final Point[] points = new Point[positions.length];
+        for (int i = 0; i < positions.length; ++i) {
+            points[i] = device.getPhysicalPoint(positions[i]);
+            if (points[i] == null) {
+                // ignore event
+                return false;
+            }
+        }
+        swipeExecutor.execute(new Runnable() {
+            @Override
+            public void run() {
+                replaySwipe(points, delay);
+            }
+        });
+        return true;
+    }
+
+    private void replaySwipe(Point[] points, int delay) {
+        // DOWN on the first point, MOVE on the next ones, UP on the last one
+        int count = points.length + 1;
+        long downTime = SystemClock.uptimeMillis();
+        for (int i = 0; i < count; ++i) {
+            // the event times are scheduled from downTime, so that the delays do not drift
+            long eventTime = downTime + (long) i * delay;
+            long wait = eventTime - SystemClock.uptimeMillis();
+            if (wait > 0) {
+                SystemClock.sleep(wait);
+            }
+            int action;
+            if (i == 0) {
+                action = MotionEvent.ACTION_DOWN;
+            } else if (i == count - 1) {
+                action = MotionEvent.ACTION_UP;
+            } else {
+                action = MotionEvent.ACTION_MOVE;
+            }
+            Point point = points[Math.min(i, points.length - 1)];
+            MotionEvent.PointerCoords coords = swipePointerCoords[0];
+            coords.x = point.x;
+            coords.y = point.y;
+            MotionEvent event = MotionEvent.obtain(downTime, eventTime, action, 1, swipePointerProperties, swipePointerCoords, 0,
+                    MotionEvent.BUTTON_PRIMARY, 1f, 1f, 0, 0, InputDevice.SOURCE_TOUCHSCREEN, 0);
+            if (!injectMotionEvent(event)) {
+                Ln.w("Cannot inject swipe event");
+                return;
+            }
+        }
     }
 
     private boolean injectKeyEvent(int action, int keyCode, int repeat, int metaState) {
@@ -161,6 +308,13 @@ public class EventController {
         return device.injectInputEvent(event, InputManager.INJECT_INPUT_EVENT_MODE_ASYNC);
     }
 
+    private boolean injectMotionEvent(MotionEvent event) {
+        boolean result = injectEvent(event);
+        // the event has been marshalled by the binder call, give it back to the pool for the next MotionEvent.obtain()
+        event.recycle();
+        return result;
+    }
+
     private boolean turnScreenOn() {
         return device.isScreenOn() || injectKeycode(KeyEvent.KEYCODE_POWER);
     }
@@ -8,6 +8,10 @@ public class Options {
     private boolean tunnelForward;
     private Rect crop;
     private boolean sendFrameMeta; // send PTS so that the client may record properly
+    private boolean clipboardSync; // send the device clipboard changes to the client
+    private String daemonSocketName; // stay resident and accept clients on this socket, null if not a daemon
+    private int directPort; // listen on this TCP port instead of using the adb tunnel, 0 if disabled
+    private String directToken; // the client must send this token on every direct connection
 
     public int getMaxSize() {
         return maxSize;
@@ -48,4 +52,36 @@ public class Options {
     public void setSendFrameMeta(boolean sendFrameMeta) {
         this.sendFrameMeta = sendFrameMeta;
     }
+
+    public boolean getClipboardSync() {
+        return clipboardSync;
+    }
+
+    public void setClipboardSync(boolean clipboardSync) {
+        this.clipboardSync = clipboardSync;
+    }
+
+    public String getDaemonSocketName() {
+        return daemonSocketName;
+    }
+
+    public void setDaemonSocketName(String daemonSocketName) {
+        this.daemonSocketName = daemonSocketName;
+    }
+
+    public int getDirectPort() {
+        return directPort;
+    }
+
+    public void setDirectPort(int directPort) {
+        this.directPort = directPort;
+    }
+
+    public String getDirectToken() {
+        return directToken;
+    }
+
+    public void setDirectToken(String directToken) {
+        this.directToken = directToken;
+    }
 }
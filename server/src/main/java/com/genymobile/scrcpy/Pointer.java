@@ -0,0 +1,64 @@
+package com.genymobile.scrcpy;
+
+import android.graphics.Point;
+
+public class Pointer {
+
+    /**
+     * Pointer id as received from the client.
+     */
+    private final long id;
+
+    /**
+     * Local pointer id, using the lowest possible values to fill the {@link android.view.MotionEvent.PointerProperties PointerProperties}.
+     */
+    private final int localId;
+
+    // copied, the caller may reuse its Point
+    private int x;
+    private int y;
+    private float pressure;
+    private boolean up;
+
+    public Pointer(long id, int localId) {
+        this.id = id;
+        this.localId = localId;
+    }
+
+    public long getId() {
+        return id;
+    }
+
+    public int getLocalId() {
+        return localId;
+    }
+
+    public int getX() {
+        return x;
+    }
+
+    public int getY() {
+        return y;
+    }
+
+    public void setPoint(Point point) {
+        x = point.x;
+        y = point.y;
+    }
+
+    public float getPressure() {
+        return pressure;
+    }
+
+    public void setPressure(float pressure) {
+        this.pressure = pressure;
+    }
+
+    public boolean isUp() {
+        return up;
+    }
+
+    public void setUp(boolean up) {
+        this.up = up;
+    }
+}
@@ -0,0 +1,109 @@
+package com.genymobile.scrcpy;
+
+import android.view.MotionEvent;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * The pointers currently down, in the order expected by {@link MotionEvent} (the pointer index).
+ */
+public class PointersState {
+
+    public static final int MAX_POINTERS = 10;
+
+    private final List<Pointer> pointers = new ArrayList<>();
+
+    private int indexOf(long id) {
+        for (int i = 0; i < pointers.size(); ++i) {
+            Pointer pointer = pointers.get(i);
+            if (pointer.getId() == id) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    private boolean isLocalIdAvailable(int localId) {
+        for (int i = 0; i < pointers.size(); ++i) {
+            Pointer pointer = pointers.get(i);
+            if (pointer.getLocalId() == localId) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private int nextUnusedLocalId() {
+        for (int localId = 0; localId < MAX_POINTERS; ++localId) {
+            if (isLocalIdAvailable(localId)) {
+                return localId;
+            }
+        }
+        return -1;
+    }
+
+    public Pointer get(int index) {
+        return pointers.get(index);
+    }
+
+    /**
+     * Return the index of the pointer having the given id, adding it if it is not down yet.
+     *
+     * @param id the pointer id received from the client
+     * @return the pointer index, or -1 if there are already {@link #MAX_POINTERS} pointers
+     */
+    public int getPointerIndex(long id) {
+        int index = indexOf(id);
+        if (index != -1) {
+            // already exists, return it
+            return index;
+        }
+        if (pointers.size() >= MAX_POINTERS) {
+            // it's full
+            return -1;
+        }
+        int localId = nextUnusedLocalId();
+        if (localId == -1) {
+            throw new AssertionError("pointers.size() < MAX_POINTERS implies that a local id is available");
+        }
+        Pointer pointer = new Pointer(id, localId);
+        pointers.add(pointer);
+        // return the index of the pointer
+        return pointers.size() - 1;
+    }
+
+    /**
+     * Fill the {@link MotionEvent} arrays with the current pointers, then forget the pointers which are up.
+     *
+     * @param props the properties array to fill (of size at least {@link #MAX_POINTERS})
+     * @param coords the coordinates array to fill (of size at least {@link #MAX_POINTERS})
+     * @return the number of pointers to inject
+     */
+    public int update(MotionEvent.PointerProperties[] props, MotionEvent.PointerCoords[] coords) {
+        int count = pointers.size();
+        for (int i = 0; i < count; ++i) {
+            Pointer pointer = pointers.get(i);
+
+            props[i].id = pointer.getLocalId();
+
+            coords[i].x = pointer.getX();
+            coords[i].y = pointer.getY();
+            coords[i].pressure = pointer.getPressure();
+        }
+        cleanUp();
+        return count;
+    }
+
+    /**
+     * Remove all pointers which are UP.
+     */
+    private void cleanUp() {
+        for (int i = pointers.size() - 1; i >= 0; --i) {
+            Pointer pointer = pointers.get(i);
+            if (pointer.isUp()) {
+                pointers.remove(i);
+            }
+        }
+    }
+}
@@ -17,6 +17,14 @@ public class Position {
         this(new Point(x, y), new Size(screenWidth, screenHeight));
     }
 
+    /**
+     * Update the position in place, so that the instance can be reused.
+     */
+    public void set(int x, int y, Size screenSize) {
+        point.set(x, y);
+        this.screenSize = screenSize;
+    }
+
     public Point getPoint() {
         return point;
     }
@@ -28,6 +28,7 @@ public class ScreenEncoder implements Device.RotationListener {
 
     private final AtomicBoolean rotationChanged = new AtomicBoolean();
     private boolean suspended = true;
+    private boolean stopped;
     private final Object lock = new Object[0];
     private final ByteBuffer headerBuffer = ByteBuffer.allocate(12);
 
@@ -65,9 +66,25 @@ public class ScreenEncoder implements Device.RotationListener {
         return true;
     }
 
+    /**
+     * Stop streaming once the client is disconnected, even if suspended.
+     */
+    public void stop() {
+        synchronized(lock) {
+            stopped = true;
+            lock.notifyAll();
+        }
+    }
+
+    private boolean isStopped() {
+        synchronized(lock) {
+            return stopped;
+        }
+    }
+
     public final void pollSuspend() {
         synchronized(lock) {
-            while (suspended) {
+            while (suspended && !stopped) {
                 try {
                     lock.wait(500);
                 } catch (InterruptedException e) {
@@ -82,10 +99,16 @@ public class ScreenEncoder implements Device.RotationListener {
         MediaFormat format = createFormat(bitRate, frameRate, iFrameInterval);
         device.setRotationListener(this);
         boolean alive;
-        Looper.prepare();
+        if (Looper.myLooper() == null) {
+            // in daemon mode, the screen is streamed again for every client
+            Looper.prepare();
+        }
         try {
             do {
                 pollSuspend();
+                if (isStopped()) {
+                    break;
+                }
                 MediaCodec codec = createCodec();
                 IBinder display = createDisplay();
                 Rect contentRect = device.getScreenInfo().getContentRect();
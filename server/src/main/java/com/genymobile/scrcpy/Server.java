@@ -1,6 +1,7 @@
 package com.genymobile.scrcpy;
 
 import android.graphics.Rect;
+import android.net.LocalServerSocket;
 
 import java.io.IOException;
 import java.util.Arrays;
@@ -13,19 +14,77 @@ public final class Server {
 
     private static void scrcpy(Options options) throws IOException {
         final Device device = new Device(options);
+        String daemonSocketName = options.getDaemonSocketName();
+        if (daemonSocketName != null) {
+            runDaemon(device, options, daemonSocketName);
+            return;
+        }
+
+        int directPort = options.getDirectPort();
+        if (directPort != 0) {
+            try (DesktopConnection connection = DesktopConnection.openDirect(device, directPort, options.getDirectToken())) {
+                runSession(device, connection, options);
+            }
+            return;
+        }
+
         boolean tunnelForward = options.isTunnelForward();
         try (DesktopConnection connection = DesktopConnection.open(device, tunnelForward)) {
-            ScreenEncoder screenEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate());
+            runSession(device, connection, options);
+        }
+    }
+
+    /**
+     * Stay resident, and serve the clients one after the other (the process must be killed to stop).
+     */
+    private static void runDaemon(Device device, Options options, String socketName) throws IOException {
+        Ln.i("Daemon listening on " + socketName);
+        LocalServerSocket serverSocket = new LocalServerSocket(socketName);
+        try {
+            while (true) {
+                try (DesktopConnection connection = DesktopConnection.accept(device, serverSocket)) {
+                    Ln.i("Client connected");
+                    runSession(device, connection, options);
+                } catch (IOException e) {
+                    // the client disconnected during the initialization, wait for the next one
+                    Ln.w("Client connection failed: " + e.getMessage());
+                }
+                Ln.i("Client disconnected");
+            }
+        } finally {
+            serverSocket.close();
+        }
+    }
 
-            // asynchronous
-            startEventController(device, connection, screenEncoder);
+    private static void runSession(Device device, final DesktopConnection connection, Options options) {
+        final ScreenEncoder screenEncoder = new ScreenEncoder(options.getSendFrameMeta(), options.getBitRate());
+
+        if (options.getClipboardSync()) {
+            device.setClipboardListener(new Device.ClipboardListener() {
+                @Override
+                public void onClipboardTextChanged(String text) {
+                    try {
+                        connection.sendClipboardText(text);
+                    } catch (IOException e) {
+                        // this is expected on close
+                        Ln.d("Could not send device clipboard");
+                    }
+                }
+            });
+        }
 
-            try {
-                // synchronous
-                screenEncoder.streamScreen(device, connection.getFd());
-            } catch (IOException e) {
-                // this is expected on close
-                Ln.d("Screen streaming stopped");
+        // asynchronous
+        startEventController(device, connection, screenEncoder);
+
+        try {
+            // synchronous
+            screenEncoder.streamScreen(device, connection.getVideoFd());
+        } catch (IOException e) {
+            // this is expected on close
+            Ln.d("Screen streaming stopped");
+        } finally {
+            if (options.getClipboardSync()) {
+                device.setClipboardListener(null);
             }
         }
     }
@@ -39,6 +98,9 @@ public final class Server {
                 } catch (IOException e) {
                     // this is expected on close
                     Ln.d("Event controller stopped");
+                } finally {
+                    // the client is gone, do not wait for it to resume the encoder
+                    encoder.stop();
                 }
             }
         }).start();
@@ -78,6 +140,31 @@ public final class Server {
         boolean sendFrameMeta = Boolean.parseBoolean(args[4]);
         options.setSendFrameMeta(sendFrameMeta);
 
+        if (args.length < 6) {
+            return options;
+        }
+        boolean clipboardSync = Boolean.parseBoolean(args[5]);
+        options.setClipboardSync(clipboardSync);
+
+        if (args.length < 7) {
+            return options;
+        }
+        // empty if not a daemon
+        String daemonSocketName = args[6];
+        if (!daemonSocketName.isEmpty()) {
+            options.setDaemonSocketName(daemonSocketName);
+        }
+
+        if (args.length < 9) {
+            return options;
+        }
+        // 0 if not direct
+        int directPort = Integer.parseInt(args[7]);
+        if (directPort != 0) {
+            options.setDirectPort(directPort);
+            options.setDirectToken(args[8]);
+        }
+
         return options;
     }
 
@@ -0,0 +1,91 @@
+package com.genymobile.scrcpy.wrappers;
+
+import com.genymobile.scrcpy.Ln;
+
+import android.content.ClipData;
+import android.content.IOnPrimaryClipChangedListener;
+import android.os.Build;
+import android.os.IInterface;
+
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+
+public final class ClipboardManager {
+
+    private static final String PACKAGE_NAME = "com.android.shell";
+    private static final int USER_ID = 0;
+    // Build.VERSION_CODES.Q, not available with the current compileSdkVersion
+    private static final int SDK_Q = 29;
+
+    private final IInterface manager;
+    private final Method getPrimaryClipMethod;
+    private final Method setPrimaryClipMethod;
+    private final Method addPrimaryClipChangedListenerMethod;
+
+    public ClipboardManager(IInterface manager) {
+        this.manager = manager;
+        try {
+            // since Android Q, the methods take an additional user id
+            if (Build.VERSION.SDK_INT < SDK_Q) {
+                getPrimaryClipMethod = manager.getClass().getMethod("getPrimaryClip", String.class);
+                setPrimaryClipMethod = manager.getClass().getMethod("setPrimaryClip", ClipData.class, String.class);
+                addPrimaryClipChangedListenerMethod = manager.getClass().getMethod("addPrimaryClipChangedListener",
+                        IOnPrimaryClipChangedListener.class, String.class);
+            } else {
+                getPrimaryClipMethod = manager.getClass().getMethod("getPrimaryClip", String.class, int.class);
+                setPrimaryClipMethod = manager.getClass().getMethod("setPrimaryClip", ClipData.class, String.class, int.class);
+                addPrimaryClipChangedListenerMethod = manager.getClass().getMethod("addPrimaryClipChangedListener",
+                        IOnPrimaryClipChangedListener.class, String.class, int.class);
+            }
+        } catch (NoSuchMethodException e) {
+            throw new AssertionError(e);
+        }
+    }
+
+    public CharSequence getText() {
+        try {
+            ClipData clipData;
+            if (Build.VERSION.SDK_INT < SDK_Q) {
+                clipData = (ClipData) getPrimaryClipMethod.invoke(manager, PACKAGE_NAME);
+            } else {
+                clipData = (ClipData) getPrimaryClipMethod.invoke(manager, PACKAGE_NAME, USER_ID);
+            }
+            if (clipData == null || clipData.getItemCount() == 0) {
+                return null;
+            }
+            return clipData.getItemAt(0).getText();
+        } catch (InvocationTargetException | IllegalAccessException e) {
+            Ln.e("Could not invoke " + getPrimaryClipMethod.getName(), e);
+            return null;
+        }
+    }
+
+    public boolean setText(CharSequence text) {
+        ClipData clipData = ClipData.newPlainText(null, text);
+        try {
+            if (Build.VERSION.SDK_INT < SDK_Q) {
+                setPrimaryClipMethod.invoke(manager, clipData, PACKAGE_NAME);
+            } else {
+                setPrimaryClipMethod.invoke(manager, clipData, PACKAGE_NAME, USER_ID);
+            }
+            return true;
+        } catch (InvocationTargetException | IllegalAccessException e) {
+            Ln.e("Could not invoke " + setPrimaryClipMethod.getName(), e);
+            return false;
+        }
+    }
+
+    public boolean addPrimaryClipChangedListener(IOnPrimaryClipChangedListener listener) {
+        try {
+            if (Build.VERSION.SDK_INT < SDK_Q) {
+                addPrimaryClipChangedListenerMethod.invoke(manager, listener, PACKAGE_NAME);
+            } else {
+                addPrimaryClipChangedListenerMethod.invoke(manager, listener, PACKAGE_NAME, USER_ID);
+            }
+            return true;
+        } catch (InvocationTargetException | IllegalAccessException e) {
+            Ln.e("Could not invoke " + addPrimaryClipChangedListenerMethod.getName(), e);
+            return false;
+        }
+    }
+}
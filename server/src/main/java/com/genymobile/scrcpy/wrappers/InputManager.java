@@ -14,6 +14,8 @@ public final class InputManager {
 
     private final IInterface manager;
     private final Method injectInputEventMethod;
+    // reused to avoid a varargs array allocation on every injection
+    private final Object[] injectArgs = new Object[2];
 
     public InputManager(IInterface manager) {
         this.manager = manager;
@@ -24,11 +26,15 @@ public final class InputManager {
         }
     }
 
-    public boolean injectInputEvent(InputEvent inputEvent, int mode) {
+    public synchronized boolean injectInputEvent(InputEvent inputEvent, int mode) {
         try {
-            return (Boolean) injectInputEventMethod.invoke(manager, inputEvent, mode);
+            injectArgs[0] = inputEvent;
+            injectArgs[1] = mode; // small values are cached by Integer.valueOf()
+            return (Boolean) injectInputEventMethod.invoke(manager, injectArgs);
         } catch (InvocationTargetException | IllegalAccessException e) {
             throw new AssertionError(e);
+        } finally {
+            injectArgs[0] = null;
         }
     }
 }
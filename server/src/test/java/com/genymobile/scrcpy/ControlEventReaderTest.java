@@ -76,6 +76,87 @@ public class ControlEventReaderTest {
         Assert.assertEquals(new String(text, StandardCharsets.US_ASCII), event.getText());
     }
 
+    @Test
+    public void testParseTextEventsReuse() throws IOException {
+        ControlEventReader reader = new ControlEventReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        byte[] text = "first".getBytes(StandardCharsets.UTF_8);
+        dos.writeByte(ControlEvent.TYPE_TEXT);
+        dos.writeShort(text.length);
+        dos.write(text);
+        text = "ab".getBytes(StandardCharsets.UTF_8);
+        dos.writeByte(ControlEvent.TYPE_TEXT);
+        dos.writeShort(text.length);
+        dos.write(text);
+        byte[] packet = bos.toByteArray();
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+
+        ControlEvent event1 = reader.next();
+        Assert.assertEquals(ControlEvent.TYPE_TEXT, event1.getType());
+        Assert.assertEquals("first", event1.getText());
+
+        ControlEvent event2 = reader.next();
+        // the same instance is reused, so parsing does not allocate
+        Assert.assertSame(event1, event2);
+        Assert.assertEquals(ControlEvent.TYPE_TEXT, event2.getType());
+        Assert.assertEquals("ab", event2.getText());
+        Assert.assertEquals(2, event2.getTextChars().length());
+    }
+
+    @Test
+    public void testParseSetClipboardEvent() throws IOException {
+        ControlEventReader reader = new ControlEventReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlEvent.TYPE_SET_CLIPBOARD);
+        dos.writeByte(1); // paste
+        byte[] text = "testé".getBytes(StandardCharsets.UTF_8);
+        dos.writeInt(text.length);
+        dos.write(text);
+        byte[] packet = bos.toByteArray();
+
+        reader.readFrom(new ByteArrayInputStream(packet));
+        ControlEvent event = reader.next();
+
+        Assert.assertEquals(ControlEvent.TYPE_SET_CLIPBOARD, event.getType());
+        Assert.assertEquals("testé", event.getText());
+        Assert.assertTrue(event.getPaste());
+    }
+
+    @Test
+    public void testParseBigSetClipboardEvent() throws IOException {
+        ControlEventReader reader = new ControlEventReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+        dos.writeByte(ControlEvent.TYPE_SET_CLIPBOARD);
+        dos.writeByte(0); // do not paste
+        byte[] text = new byte[ControlEventReader.CLIPBOARD_TEXT_MAX_LENGTH];
+        Arrays.fill(text, (byte) 'a');
+        dos.writeInt(text.length);
+        dos.write(text);
+        byte[] packet = bos.toByteArray();
+
+        // the event is received in several chunks
+        int offset = 0;
+        ControlEvent event = null;
+        while (event == null) {
+            int len = Math.min(packet.length - offset, 4096);
+            reader.readFrom(new ByteArrayInputStream(packet, offset, len));
+            offset += len;
+            event = reader.next();
+        }
+        Assert.assertEquals(packet.length, offset);
+
+        Assert.assertEquals(ControlEvent.TYPE_SET_CLIPBOARD, event.getType());
+        Assert.assertEquals(new String(text, StandardCharsets.US_ASCII), event.getText());
+        Assert.assertFalse(event.getPaste());
+    }
+
     @Test
     public void testParseMouseEvent() throws IOException {
         ControlEventReader reader = new ControlEventReader();
@@ -170,4 +251,26 @@ public class ControlEventReaderTest {
         Assert.assertEquals(MotionEvent.BUTTON_PRIMARY, event.getKeycode());
         Assert.assertEquals(KeyEvent.META_CTRL_ON, event.getMetaState());
     }
+
+    @Test
+    public void testParsePartialSwipeEvent() throws IOException {
+        ControlEventReader reader = new ControlEventReader();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        DataOutputStream dos = new DataOutputStream(bos);
+
+        dos.writeByte(ControlEvent.TYPE_SWIPE);
+        dos.writeShort(50); // delay
+        dos.writeShort(1080);
+        dos.writeShort(1920);
+        dos.writeByte(3); // 3 points
+        dos.writeShort(260);
+        dos.writeShort(1026);
+
+        byte[] packet = bos.toByteArray();
+        reader.readFrom(new ByteArrayInputStream(packet));
+
+        ControlEvent event = reader.next();
+        Assert.assertNull(event); // the points are not complete
+    }
 }
@@ -0,0 +1,60 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+
+public class DeviceMessageWriterTest {
+
+    @Test
+    @SuppressWarnings("checkstyle:MagicNumber")
+    public void testSerializeClipboard() throws IOException {
+        DeviceMessageWriter writer = new DeviceMessageWriter();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        writer.writeClipboardText("aÉ", bos);
+
+        byte[] expected = {
+            DeviceMessageWriter.TYPE_CLIPBOARD,
+            0, 0, 0, 3, // length
+            'a', (byte) 0xc3, (byte) 0x89, // "aÉ" in UTF-8
+        };
+        Assert.assertArrayEquals(expected, bos.toByteArray());
+    }
+
+    @Test
+    public void testSerializeSeveral() throws IOException {
+        DeviceMessageWriter writer = new DeviceMessageWriter();
+
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        writer.writeClipboardText("a", bos);
+        writer.writeClipboardText("", bos);
+
+        byte[] expected = {
+            DeviceMessageWriter.TYPE_CLIPBOARD, 0, 0, 0, 1, 'a',
+            DeviceMessageWriter.TYPE_CLIPBOARD, 0, 0, 0, 0,
+        };
+        Assert.assertArrayEquals(expected, bos.toByteArray());
+    }
+
+    @Test
+    @SuppressWarnings("checkstyle:MagicNumber")
+    public void testSerializeLongClipboard() throws IOException {
+        DeviceMessageWriter writer = new DeviceMessageWriter();
+
+        char[] chars = new char[1 << 19];
+        Arrays.fill(chars, 'x');
+        ByteArrayOutputStream bos = new ByteArrayOutputStream();
+        writer.writeClipboardText(new String(chars), bos);
+
+        byte[] result = bos.toByteArray();
+        int maxLength = (1 << 18) - 6;
+        Assert.assertEquals(5 + maxLength, result.length);
+        String text = new String(result, 5, result.length - 5, StandardCharsets.UTF_8);
+        Assert.assertEquals(maxLength, text.length());
+    }
+}
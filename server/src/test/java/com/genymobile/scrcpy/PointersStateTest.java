@@ -0,0 +1,37 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+public class PointersStateTest {
+
+    @Test
+    public void testPointerIndexes() {
+        PointersState pointersState = new PointersState();
+
+        int index0 = pointersState.getPointerIndex(42);
+        int index1 = pointersState.getPointerIndex(7);
+        Assert.assertEquals(0, index0);
+        Assert.assertEquals(1, index1);
+
+        // an existing pointer keeps its index
+        Assert.assertEquals(0, pointersState.getPointerIndex(42));
+        Assert.assertEquals(1, pointersState.getPointerIndex(7));
+
+        // local ids are the lowest available values
+        Assert.assertEquals(0, pointersState.get(index0).getLocalId());
+        Assert.assertEquals(1, pointersState.get(index1).getLocalId());
+    }
+
+    @Test
+    public void testMaxPointers() {
+        PointersState pointersState = new PointersState();
+
+        for (int i = 0; i < PointersState.MAX_POINTERS; ++i) {
+            Assert.assertEquals(i, pointersState.getPointerIndex(i));
+        }
+
+        // it's full
+        Assert.assertEquals(-1, pointersState.getPointerIndex(PointersState.MAX_POINTERS));
+    }
+}
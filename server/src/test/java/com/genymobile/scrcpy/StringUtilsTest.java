@@ -0,0 +1,42 @@
+package com.genymobile.scrcpy;
+
+import org.junit.Assert;
+import org.junit.Test;
+
+import java.nio.charset.StandardCharsets;
+
+public class StringUtilsTest {
+
+    @Test
+    @SuppressWarnings("checkstyle:MagicNumber")
+    public void testUtf8Truncate() {
+        byte[] s = "aÉbÔc".getBytes(StandardCharsets.UTF_8);
+        Assert.assertEquals(7, s.length);
+
+        int count;
+
+        count = StringUtils.getUtf8TruncationIndex(s, 1);
+        Assert.assertEquals(1, count);
+
+        count = StringUtils.getUtf8TruncationIndex(s, 2);
+        Assert.assertEquals(1, count); // É is 2 bytes-wide
+
+        count = StringUtils.getUtf8TruncationIndex(s, 3);
+        Assert.assertEquals(3, count);
+
+        count = StringUtils.getUtf8TruncationIndex(s, 4);
+        Assert.assertEquals(4, count);
+
+        count = StringUtils.getUtf8TruncationIndex(s, 5);
+        Assert.assertEquals(4, count); // Ô is 2 bytes-wide
+
+        count = StringUtils.getUtf8TruncationIndex(s, 6);
+        Assert.assertEquals(6, count);
+
+        count = StringUtils.getUtf8TruncationIndex(s, 7);
+        Assert.assertEquals(7, count);
+
+        count = StringUtils.getUtf8TruncationIndex(s, 8);
+        Assert.assertEquals(7, count); // no more chars
+    }
+}